@@ -0,0 +1,139 @@
+/* Load and playback throughput of the dataset columns on a synthetic CSV   *
+ * with a date, integer, float and text columns, or on a given file:       *
+ * bench_dataset [file [date column]]. The same data is then converted to  *
+ * the binary format to time mapping it, seeking by time and playing from  *
+ * the mapping. Publishing goes to a checksum in place of                  *
+ * mpr_sig_set_value, so this measures the player's own cost.              */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "dataset.h"
+#include "interpolate.h"
+#include "scheduler.h"
+
+#define BENCH_ROWS 100000
+#define BENCH_COLUMNS 128
+#define BENCH_PASSES 20
+#define BENCH_SEEKS 100000
+
+// what the player's publisher does, minus libmapper
+struct ChecksumSink
+{
+    ChecksumSink() : sum(0), cells(0) {}
+    void operator()(size_t col, int32_t value) { sum += value; ++cells; }
+    void operator()(size_t col, float value) { sum += value; ++cells; }
+    void operator()(size_t col, double value) { sum += value; ++cells; }
+    double sum;
+    unsigned long cells;
+};
+
+static void write_synthetic(const char *path)
+{
+    static const char *words[] = {"idle", "walking", "running", "cycling"};
+    FILE *file = fopen(path, "w");
+    fprintf(file, "time");
+    for (int c = 1; c < BENCH_COLUMNS; c++)
+        fprintf(file, ",%s %d", c % 4 == 0 ? "state" : c % 2 ? "sensor" : "count", c);
+    fprintf(file, "\n");
+    for (int r = 0; r < BENCH_ROWS; r++) {
+        int ms = r * 10;
+        fprintf(file, "2024-05-01 12:%02d:%02d.%03d", ms / 60000 % 60, ms / 1000 % 60, ms % 1000);
+        for (int c = 1; c < BENCH_COLUMNS; c++) {
+            if (c % 4 == 0)
+                fprintf(file, ",%s", words[(r / 100 + c) % 4]);
+            else if (c % 2)
+                fprintf(file, ",%.5f", sin(r * 0.01 + c));
+            else
+                fprintf(file, ",%d", (r * c) % 1000);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+static double playback(const dataset::Dataset &data, ChecksumSink &sink)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        for (size_t r = 0; r < data.rows(); r++)
+            data.visit_row(r, sink);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "/tmp/bench_dataset.csv";
+    int date_column = argc > 2 ? atoi(argv[2]) : argc > 1 ? -1 : 0;
+    if (argc < 2)
+        write_synthetic(path);
+
+    dataset::Dataset data;
+    auto start = std::chrono::steady_clock::now();
+    if (!data.load(path, date_column)) {
+        printf("%s\n", data.error().c_str());
+        return 1;
+    }
+    double load = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t rows = data.rows(), cols = data.columns().size();
+    printf("load: %zu rows x %zu columns in %.3f s, %.0f rows/sec\n", rows, cols, load, rows / load);
+
+    ChecksumSink sink;
+    double play = playback(data, sink);
+    printf("playback: %.0f rows/sec, %.1f ns/cell (checksum %g)\n",
+           rows * BENCH_PASSES / play, play * 1e9 / sink.cells, sink.sum);
+
+    const char *binary = "/tmp/bench_dataset.dsb";
+    start = std::chrono::steady_clock::now();
+    if (!data.save_binary(binary)) {
+        printf("%s\n", data.error().c_str());
+        return 1;
+    }
+    double save = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    dataset::Dataset mapped;
+    start = std::chrono::steady_clock::now();
+    if (!mapped.open_binary(binary)) {
+        printf("%s\n", mapped.error().c_str());
+        return 1;
+    }
+    double open = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("binary: written in %.3f s, mapped in %.3f ms\n", save, open * 1e3);
+
+    if (mapped.timeline()) {
+        dataset::Scheduler sched(mapped.timeline(), mapped.rows());
+        double span = sched.offset(mapped.rows() - 1);
+        unsigned long found = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_SEEKS; i++) {
+            sched.seek_time(span * ((i * 7919) % BENCH_SEEKS) / BENCH_SEEKS);
+            found += sched.position();
+        }
+        double seek = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("seek by time: %.0f ns (%lu)\n", seek * 1e9 / BENCH_SEEKS, found);
+    }
+
+    ChecksumSink mapped_sink;
+    play = playback(mapped, mapped_sink);
+    printf("mapped playback: %.0f rows/sec, %.1f ns/cell (checksum %g)\n",
+           rows * BENCH_PASSES / play, play * 1e9 / mapped_sink.cells, mapped_sink.sum);
+
+    // one evaluation per tick, across every column of the mapped dataset
+    const char *modes[] = {"hold", "linear", "cubic"};
+    for (const char *name : modes) {
+        dataset::Mode mode;
+        dataset::parse_mode(name, mode);
+        dataset::Interpolator interp(mapped, mode);
+        ChecksumSink tick_sink;
+        start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r + 1 < rows; r++) {
+            interp.evaluate(r, 0.5);
+            interp.visit(tick_sink);
+        }
+        double ticks = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%s interpolation: %.0f ticks/sec, %.1f ns/cell (checksum %g)\n",
+               name, (rows - 1) / ticks, ticks * 1e9 / tick_sink.cells, tick_sink.sum);
+    }
+    return 0;
+}
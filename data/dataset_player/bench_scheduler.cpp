@@ -0,0 +1,30 @@
+/* Timing error of scheduled playback: a 1 kHz timeline played through the  *
+ * scheduler with plain absolute sleeps and with the final stretch spun.    */
+
+#include <cstdio>
+#include <vector>
+#include "scheduler.h"
+
+#define BENCH_RATE_HZ 1000
+#define BENCH_SECONDS 3
+
+int main()
+{
+    std::vector<double> times(BENCH_RATE_HZ * BENCH_SECONDS);
+    for (size_t i = 0; i < times.size(); i++)
+        times[i] = 1.7e9 + (double)i / BENCH_RATE_HZ;
+
+    const int64_t spins[] = {0, 50000, SCHED_SPIN_NS};
+    for (int64_t spin : spins) {
+        dataset::Scheduler sched(times.data(), times.size());
+        size_t row;
+        double frac;
+        int64_t due;
+        while (sched.next(row, frac, due))
+            sched.sent(due, dataset::sleep_until(due, spin));
+        dataset::Scheduler::Report r = sched.report();
+        printf("spin %3d us: %lu rows, error mean %6.1f us, max %7.1f us, %lu late, %lu resyncs\n",
+               (int)(spin / 1000), r.sent, r.mean_error_us, r.max_error_us, r.late, r.resyncs);
+    }
+    return 0;
+}
@@ -0,0 +1,676 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dataset.h"
+
+using namespace dataset;
+
+namespace {
+
+struct Cell
+{
+    Cell() : begin(nullptr), end(nullptr), quoted(false) {}
+    Cell(const char *b, const char *e, bool q) : begin(b), end(e), quoted(q) {}
+    const char *begin, *end;
+    bool quoted;
+    std::string text() const;
+};
+
+// quoted cells may hold doubled quotes; only text columns ever need this
+std::string Cell::text() const
+{
+    std::string s(begin, end);
+    if (quoted) {
+        size_t pos = 0;
+        while ((pos = s.find("\"\"", pos)) != std::string::npos)
+            s.erase(pos++, 1);
+    }
+    return s;
+}
+
+// RFC 4180 fields over a buffer holding the whole file
+class CsvReader
+{
+public:
+    CsvReader(const char *begin, const char *end) : _p(begin), _end(end) {}
+
+    bool done() const { return _p >= _end; }
+
+    // false at the end of the record, after which the next call starts a new one
+    bool next(Cell &cell)
+    {
+        if (_p >= _end)
+            return false;
+        if (*_p == '"') {
+            cell.begin = ++_p;
+            while (_p < _end && (*_p != '"' || (_p + 1 < _end && _p[1] == '"')))
+                _p += *_p == '"' ? 2 : 1;
+            cell.end = _p;
+            cell.quoted = true;
+            if (_p < _end)
+                ++_p;
+            while (_p < _end && *_p != ',' && *_p != '\n')
+                ++_p;
+        } else {
+            cell.begin = _p;
+            while (_p < _end && *_p != ',' && *_p != '\n')
+                ++_p;
+            cell.end = _p;
+            if (cell.end > cell.begin && cell.end[-1] == '\r')
+                --cell.end;
+            cell.quoted = false;
+        }
+        bool more = _p < _end && *_p == ',';
+        ++_p;
+        return more;
+    }
+
+    // the cells of the next record, none for a blank line
+    size_t record(std::vector<Cell> &cells)
+    {
+        cells.clear();
+        Cell cell;
+        bool more = true;
+        while (more) {
+            more = next(cell);
+            cells.push_back(cell);
+        }
+        if (cells.size() == 1 && cell.begin == cell.end)
+            cells.clear();
+        return cells.size();
+    }
+
+private:
+    const char *_p, *_end;
+};
+
+// the markers pandas reads as NaN by default, less the rare ones
+bool is_missing(const Cell &c)
+{
+    static const char *na[] = {"NA", "N/A", "NaN", "nan", "null", "NULL"};
+    size_t n = c.end - c.begin;
+    if (!n)
+        return true;
+    if (n > 4 || (c.begin[0] != 'N' && c.begin[0] != 'n'))
+        return false;
+    for (const char *s : na) {
+        if (strlen(s) == n && !memcmp(s, c.begin, n))
+            return true;
+    }
+    return false;
+}
+
+// plain decimals, which is nearly every cell, are read here; anything else
+// (exponents, inf, hex) goes through strtod, which needs a terminated copy
+bool parse_number(const Cell &c, double &value, bool &integer)
+{
+    const char *p = c.begin, *end = c.end;
+    while (p < end && *p == ' ')
+        ++p;
+    while (end > p && end[-1] == ' ')
+        --end;
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+        ++p;
+    const char *digits = p;
+    uint64_t mantissa = 0;
+    int scale = 0, count = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, count++)
+        mantissa = mantissa * 10 + (*p - '0');
+    integer = p == end;
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; p++, count++, scale++)
+            mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (p == end && count > 0 && count <= 18 && p - digits > (integer ? 0 : 1)) {
+        static const double powers[] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+        value = (double)mantissa / powers[scale];
+        if (negative)
+            value = -value;
+        integer = integer && value >= INT32_MIN && value <= INT32_MAX;
+        return true;
+    }
+
+    // text fails here rather than in strtod
+    char first = digits < end ? *digits | 0x20 : 0;
+    if (first != '.' && first != 'i' && first != 'n' && (first < '0' || first > '9'))
+        return false;
+    char buf[64];
+    size_t n = c.end - c.begin;
+    if (!n || n >= sizeof(buf))
+        return false;
+    memcpy(buf, c.begin, n);
+    buf[n] = 0;
+    char *stop;
+    value = strtod(buf, &stop);
+    while (*stop == ' ')
+        ++stop;
+    integer = false;
+    return !*stop && stop != buf;
+}
+
+// yes/no and true/false read as 0 and 1 rather than arbitrary ordinals
+int parse_bool(const Cell &c)
+{
+    static const char *words[] = {"no", "false", "yes", "true"};
+    size_t n = c.end - c.begin;
+    for (int i = 0; i < 4; i++) {
+        if (strlen(words[i]) == n && !strncasecmp(words[i], c.begin, n))
+            return i / 2;
+    }
+    return -1;
+}
+
+// what pass one learned about a column
+struct Inference
+{
+    Inference() : numeric(true), integer(true), missing(false), boolean(true) {}
+    bool numeric, integer, missing, boolean;
+};
+
+int digits(const char *&p, const char *end, int count)
+{
+    int v = 0;
+    for (int i = 0; i < count; i++, p++) {
+        if (p >= end || *p < '0' || *p > '9')
+            return -1;
+        v = v * 10 + (*p - '0');
+    }
+    return v;
+}
+
+} // namespace
+
+double dataset::parse_date(const char *begin, const char *end)
+{
+    const char *p = begin;
+    while (p < end && *p == ' ')
+        ++p;
+    while (end > p && end[-1] == ' ')
+        --end;
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    int year = digits(p, end, 4);
+    if (year < 0 || p >= end || (*p != '-' && *p != '/')) {
+        // already a timestamp
+        Cell cell(begin, end, false);
+        double value;
+        bool integer;
+        return parse_number(cell, value, integer) ? value : NAN;
+    }
+    ++p;
+    int month = digits(p, end, 2);
+    if (month < 0 || p >= end || (*p != '-' && *p != '/'))
+        return NAN;
+    ++p;
+    int day = digits(p, end, 2);
+    if (day < 0)
+        return NAN;
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+
+    double fraction = 0;
+    if (p < end && (*p == 'T' || *p == ' ')) {
+        ++p;
+        tm.tm_hour = digits(p, end, 2);
+        if (tm.tm_hour < 0 || p >= end || *p++ != ':')
+            return NAN;
+        tm.tm_min = digits(p, end, 2);
+        if (tm.tm_min < 0)
+            return NAN;
+        if (p < end && *p == ':') {
+            ++p;
+            tm.tm_sec = digits(p, end, 2);
+            if (tm.tm_sec < 0)
+                return NAN;
+            if (p < end && *p == '.') {
+                double scale = 0.1;
+                for (++p; p < end && *p >= '0' && *p <= '9'; p++, scale *= 0.1)
+                    fraction += (*p - '0') * scale;
+            }
+        }
+    }
+
+    if (p == end) {
+        tm.tm_isdst = -1;
+        return (double)mktime(&tm) + fraction;
+    }
+    int offset = 0;
+    if (*p == 'Z') {
+        ++p;
+    } else if (*p == '+' || *p == '-') {
+        int sign = *p++ == '-' ? -1 : 1;
+        int hours = digits(p, end, 2);
+        if (p < end && *p == ':')
+            ++p;
+        int minutes = p < end ? digits(p, end, 2) : 0;
+        if (hours < 0 || minutes < 0)
+            return NAN;
+        offset = sign * (hours * 3600 + minutes * 60);
+    }
+    if (p != end)
+        return NAN;
+    return (double)timegm(&tm) - offset + fraction;
+}
+
+std::string dataset::strip_unit(const std::string &name, std::string &unit)
+{
+    size_t n = name.size();
+    if (n < 3 || (name[n - 1] != ')' && name[n - 1] != ']'))
+        return name;
+    size_t open = name.find_last_of(name[n - 1] == ')' ? '(' : '[');
+    if (open == std::string::npos || open == 0 || open + 2 >= n)
+        return name;
+    size_t end = open;
+    while (end > 0 && name[end - 1] == ' ')
+        end--;
+    if (!end)
+        return name;
+    unit = name.substr(open + 1, n - open - 2);
+    return name.substr(0, end);
+}
+
+size_t dataset::type_size(Type type)
+{
+    return type == DOUBLE ? 8 : 4;
+}
+
+/************************************* Dataset **************************************/
+
+Dataset::Dataset()
+: _rows(0), _chunk_rows(1), _timeline_data(nullptr), _map(nullptr), _map_bytes(0)
+{}
+
+Dataset::~Dataset()
+{
+    close();
+}
+
+void Dataset::close()
+{
+    if (_map)
+        munmap(_map, _map_bytes);
+    _map = nullptr;
+    _map_bytes = 0;
+    _rows = 0;
+    _chunk_rows = 1;
+    _columns.clear();
+    _timeline.clear();
+    _timeline_data = nullptr;
+}
+
+int Dataset::date_column() const
+{
+    for (size_t i = 0; i < _columns.size(); i++) {
+        if (_columns[i].is_date)
+            return (int)i;
+    }
+    return -1;
+}
+
+bool Dataset::load(const char *path, int date_column)
+{
+    char magic[8] = {0};
+    FILE *file = fopen(path, "rb");
+    if (file) {
+        if (fread(magic, 1, sizeof(magic), file) != sizeof(magic))
+            magic[0] = 0;
+        fclose(file);
+    }
+    if (!memcmp(magic, DATASET_MAGIC, sizeof(magic)))
+        return open_binary(path);
+    return load_csv(path, date_column);
+}
+
+/* Two passes over the file held in memory: the first settles each column's
+ * type and the row count, the second converts straight into arrays of the
+ * final size, so no cell is ever stored as text. */
+bool Dataset::load_csv(const char *path, int date_column)
+{
+    close();
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        _error = std::string("could not open ") + path;
+        return false;
+    }
+    std::string buffer;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size > 0) {
+        buffer.resize(size);
+        if (fread(&buffer[0], 1, size, file) != (size_t)size)
+            buffer.clear();
+    }
+    fclose(file);
+    const char *begin = buffer.data(), *end = begin + buffer.size();
+    if (buffer.size() >= 3 && !memcmp(begin, "\xef\xbb\xbf", 3))
+        begin += 3;
+
+    // header
+    CsvReader reader(begin, end);
+    std::vector<Cell> cells;
+    reader.record(cells);
+    for (const Cell &cell : cells) {
+        Column c;
+        c.name = cell.text();
+        if (c.name.empty())
+            c.name = "Unnamed: " + std::to_string(_columns.size());
+        // pandas numbers repeated names, keeping them unique as signal names
+        for (int dup = 1; ; dup++) {
+            bool unique = true;
+            for (const Column &other : _columns)
+                unique = unique && other.name != c.name;
+            if (unique)
+                break;
+            c.name = cell.text() + "." + std::to_string(dup);
+        }
+        c.is_date = (int)_columns.size() == date_column;
+        strip_unit(c.name, c.unit);
+        _columns.push_back(c);
+    }
+    if (_columns.empty()) {
+        _error = std::string(path) + " has no header";
+        return false;
+    }
+    size_t ncols = _columns.size();
+    if (date_column < -1 || date_column >= (int)ncols) {
+        _error = std::string(path) + " has no column " + std::to_string(date_column)
+               + " for dates, only 0 to " + std::to_string(ncols - 1);
+        close();
+        return false;
+    }
+
+    // pass one; short rows are padded with missing cells, extra cells ignored
+    std::vector<Inference> inference(ncols);
+    while (!reader.done()) {
+        size_t n = reader.record(cells);
+        if (!n)
+            continue;
+        for (size_t i = 0; i < ncols; i++) {
+            Inference &inf = inference[i];
+            if (i >= n || is_missing(cells[i])) {
+                inf.missing = true;
+                continue;
+            }
+            double value;
+            bool integer;
+            if (inf.numeric && !parse_number(cells[i], value, integer))
+                inf.numeric = false;
+            inf.integer = inf.integer && inf.numeric && integer;
+            inf.boolean = inf.boolean && parse_bool(cells[i]) >= 0;
+        }
+        _rows++;
+    }
+
+    for (size_t i = 0; i < ncols; i++) {
+        Column &c = _columns[i];
+        const Inference &inf = inference[i];
+        if (c.is_date)
+            c.type = DOUBLE;
+        else if (inf.numeric && inf.integer && !inf.missing)
+            c.type = INT32;
+        else if (inf.numeric)
+            c.type = FLOAT;
+        else
+            c.type = INT32;
+        switch (c.type) {
+            case INT32:     c.ints.resize(_rows);       break;
+            case FLOAT:     c.floats.resize(_rows);     break;
+            case DOUBLE:    c.doubles.resize(_rows);    break;
+        }
+        inference[i].boolean = !c.is_date && !inf.numeric && inf.boolean && !inf.missing;
+        if (inference[i].boolean)
+            c.labels = {"no", "yes"};
+        c.min = INFINITY;
+        c.max = -INFINITY;
+    }
+
+    // pass two
+    std::vector<std::unordered_map<std::string, int32_t> > ordinals(ncols);
+    reader = CsvReader(begin, end);
+    reader.record(cells);
+    for (size_t row = 0; row < _rows; ) {
+        size_t n = reader.record(cells);
+        if (!n)
+            continue;
+        for (size_t i = 0; i < ncols; i++) {
+            Column &c = _columns[i];
+            const Inference &inf = inference[i];
+            Cell cell = i < n ? cells[i] : Cell();
+            bool missing = i >= n || is_missing(cell);
+            double value = NAN;
+            bool integer;
+            if (c.is_date) {
+                value = missing ? NAN : parse_date(cell.begin, cell.end);
+                c.doubles[row] = value;
+            } else if (inf.numeric) {
+                if (!missing)
+                    parse_number(cell, value, integer);
+                if (c.type == INT32)
+                    c.ints[row] = (int32_t)value;
+                else
+                    c.floats[row] = (float)value;
+            } else if (inf.boolean) {
+                c.ints[row] = parse_bool(cell);
+                value = c.ints[row];
+            } else {
+                auto found = ordinals[i].emplace(missing ? std::string() : cell.text(),
+                                                 (int32_t)c.labels.size());
+                if (found.second)
+                    c.labels.push_back(found.first->first);
+                c.ints[row] = found.first->second;
+                value = c.ints[row];
+            }
+            if (value < c.min)
+                c.min = value;
+            if (value > c.max)
+                c.max = value;
+        }
+        row++;
+    }
+
+    // the whole file is one chunk
+    _chunk_rows = _rows ? _rows : 1;
+    for (Column &c : _columns) {
+        if (c.min > c.max)
+            c.min = c.max = 0;
+        switch (c.type) {
+            case INT32:     c.data = (const char*)c.ints.data();    break;
+            case FLOAT:     c.data = (const char*)c.floats.data();  break;
+            case DOUBLE:    c.data = (const char*)c.doubles.data(); break;
+        }
+        if (c.is_date) {
+            c.unit = "seconds";
+            _timeline.resize(_rows);
+            // rows before the first valid timestamp take its value
+            double last = 0;
+            for (double t : c.doubles) {
+                if (t == t) {
+                    last = t;
+                    break;
+                }
+            }
+            for (size_t r = 0; r < _rows; r++) {
+                if (c.doubles[r] > last)
+                    last = c.doubles[r];
+                _timeline[r] = last;
+            }
+            _timeline_data = _timeline.data();
+        }
+    }
+    return true;
+}
+
+static uint64_t page_align(uint64_t offset)
+{
+    return (offset + 4095) & ~(uint64_t)4095;
+}
+
+static bool write_at(FILE *file, uint64_t offset, const void *data, size_t bytes)
+{
+    return !fseeko(file, (off_t)offset, SEEK_SET) && fwrite(data, 1, bytes, file) == bytes;
+}
+
+// names and labels may hold anything a quoted CSV cell can
+static std::string schema_text(std::string s)
+{
+    for (char &ch : s)
+        ch = ch == '\t' || ch == '\n' || ch == '\x1f' ? ' ' : ch;
+    return s;
+}
+
+bool Dataset::save_binary(const char *path)
+{
+    std::string schema;
+    for (const Column &c : _columns) {
+        char range[64];
+        snprintf(range, sizeof(range), "%.17g\t%.17g", c.min, c.max);
+        schema += schema_text(c.name) + "\t" + std::to_string((int)c.type) + "\t"
+                + (c.is_date ? "1" : "0") + "\t" + c.unit + "\t" + range + "\t";
+        for (size_t i = 0; i < c.labels.size(); i++)
+            schema += (i ? "\x1f" : "") + schema_text(c.labels[i]);
+        schema += "\n";
+    }
+
+    BinaryHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DATASET_MAGIC, sizeof(h.magic));
+    h.version = DATASET_VERSION;
+    h.columns = (uint32_t)_columns.size();
+    h.rows = _rows;
+    h.chunk_rows = DATASET_CHUNK_ROWS;
+    for (const Column &c : _columns)
+        h.chunk_bytes += type_size(c.type) * DATASET_CHUNK_ROWS;
+    h.schema_offset = sizeof(h);
+    h.schema_bytes = schema.size();
+    uint64_t offset = page_align(h.schema_offset + h.schema_bytes);
+    if (_timeline_data) {
+        h.timeline_offset = offset;
+        offset = page_align(offset + _rows * sizeof(double));
+    }
+    h.data_offset = offset;
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        _error = std::string("could not create ") + path;
+        return false;
+    }
+    bool ok = write_at(file, 0, &h, sizeof(h))
+           && write_at(file, h.schema_offset, schema.data(), schema.size());
+    if (ok && _timeline_data)
+        ok = write_at(file, h.timeline_offset, _timeline_data, _rows * sizeof(double));
+
+    // the last chunk is written short and padded by the file size below
+    size_t chunks = (_rows + DATASET_CHUNK_ROWS - 1) / DATASET_CHUNK_ROWS;
+    for (size_t k = 0; ok && k < chunks; k++) {
+        uint64_t at = h.data_offset + k * h.chunk_bytes;
+        size_t first = k * DATASET_CHUNK_ROWS;
+        size_t n = std::min((size_t)DATASET_CHUNK_ROWS, _rows - first);
+        for (const Column &c : _columns) {
+            size_t size = type_size(c.type);
+            ok = ok && write_at(file, at, c.data + first * size, n * size);
+            at += size * DATASET_CHUNK_ROWS;
+        }
+    }
+    ok = ok && !fflush(file) && !ftruncate(fileno(file), (off_t)(h.data_offset + chunks * h.chunk_bytes));
+    if (fclose(file) || !ok) {
+        _error = std::string("could not write ") + path;
+        return false;
+    }
+    return true;
+}
+
+/* Only the header and schema are read here; rows and the time index are
+ * paged in by the kernel as playback or a seek touches them. */
+bool Dataset::open_binary(const char *path)
+{
+    close();
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) || (size_t)st.st_size < sizeof(BinaryHeader)) {
+        _error = std::string("could not open ") + path;
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        _error = std::string("could not map ") + path;
+        return false;
+    }
+    _map = map;
+    _map_bytes = st.st_size;
+
+    const char *base = (const char*)map;
+    const BinaryHeader &h = *(const BinaryHeader*)base;
+    size_t chunks = h.chunk_rows ? (h.rows + h.chunk_rows - 1) / h.chunk_rows : 0;
+    if (memcmp(h.magic, DATASET_MAGIC, sizeof(h.magic)) || h.version != DATASET_VERSION
+        || !h.chunk_rows || h.schema_offset + h.schema_bytes > _map_bytes
+        || (h.timeline_offset && h.timeline_offset + h.rows * sizeof(double) > _map_bytes)
+        || h.data_offset + chunks * h.chunk_bytes > _map_bytes) {
+        _error = std::string(path) + " is not a dataset or is truncated";
+        close();
+        return false;
+    }
+
+    std::string schema(base + h.schema_offset, h.schema_bytes);
+    size_t line = 0, column_offset = 0;
+    for (uint32_t i = 0; i < h.columns; i++) {
+        size_t eol = schema.find('\n', line);
+        if (eol == std::string::npos)
+            break;
+        std::vector<std::string> fields;
+        for (size_t p = line; p <= eol; ) {
+            size_t tab = schema.find('\t', p);
+            if (tab == std::string::npos || tab > eol)
+                tab = eol;
+            fields.push_back(schema.substr(p, tab - p));
+            p = tab + 1;
+        }
+        line = eol + 1;
+        if (fields.size() < 7)
+            break;
+
+        Column c;
+        c.name = fields[0];
+        c.type = (Type)atoi(fields[1].c_str());
+        c.is_date = fields[2] == "1";
+        c.unit = fields[3];
+        c.min = strtod(fields[4].c_str(), nullptr);
+        c.max = strtod(fields[5].c_str(), nullptr);
+        for (size_t p = 0; !fields[6].empty() && p <= fields[6].size(); ) {
+            size_t sep = fields[6].find('\x1f', p);
+            if (sep == std::string::npos)
+                sep = fields[6].size();
+            c.labels.push_back(fields[6].substr(p, sep - p));
+            p = sep + 1;
+        }
+        c.data = base + h.data_offset + column_offset;
+        c.stride = h.chunk_bytes;
+        column_offset += type_size(c.type) * h.chunk_rows;
+        _columns.push_back(c);
+    }
+    if (_columns.size() != h.columns || column_offset != h.chunk_bytes) {
+        _error = std::string(path) + " has a damaged schema";
+        close();
+        return false;
+    }
+    _rows = h.rows;
+    _chunk_rows = h.chunk_rows;
+    if (h.timeline_offset)
+        _timeline_data = (const double*)(base + h.timeline_offset);
+    return true;
+}
@@ -0,0 +1,154 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+/* A dataset held as typed columns, so that playback publishes a row by     *
+ * reading one element from each column. It is either loaded from CSV once  *
+ * or mapped from the binary format written by save_binary(), which starts  *
+ * in constant time and pages data in as it is played.                      *
+ *                                                                          *
+ * Types are fixed at load time: integer columns stay INT32, other numbers  *
+ * become FLOAT (empty cells are NaN), the date column becomes seconds      *
+ * since the epoch as DOUBLE, and text becomes INT32 ordinals in order of   *
+ * first appearance. A unit in brackets at the end of a column name is      *
+ * kept as the column's unit.                                               */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define DATASET_MAGIC "DSBIN001"
+#define DATASET_VERSION 1
+#define DATASET_CHUNK_ROWS 4096 // rows per chunk in the binary format
+
+namespace dataset {
+
+enum Type {
+    INT32,
+    FLOAT,
+    DOUBLE
+};
+
+struct Column
+{
+    Column() : type(FLOAT), is_date(false), min(0), max(0), data(nullptr), stride(0) {}
+
+    std::string name;
+    Type type;
+    bool is_date;
+    std::string unit;
+    // text columns: the string behind each ordinal
+    std::vector<std::string> labels;
+    double min, max;
+
+    /* row r lives at data + (r / chunk_rows) * stride + (r % chunk_rows) *
+     * size; a column loaded from CSV is a single chunk */
+    const char *data;
+    size_t stride;
+
+    // storage of a column loaded from CSV, only the one matching type
+    std::vector<int32_t> ints;
+    std::vector<float> floats;
+    std::vector<double> doubles;
+};
+
+/* Binary layout, little endian. The header is followed by the schema, one
+ * line per column: name, type, is_date, unit, min and max separated by
+ * tabs, then the labels separated by 0x1f. Then the time index, the date
+ * column with NaN and backwards steps held at the previous value, as
+ * f64[rows]. Then the data, as fixed-size chunks of chunk_rows rows that
+ * hold each column's values contiguously in column order, so a row's
+ * offset in any column is arithmetic. Sections start on 4 KiB boundaries. */
+struct BinaryHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t columns;
+    uint64_t rows;
+    uint64_t chunk_rows;
+    uint64_t chunk_bytes;
+    uint64_t schema_offset, schema_bytes;
+    uint64_t timeline_offset;   // 0 without a date column
+    uint64_t data_offset;
+};
+
+class Dataset
+{
+public:
+    Dataset();
+    ~Dataset();
+
+    // date_column is the index of the column to parse as dates, or -1;
+    // returns false with a message in error() if the file cannot be read
+    bool load_csv(const char *path, int date_column = -1);
+    bool save_binary(const char *path);
+    bool open_binary(const char *path);
+    // either of the above, told apart by the file's first bytes
+    bool load(const char *path, int date_column = -1);
+
+    size_t rows() const { return _rows; }
+    const std::vector<Column> &columns() const { return _columns; }
+    const std::string &error() const { return _error; }
+
+    /* the date column made non-decreasing, for scheduling and seeking by
+     * time; null without a date column */
+    const double *timeline() const { return _timeline_data; }
+    int date_column() const;
+
+    double value(size_t column, size_t row) const
+    {
+        const Column &c = _columns[column];
+        const char *p = c.data + (row / _chunk_rows) * c.stride;
+        size_t offset = row % _chunk_rows;
+        switch (c.type) {
+            case INT32:     return ((const int32_t*)p)[offset];
+            case FLOAT:     return ((const float*)p)[offset];
+            default:        return ((const double*)p)[offset];
+        }
+    }
+
+    /* f(column index, value) for every column of a row, with value an
+     * int32_t, float or double according to the column type */
+    template <class F>
+    void visit_row(size_t row, F &f) const
+    {
+        size_t chunk = row / _chunk_rows, offset = row % _chunk_rows;
+        for (size_t i = 0; i < _columns.size(); i++) {
+            const Column &c = _columns[i];
+            const char *p = c.data + chunk * c.stride;
+            switch (c.type) {
+                case INT32:     f(i, ((const int32_t*)p)[offset]);  break;
+                case FLOAT:     f(i, ((const float*)p)[offset]);    break;
+                case DOUBLE:    f(i, ((const double*)p)[offset]);   break;
+            }
+        }
+    }
+
+private:
+    Dataset(const Dataset&);
+    Dataset &operator=(const Dataset&);
+    void close();
+
+    size_t _rows, _chunk_rows;
+    std::vector<Column> _columns;
+    std::vector<double> _timeline;
+    const double *_timeline_data;
+    std::string _error;
+    void *_map;
+    size_t _map_bytes;
+};
+
+size_t type_size(Type type);
+
+/* seconds since the epoch for "YYYY-MM-DD[ T]HH:MM[:SS[.fff]][Z|±HH:MM]"
+ * or a plain number, read as local time without a zone like pandas does
+ * for naive timestamps; NaN if the text is not a date */
+double parse_date(const char *begin, const char *end);
+
+/* name without a trailing unit in brackets, as in "speed (km/h)" or
+ * "speed [km/h]", with the unit stored in unit; names without one are
+ * returned whole and unit is left alone */
+std::string strip_unit(const std::string &name, std::string &unit);
+
+} // namespace dataset
+
+#endif // DATASET_H
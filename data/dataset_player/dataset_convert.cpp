@@ -0,0 +1,34 @@
+/* One-time conversion of a CSV dataset to the binary format, which         *
+ * dataset_player maps instead of parsing on every start.                   */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "dataset.h"
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        printf("usage: dataset_convert <dataset.csv> <dataset.dsb> [date column]\n");
+        return 1;
+    }
+    dataset::Dataset data;
+    auto start = std::chrono::steady_clock::now();
+    if (!data.load_csv(argv[1], argc > 3 ? atoi(argv[3]) : -1)) {
+        printf("%s\n", data.error().c_str());
+        return 1;
+    }
+    double load = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("read %zu rows of %zu columns in %.1f s\n", data.rows(), data.columns().size(), load);
+    for (const dataset::Column &c : data.columns()) {
+        const char *kind = c.is_date ? "date" : !c.labels.empty() ? "ordinal"
+                         : c.type == dataset::INT32 ? "int32" : c.type == dataset::FLOAT ? "float" : "double";
+        printf("  %s: %s [%g, %g]\n", c.name.c_str(), kind, c.min, c.max);
+    }
+    if (!data.save_binary(argv[2])) {
+        printf("%s\n", data.error().c_str());
+        return 1;
+    }
+    printf("wrote %s\n", argv[2]);
+    return 0;
+}
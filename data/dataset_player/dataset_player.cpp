@@ -0,0 +1,421 @@
+/* Native counterpart of dataset_player.py with the same arguments and      *
+ * signals: the dataset is converted to typed columns once at startup, and  *
+ * each write to the "index" input publishes that row's cells directly from *
+ * the column arrays. With a date column the rows are also played back in   *
+ * real time from their timestamps, under the rate, pause, loop and seek    *
+ * inputs; without one, rate is in rows per second and starts at 0. With    *
+ * --tick <hz> the columns are instead sampled between rows at a fixed      *
+ * output rate, interpolated per column (see interpolate.h). Related        *
+ * columns are published together as vector signals (see schema.h).        */
+
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <mapper/mapper.h>
+#include "dataset.h"
+#include "interpolate.h"
+#include "scheduler.h"
+#include "schema.h"
+
+#define POLL_SLACK_MS 2     // stop polling this long before a deadline, as polls overrun
+#define REPORT_SEC 5        // how often timing errors are printed
+
+int done = 0;
+
+class Player
+{
+public:
+    // signals names a schema file, otherwise the dataset's sidecar is used if present
+    Player(const char *filename, int date_column, const char *signals = NULL);
+    ~Player();
+
+    bool ok() const { return _dev != NULL; }
+    /* sample between rows at tick_hz; columns are named as in the file or
+     * as their signals, and quaternions are given as "w,x,y,z" */
+    bool interpolate(double tick_hz, dataset::Mode mode,
+                     const std::vector<std::string> &column_modes,
+                     const std::vector<std::string> &quaternions);
+    // publish a row at once and continue playback after it
+    void jump(int index);
+    void poll();
+    dataset::Scheduler &scheduler() { return *_sched; }
+
+    /* each cell is stored at its element of its signal's buffer, converted
+     * if the signal is wider than the column; publishing never allocates */
+    template <class T>
+    void operator()(size_t col, T value)
+    {
+        const Slot &slot = _slots[col];
+        switch (slot.type) {
+            case dataset::INT32:    *(int32_t*)slot.dst = (int32_t)value;   break;
+            case dataset::FLOAT:    *(float*)slot.dst = (float)value;       break;
+            case dataset::DOUBLE:   *(double*)slot.dst = (double)value;     break;
+        }
+    }
+
+private:
+    void publish(size_t row, double frac = 0);
+    void report();
+    int find_column(const std::string &name) const;
+
+    dataset::Dataset _data;
+    dataset::Scheduler *_sched;
+    dataset::Interpolator *_interp;
+    mpr_dev _dev;
+
+    struct Output
+    {
+        mpr_sig sig;
+        mpr_type type;
+        int len;
+        std::vector<char> values;
+    };
+    // where a column's cells go; omitted columns go to _scratch
+    struct Slot
+    {
+        char *dst;
+        dataset::Type type;
+    };
+    std::vector<Output> _outputs;
+    std::vector<Slot> _slots;
+    double _scratch;
+};
+
+Player *player = NULL;
+
+void index_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                   mpr_type type, const void *val, mpr_time time)
+{
+    if (val)
+        player->jump(*(const int*)val);
+}
+
+void rate_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                  mpr_type type, const void *val, mpr_time time)
+{
+    if (val)
+        player->scheduler().set_rate(*(const float*)val);
+}
+
+void pause_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                   mpr_type type, const void *val, mpr_time time)
+{
+    if (val)
+        player->scheduler().set_paused(*(const int*)val != 0);
+}
+
+void loop_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                  mpr_type type, const void *val, mpr_time time)
+{
+    if (val)
+        player->scheduler().set_loop(*(const int*)val != 0);
+}
+
+void seek_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                  mpr_type type, const void *val, mpr_time time)
+{
+    if (val)
+        player->scheduler().seek_time(*(const float*)val);
+}
+
+Player::Player(const char *filename, int date_column, const char *signals)
+: _sched(NULL), _interp(NULL), _dev(NULL)
+{
+    // device named after the file, without directories or extension
+    std::string devname = filename;
+    size_t slash = devname.find_last_of('/');
+    if (slash != std::string::npos)
+        devname = devname.substr(slash + 1);
+    devname = devname.substr(0, devname.find('.'));
+
+    printf("trying to read file: %s\n", filename);
+    if (!_data.load(filename, date_column)) {
+        printf("%s\n", _data.error().c_str());
+        return;
+    }
+    if (!_data.rows()) {
+        printf("%s has no rows\n", filename);
+        return;
+    }
+    printf("loaded %zu rows of %zu columns\n", _data.rows(), _data.columns().size());
+
+    const double *times = _data.timeline();
+    _sched = new dataset::Scheduler(times, _data.rows(), times ? 1 : 0);
+    if (times)
+        printf("playing %.1f s of data in real time\n", _sched->offset(_data.rows() - 1));
+
+    printf("trying to create device with name: %s\n", devname.c_str());
+    _dev = mpr_dev_new(devname.c_str(), 0);
+
+    int zero = 0;
+    mpr_sig index = mpr_sig_new(_dev, MPR_DIR_IN, "index", 1, MPR_INT32, NULL, NULL, NULL,
+                                NULL, index_handler, MPR_SIG_UPDATE);
+    mpr_sig_set_value(index, 0, 1, MPR_INT32, &zero);
+
+    // playback controls
+    float rate = (float)_sched->rate(), minf = 0, maxf = 100;
+    int mini = 0, maxi = 1;
+    mpr_sig sig = mpr_sig_new(_dev, MPR_DIR_IN, "rate", 1, MPR_FLT, times ? NULL : "rows/s",
+                              &minf, times ? &maxf : NULL, NULL, rate_handler, MPR_SIG_UPDATE);
+    mpr_sig_set_value(sig, 0, 1, MPR_FLT, &rate);
+    sig = mpr_sig_new(_dev, MPR_DIR_IN, "pause", 1, MPR_INT32, NULL, &mini, &maxi,
+                      NULL, pause_handler, MPR_SIG_UPDATE);
+    mpr_sig_set_value(sig, 0, 1, MPR_INT32, &zero);
+    sig = mpr_sig_new(_dev, MPR_DIR_IN, "loop", 1, MPR_INT32, NULL, &mini, &maxi,
+                      NULL, loop_handler, MPR_SIG_UPDATE);
+    mpr_sig_set_value(sig, 0, 1, MPR_INT32, &zero);
+    maxf = (float)_sched->offset(_data.rows() - 1);
+    mpr_sig_new(_dev, MPR_DIR_IN, "seek", 1, MPR_FLT, times ? "seconds" : "rows", &minf, &maxf,
+                NULL, seek_handler, MPR_SIG_UPDATE);
+
+    dataset::Schema schema;
+    std::string config = signals ? signals : dataset::Schema::sidecar(filename);
+    if (!schema.build(_data, config.c_str(), signals != NULL)) {
+        printf("%s\n", schema.error().c_str());
+        mpr_dev_free(_dev);
+        _dev = NULL;
+        return;
+    }
+
+    // each signal's elements are written into its buffer, then sent whole
+    _outputs.resize(schema.signals().size());
+    Slot omitted = {(char*)&_scratch, dataset::DOUBLE};
+    _slots.assign(_data.columns().size(), omitted);
+    for (size_t i = 0; i < schema.signals().size(); i++) {
+        const dataset::Signal &s = schema.signals()[i];
+        Output &out = _outputs[i];
+        int len = (int)s.columns.size();
+        out.len = len;
+        out.values.resize(len * dataset::type_size(s.type));
+        for (int e = 0; e < len; e++) {
+            _slots[s.columns[e]].type = s.type;
+            _slots[s.columns[e]].dst = &out.values[e * dataset::type_size(s.type)];
+        }
+        const char *unit = s.unit.empty() ? NULL : s.unit.c_str();
+        switch (s.type) {
+            case dataset::INT32: {
+                std::vector<int> min(s.min.begin(), s.min.end()), max(s.max.begin(), s.max.end());
+                out.type = MPR_INT32;
+                out.sig = mpr_sig_new(_dev, MPR_DIR_OUT, s.name.c_str(), len, MPR_INT32, unit,
+                                      min.data(), max.data(), NULL, NULL, 0);
+                break;
+            }
+            case dataset::FLOAT: {
+                std::vector<float> min(s.min.begin(), s.min.end()), max(s.max.begin(), s.max.end());
+                out.type = MPR_FLT;
+                out.sig = mpr_sig_new(_dev, MPR_DIR_OUT, s.name.c_str(), len, MPR_FLT, unit,
+                                      min.data(), max.data(), NULL, NULL, 0);
+                break;
+            }
+            case dataset::DOUBLE: {
+                // float would round seconds since the epoch to minutes
+                std::vector<double> min(s.min), max(s.max);
+                out.type = MPR_DBL;
+                out.sig = mpr_sig_new(_dev, MPR_DIR_OUT, s.name.c_str(), len, MPR_DBL, unit,
+                                      min.data(), max.data(), NULL, NULL, 0);
+                break;
+            }
+        }
+
+        const dataset::Column &c = _data.columns()[s.columns[0]];
+        const char *kind = c.is_date ? "date" : len == 1 && !c.labels.empty() ? "ordinal"
+                         : s.type == dataset::INT32 ? "int32" : s.type == dataset::FLOAT ? "float" : "double";
+        if (len == 1) {
+            printf("signal %s: %s%s%s [%g, %g]\n", s.name.c_str(), kind, unit ? " " : "",
+                   unit ? unit : "", s.min[0], s.max[0]);
+        } else {
+            printf("signal %s: %s[%d]%s%s from", s.name.c_str(), kind, len, unit ? " " : "",
+                   unit ? unit : "");
+            for (int e = 0; e < len; e++)
+                printf("%s %s", e ? "," : "", _data.columns()[s.columns[e]].name.c_str());
+            printf("\n");
+        }
+        if (len == 1 && !c.labels.empty() && c.labels.size() <= 16) {
+            for (size_t l = 0; l < c.labels.size(); l++)
+                printf("    %zu = %s\n", l, c.labels[l].c_str());
+        }
+    }
+    printf("publishing %zu columns as %zu signals\n", _data.columns().size(), _outputs.size());
+}
+
+Player::~Player()
+{
+    if (_dev)
+        mpr_dev_free(_dev);
+    delete _interp;
+    delete _sched;
+}
+
+int Player::find_column(const std::string &name) const
+{
+    for (size_t i = 0; i < _data.columns().size(); i++) {
+        std::string sig_name = _data.columns()[i].name;
+        std::replace(sig_name.begin(), sig_name.end(), ' ', '_');
+        if (_data.columns()[i].name == name || sig_name == name)
+            return (int)i;
+    }
+    printf("no column named %s\n", name.c_str());
+    return -1;
+}
+
+bool Player::interpolate(double tick_hz, dataset::Mode mode,
+                         const std::vector<std::string> &column_modes,
+                         const std::vector<std::string> &quaternions)
+{
+    _interp = new dataset::Interpolator(_data, mode);
+    for (const std::string &spec : column_modes) {
+        size_t eq = spec.find('=');
+        dataset::Mode column_mode;
+        int col = eq == std::string::npos ? -1 : find_column(spec.substr(0, eq));
+        if (col < 0 || !dataset::parse_mode(spec.substr(eq + 1), column_mode)
+            || !_interp->set_mode(col, column_mode)) {
+            printf("cannot interpolate %s\n", spec.c_str());
+            return false;
+        }
+    }
+    for (const std::string &spec : quaternions) {
+        size_t cols[4], start = 0;
+        int n = 0;
+        for (; n < 4 && start <= spec.size(); n++) {
+            size_t comma = std::min(spec.find(',', start), spec.size());
+            int col = find_column(spec.substr(start, comma - start));
+            if (col < 0)
+                break;
+            cols[n] = col;
+            start = comma + 1;
+        }
+        if (n != 4 || start <= spec.size() || !_interp->add_quaternion(cols)) {
+            printf("cannot interpolate quaternion %s\n", spec.c_str());
+            return false;
+        }
+    }
+    _sched->set_tick_period((int64_t)llround(1e9 / tick_hz));
+    printf("sampling at %g Hz\n", tick_hz);
+    return true;
+}
+
+void Player::publish(size_t row, double frac)
+{
+    if (_interp && frac > 0) {
+        _interp->evaluate(row, frac);
+        _interp->visit(*this);
+    } else {
+        _data.visit_row(row, *this);
+    }
+    for (const Output &out : _outputs)
+        mpr_sig_set_value(out.sig, 0, out.len, out.type, out.values.data());
+    mpr_dev_update_maps(_dev);
+}
+
+void Player::jump(int index)
+{
+    // modulo index for easy looping, as in the Python player
+    int rows = (int)_data.rows();
+    index %= rows;
+    if (index < 0)
+        index += rows;
+    // the row is sent now and the rows after it follow on its timeline
+    _sched->seek(index);
+    int64_t now = dataset::now_ns();
+    publish(index);
+    _sched->sent(now, now);
+}
+
+/* Control inputs are polled while waiting for the next row, but the poll
+ * hands back well before the deadline, which is then met by sleeping and
+ * spinning on the clock. */
+void Player::poll()
+{
+    int64_t report_at = dataset::now_ns() + (int64_t)REPORT_SEC * 1000000000;
+    while (!done) {
+        mpr_dev_poll(_dev, 0);
+        size_t row;
+        double frac;
+        int64_t due;
+        if (!_sched->next(row, frac, due)) {
+            mpr_dev_poll(_dev, 10);
+        } else {
+            int64_t wait_ms = (due - dataset::now_ns()) / 1000000;
+            if (wait_ms > POLL_SLACK_MS) {
+                mpr_dev_poll(_dev, (int)std::min<int64_t>(wait_ms - POLL_SLACK_MS, 10));
+                continue;
+            }
+            int64_t now = dataset::sleep_until(due);
+            publish(row, frac);
+            _sched->sent(due, now);
+        }
+        if (dataset::now_ns() >= report_at) {
+            report();
+            report_at += (int64_t)REPORT_SEC * 1000000000;
+        }
+    }
+}
+
+void Player::report()
+{
+    dataset::Scheduler::Report r = _sched->report();
+    if (!r.sent)
+        return;
+    printf("sent %lu %s, timing error mean %.1f us, max %.1f us, %lu late, %lu resyncs\n",
+           r.sent, _interp ? "ticks" : "rows", r.mean_error_us, r.max_error_us, r.late, r.resyncs);
+    fflush(stdout);
+}
+
+void handler_done(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<const char*> args;
+    std::vector<std::string> column_modes, quaternions;
+    const char *signals = NULL;
+    double tick_hz = 0;
+    dataset::Mode mode = dataset::LINEAR;
+    for (int i = 1; i < argc; i++) {
+        bool more = i + 1 < argc;
+        if (strcmp(argv[i], "--tick") == 0 && more) {
+            tick_hz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--interpolate") == 0 && more) {
+            if (!dataset::parse_mode(argv[++i], mode)) {
+                printf("unknown interpolation %s, use hold, linear or cubic\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--signals") == 0 && more) {
+            signals = argv[++i];
+        } else if (strcmp(argv[i], "--column") == 0 && more) {
+            column_modes.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "--quaternion") == 0 && more) {
+            quaternions.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printf("dataset_player <filename> [date column] [--signals <file>] [--tick <hz>] "
+                   "[--interpolate hold|linear|cubic] [--column <name>=<mode>] "
+                   "[--quaternion <w>,<x>,<y>,<z>]\n");
+            return 0;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.empty()) {
+        printf("dataset_player requires a dataset file\n");
+        return 1;
+    }
+    signal(SIGINT, handler_done);
+    signal(SIGTERM, handler_done);
+
+    player = new Player(args[0], args.size() > 1 ? atoi(args[1]) : -1, signals);
+    bool ok = player->ok();
+    if (ok && tick_hz > 0)
+        ok = player->interpolate(tick_hz, mode, column_modes, quaternions);
+    if (ok)
+        player->poll();
+    delete player;
+    printf("done\n");
+    return 0;
+}
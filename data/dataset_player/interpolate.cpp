@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cmath>
+#include "interpolate.h"
+
+using namespace dataset;
+
+bool dataset::parse_mode(const std::string &name, Mode &mode)
+{
+    if (name == "hold")
+        mode = HOLD;
+    else if (name == "linear")
+        mode = LINEAR;
+    else if (name == "cubic")
+        mode = CUBIC;
+    else
+        return false;
+    return true;
+}
+
+Interpolator::Interpolator(const Dataset &data, Mode default_mode)
+: _data(data)
+{
+    size_t n = data.columns().size();
+    for (const Column &c : data.columns()) {
+        bool numeric = c.type != INT32 && c.labels.empty();
+        _modes.push_back(numeric && default_mode != SLERP ? default_mode : HOLD);
+    }
+    _p0.resize(n);
+    _p1.resize(n);
+    _p2.resize(n);
+    _p3.resize(n);
+    _out.resize(n);
+    regroup();
+}
+
+bool Interpolator::set_mode(size_t column, Mode mode)
+{
+    if (column >= _modes.size() || mode == SLERP || !_data.columns()[column].labels.empty())
+        return false;
+    _modes[column] = mode;
+    regroup();
+    return true;
+}
+
+bool Interpolator::add_quaternion(const size_t columns[4])
+{
+    for (int i = 0; i < 4; i++) {
+        if (columns[i] >= _modes.size() || !_data.columns()[columns[i]].labels.empty()
+            || _modes[columns[i]] == SLERP)
+            return false;
+    }
+    for (int i = 0; i < 4; i++) {
+        _modes[columns[i]] = SLERP;
+        _quaternions.push_back(columns[i]);
+    }
+    regroup();
+    return true;
+}
+
+void Interpolator::regroup()
+{
+    _hold.clear();
+    _linear.clear();
+    _cubic.clear();
+    for (size_t i = 0; i < _modes.size(); i++) {
+        switch (_modes[i]) {
+            case HOLD:      _hold.push_back(i);     break;
+            case LINEAR:    _linear.push_back(i);   break;
+            case CUBIC:     _cubic.push_back(i);    break;
+            case SLERP:                             break;
+        }
+    }
+}
+
+void Interpolator::evaluate(size_t row, double frac)
+{
+    size_t last = _data.rows() ? _data.rows() - 1 : 0;
+    size_t r1 = row < last ? row + 1 : last;
+    double t = frac;
+
+    for (size_t i : _hold)
+        _out[i] = _data.value(i, row);
+
+    // gather, then one loop per mode over contiguous arrays
+    size_t n = _linear.size();
+    for (size_t k = 0; k < n; k++) {
+        _p1[k] = _data.value(_linear[k], row);
+        _p2[k] = _data.value(_linear[k], r1);
+    }
+    for (size_t k = 0; k < n; k++)
+        _p0[k] = _p1[k] + (_p2[k] - _p1[k]) * t;
+    for (size_t k = 0; k < n; k++)
+        _out[_linear[k]] = _p0[k];
+
+    // the end rows stand in for their missing neighbours
+    size_t r0 = row ? row - 1 : 0, r2 = r1 < last ? r1 + 1 : last;
+    n = _cubic.size();
+    for (size_t k = 0; k < n; k++) {
+        _p0[k] = _data.value(_cubic[k], r0);
+        _p1[k] = _data.value(_cubic[k], row);
+        _p2[k] = _data.value(_cubic[k], r1);
+        _p3[k] = _data.value(_cubic[k], r2);
+    }
+    /* non-uniform Catmull-Rom: the tangent at a row is the slope between its
+     * neighbours over their time apart, in units of this span (0.5 when the
+     * rows are evenly spaced). A steep step next to a long span still bends
+     * past the rows, so tangents are then limited as Fritsch and Carlson do,
+     * to the direction of the span and three times its rise, which keeps
+     * the curve between the two rows. */
+    const double *times = _data.timeline();
+    double t0 = times ? times[r0] : r0, t1 = times ? times[row] : row;
+    double t2 = times ? times[r1] : r1, t3 = times ? times[r2] : r2;
+    double span = t2 - t1;
+    double s1 = t2 > t0 ? span / (t2 - t0) : 0, s2 = t3 > t1 ? span / (t3 - t1) : 0;
+    double tt = t * t, ttt = tt * t;
+    double h00 = 2 * ttt - 3 * tt + 1, h10 = ttt - 2 * tt + t, h01 = -2 * ttt + 3 * tt, h11 = ttt - tt;
+    for (size_t k = 0; k < n; k++) {
+        double m1 = (_p2[k] - _p0[k]) * s1, m2 = (_p3[k] - _p1[k]) * s2;
+        double rise = _p2[k] - _p1[k], lo = std::min(0.0, 3 * rise), hi = std::max(0.0, 3 * rise);
+        m1 = std::min(std::max(m1, lo), hi);
+        m2 = std::min(std::max(m2, lo), hi);
+        _p0[k] = h00 * _p1[k] + h10 * m1 + h01 * _p2[k] + h11 * m2;
+    }
+    for (size_t k = 0; k < n; k++)
+        _out[_cubic[k]] = _p0[k];
+
+    for (size_t g = 0; g + 4 <= _quaternions.size(); g += 4) {
+        const size_t *cols = &_quaternions[g];
+        double a[4], b[4], dot = 0, na = 0, nb = 0;
+        for (int i = 0; i < 4; i++) {
+            a[i] = _data.value(cols[i], row);
+            b[i] = _data.value(cols[i], r1);
+            na += a[i] * a[i];
+            nb += b[i] * b[i];
+        }
+        na = na > 0 ? 1 / sqrt(na) : 0;
+        nb = nb > 0 ? 1 / sqrt(nb) : 0;
+        for (int i = 0; i < 4; i++) {
+            a[i] *= na;
+            b[i] *= nb;
+            dot += a[i] * b[i];
+        }
+        // q and -q are the same rotation; take the short way round
+        if (dot < 0) {
+            dot = -dot;
+            for (int i = 0; i < 4; i++)
+                b[i] = -b[i];
+        }
+        double wa = 1 - t, wb = t;
+        if (dot < 0.9995) {
+            double theta = acos(dot), s = 1 / sin(theta);
+            wa = sin((1 - t) * theta) * s;
+            wb = sin(t * theta) * s;
+        }
+        // nearly parallel: lerp, normalised below
+        double q[4], nq = 0;
+        for (int i = 0; i < 4; i++) {
+            q[i] = wa * a[i] + wb * b[i];
+            nq += q[i] * q[i];
+        }
+        nq = nq > 0 ? 1 / sqrt(nq) : 0;
+        for (int i = 0; i < 4; i++)
+            _out[cols[i]] = q[i] * nq;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef INTERPOLATE_H
+#define INTERPOLATE_H
+
+/* Sampling a dataset between rows, for playback at an output rate of its   *
+ * own. Columns are grouped by mode and each group is evaluated in one loop *
+ * over gathered neighbour rows, so a tick costs a few passes over flat     *
+ * arrays rather than a dispatch per cell.                                  */
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include "dataset.h"
+
+namespace dataset {
+
+enum Mode {
+    HOLD,       // the value of the row at or before the position
+    LINEAR,
+    CUBIC,      // Catmull-Rom through the neighbouring rows, by time, without overshoot
+    SLERP       // spherical, for four columns holding a quaternion
+};
+
+// "hold", "linear" or "cubic"; false if name is none of these
+bool parse_mode(const std::string &name, Mode &mode);
+
+class Interpolator
+{
+public:
+    /* numeric FLOAT and DOUBLE columns start in default_mode; INT32 columns
+     * hold, and text ordinals always do, as values between them mean nothing */
+    Interpolator(const Dataset &data, Mode default_mode = LINEAR);
+
+    // returns false for text columns, or SLERP, which needs a group
+    bool set_mode(size_t column, Mode mode);
+    // w, x, y, z columns interpolated together as a unit quaternion
+    bool add_quaternion(const size_t columns[4]);
+
+    // sample every column at row + frac, with 0 <= frac < 1
+    void evaluate(size_t row, double frac);
+
+    /* f(column index, value) with the last evaluation, typed like
+     * Dataset::visit_row; INT32 columns are rounded */
+    template <class F>
+    void visit(F &f) const
+    {
+        const std::vector<Column> &columns = _data.columns();
+        for (size_t i = 0; i < columns.size(); i++) {
+            switch (columns[i].type) {
+                case INT32:     f(i, (int32_t)lround(_out[i]));  break;
+                case FLOAT:     f(i, (float)_out[i]);            break;
+                case DOUBLE:    f(i, _out[i]);                   break;
+            }
+        }
+    }
+
+private:
+    void regroup();
+
+    const Dataset &_data;
+    std::vector<Mode> _modes;
+    std::vector<size_t> _quaternions;   // four columns per group
+    // columns by mode, rebuilt when a mode changes
+    std::vector<size_t> _hold, _linear, _cubic;
+    // gathered neighbour rows and results, one entry per column
+    std::vector<double> _p0, _p1, _p2, _p3, _out;
+};
+
+} // namespace dataset
+
+#endif // INTERPOLATE_H
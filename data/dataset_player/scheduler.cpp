@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <thread>
+#include <time.h>
+#include "scheduler.h"
+
+using namespace dataset;
+
+int64_t dataset::now_ns()
+{
+#ifdef __linux__
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/* The kernel wakes a sleeper tens of microseconds late, and more under
+ * load, so only the bulk of the wait is slept and the rest spun. On Linux
+ * the sleep is against an absolute deadline, so a signal or an early
+ * wakeup cannot stretch it. */
+int64_t dataset::sleep_until(int64_t deadline, int64_t spin_ns)
+{
+    int64_t wake = deadline - spin_ns, now = now_ns();
+    if (now < wake) {
+#ifdef __linux__
+        struct timespec ts;
+        ts.tv_sec = wake / 1000000000;
+        ts.tv_nsec = wake % 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+#else
+        std::this_thread::sleep_for(std::chrono::nanoseconds(wake - now));
+#endif
+    }
+    while ((now = now_ns()) < deadline)
+        ;
+    return now;
+}
+
+/************************************ Scheduler *************************************/
+
+Scheduler::Scheduler(const double *times, size_t rows, double rate)
+: _times(times), _rows(rows), _rate(rate), _paused(false), _loop(false), _pos(0),
+  _anchor_time(0), _anchor_wall(0), _tick_period(0), _tick(0), _tick_time(0), _loop_gap(0),
+  _sent(0), _late(0), _resyncs(0), _error_sum(0), _error_max(0)
+{
+    if (rows > 1)
+        _loop_gap = (time(rows - 1) - time(0)) / (rows - 1);
+    if (rows)
+        _tick_time = time(0);
+    anchor(now_ns());
+}
+
+double Scheduler::current() const
+{
+    if (_tick_period)
+        return _tick_time;
+    return _pos < rows() ? time(_pos) : _rows ? time(0) : 0;
+}
+
+void Scheduler::anchor(int64_t wall)
+{
+    _anchor_time = current();
+    _anchor_wall = wall;
+    _tick = 0;
+}
+
+int64_t Scheduler::deadline(size_t row) const
+{
+    double seconds = (time(row) - _anchor_time) / _rate;
+    return _anchor_wall + (int64_t)llround(seconds * 1e9);
+}
+
+double Scheduler::playhead(int64_t wall) const
+{
+    if (_paused || _rate <= 0)
+        return _anchor_time;
+    return _anchor_time + (double)(wall - _anchor_wall) * 1e-9 * _rate;
+}
+
+/* Rate changes and pauses take effect at the playhead, not at the next row,
+ * so a controller writing the rate continuously neither fires rows early
+ * nor holds ticks back. Ticks keep their grid: the next one stays due when
+ * it was, at the dataset time the new rate gives it. */
+void Scheduler::reanchor(int64_t wall, double rate)
+{
+    double t = playhead(wall);
+    int64_t next = _anchor_wall + (int64_t)_tick * _tick_period;
+    _rate = rate;
+    if (_tick_period && next > wall) {
+        if (!_paused && _rate > 0)
+            t += (double)(next - wall) * 1e-9 * _rate;
+        wall = next;
+    }
+    _anchor_time = t;
+    _anchor_wall = wall;
+    _tick = 0;
+}
+
+void Scheduler::set_rate(double rate)
+{
+    if (rate != _rate)
+        reanchor(now_ns(), rate);
+}
+
+void Scheduler::set_paused(bool paused)
+{
+    if (paused == _paused)
+        return;
+    reanchor(now_ns(), _rate);
+    _paused = paused;
+}
+
+void Scheduler::set_tick_period(int64_t period)
+{
+    _tick_period = period > 0 ? period : 0;
+    _tick_time = rows() ? time(std::min(_pos, rows() - 1)) : 0;
+    anchor(now_ns());
+}
+
+void Scheduler::seek(size_t row)
+{
+    _pos = rows() ? std::min(row, rows() - 1) : 0;
+    _tick_time = rows() ? time(_pos) : 0;
+    anchor(now_ns());
+}
+
+void Scheduler::seek_time(double seconds)
+{
+    if (!rows())
+        return;
+    if (!_times) {
+        seek(seconds > 0 ? (size_t)ceil(seconds) : 0);
+        return;
+    }
+    seek(std::lower_bound(_times, _times + _rows, _times[0] + seconds) - _times);
+}
+
+bool Scheduler::next(size_t &row, double &frac, int64_t &due)
+{
+    if (_paused || _rate <= 0 || !rows())
+        return false;
+    if (_tick_period)
+        return next_tick(row, frac, due);
+    if (_pos >= rows()) {
+        if (!_loop)
+            return false;
+        // carry the timeline over, so looping does not drift either
+        int64_t wall = deadline(rows() - 1) + (int64_t)llround(_loop_gap / _rate * 1e9);
+        _pos = 0;
+        anchor(wall);
+    }
+    row = _pos;
+    frac = 0;
+    due = deadline(_pos);
+    return true;
+}
+
+bool Scheduler::next_tick(size_t &row, double &frac, int64_t &due)
+{
+    due = _anchor_wall + (int64_t)_tick * _tick_period;
+    double t = _anchor_time + (double)(due - _anchor_wall) * 1e-9 * _rate;
+    if (t > time(rows() - 1)) {
+        if (!_loop) {
+            _pos = rows();
+            return false;
+        }
+        _pos = 0;
+        _tick_time = t = time(0);
+        anchor(due);
+    }
+    // ticks only move forwards between anchors, so this walks a row or two
+    if (_pos >= rows() || time(_pos) > t) {
+        if (_times)
+            _pos = std::upper_bound(_times, _times + _rows, t) - _times;
+        else
+            _pos = t > 0 ? (size_t)t + 1 : 0;
+        _pos = _pos ? _pos - 1 : 0;
+    }
+    while (_pos + 1 < rows() && time(_pos + 1) <= t)
+        ++_pos;
+    row = _pos;
+    double span = _pos + 1 < rows() ? time(_pos + 1) - time(_pos) : 0;
+    frac = span > 0 ? (t - time(_pos)) / span : 0;
+    _tick_time = t;
+    return true;
+}
+
+void Scheduler::sent(int64_t due, int64_t now)
+{
+    double error = (double)(now - due);
+    ++_sent;
+    _error_sum += fabs(error);
+    _error_max = std::max(_error_max, fabs(error));
+    if (error > SCHED_LATE_NS)
+        ++_late;
+    if (_tick_period)
+        ++_tick;
+    else
+        ++_pos;
+    // after a stall, resume from here rather than sending the backlog at once
+    if (error > SCHED_RESYNC_NS && _pos < rows()) {
+        ++_resyncs;
+        anchor(now);
+    }
+}
+
+Scheduler::Report Scheduler::report()
+{
+    Report r;
+    r.sent = _sent;
+    r.late = _late;
+    r.resyncs = _resyncs;
+    r.mean_error_us = _sent ? _error_sum / _sent * 1e-3 : 0;
+    r.max_error_us = _error_max * 1e-3;
+    _sent = _late = _resyncs = 0;
+    _error_sum = _error_max = 0;
+    return r;
+}
@@ -0,0 +1,98 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/* Real-time playback timing for a dataset. Each row gets an absolute        *
+ * deadline on the monotonic clock from its timestamp, the playback rate and *
+ * an anchor that moves only on seek, rate change, pause or loop, so sleep   *
+ * overshoot never accumulates into drift. With a tick period set, the       *
+ * deadlines are instead evenly spaced output ticks, each sampling the       *
+ * dataset at a fractional row. Times are in nanoseconds.                   */
+
+#include <cstddef>
+#include <cstdint>
+
+#define SCHED_SPIN_NS 200000        // spin this long before a deadline instead of sleeping
+#define SCHED_RESYNC_NS 100000000   // re-anchor instead of catching up when this late
+#define SCHED_LATE_NS 1000000       // sends later than this are counted as late
+
+namespace dataset {
+
+int64_t now_ns();
+
+// sleep until spin_ns before deadline, then spin; returns the time reached
+int64_t sleep_until(int64_t deadline, int64_t spin_ns = SCHED_SPIN_NS);
+
+class Scheduler
+{
+public:
+    /* times must be non-decreasing, like Dataset::timeline(), and are read
+     * in place; null spaces rows one time unit apart, so the rate is in rows
+     * per second */
+    Scheduler(const double *times, size_t rows, double rate = 1);
+
+    size_t rows() const { return _rows; }
+    size_t position() const { return _pos; }
+    double rate() const { return _rate; }
+    bool paused() const { return _paused; }
+    // seconds of dataset time between the first row and row
+    double offset(size_t row) const { return time(row) - time(0); }
+
+    // rate <= 0 stops playback until a positive rate is set
+    void set_rate(double rate);
+    void set_paused(bool paused);
+    void set_loop(bool loop) { _loop = loop; }
+    void seek(size_t row);
+    // first row at or after seconds from the start, found by binary search
+    void seek_time(double seconds);
+    // 0 schedules rows, otherwise ticks this far apart
+    void set_tick_period(int64_t period);
+
+    /* the deadline of the next row or tick, and the row it plays; a tick
+     * samples frac of the way from row to the next one. False while stopped
+     * or past the last row without looping. */
+    bool next(size_t &row, double &frac, int64_t &deadline);
+    // what next() returned was sent at time now
+    void sent(int64_t deadline, int64_t now);
+
+    struct Report
+    {
+        unsigned long sent, late, resyncs;
+        double mean_error_us, max_error_us;
+    };
+    // statistics since the previous call
+    Report report();
+
+private:
+    double time(size_t row) const { return _times ? _times[row] : (double)row; }
+    // the dataset time playback has reached
+    double current() const;
+    void anchor(int64_t wall);
+    // the dataset time due at wall, which stands still while paused or stopped
+    double playhead(int64_t wall) const;
+    // anchors at the playhead with a new rate
+    void reanchor(int64_t wall, double rate);
+    int64_t deadline(size_t row) const;
+    bool next_tick(size_t &row, double &frac, int64_t &deadline);
+
+    const double *_times;
+    size_t _rows;
+    double _rate;
+    bool _paused, _loop;
+    // the next row to send, or while ticking the row at or before the last tick
+    size_t _pos;
+    // dataset time _anchor_time is due at _anchor_wall
+    double _anchor_time;
+    int64_t _anchor_wall;
+    int64_t _tick_period;
+    unsigned long _tick;    // ticks since the anchor
+    double _tick_time;      // dataset time of the last tick
+    // the loop restarts this long after the last row
+    double _loop_gap;
+
+    unsigned long _sent, _late, _resyncs;
+    double _error_sum, _error_max;
+};
+
+} // namespace dataset
+
+#endif // SCHEDULER_H
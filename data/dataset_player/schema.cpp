@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <unordered_map>
+#include "schema.h"
+
+using namespace dataset;
+
+namespace {
+
+const char *COMPONENTS = "xyzw";
+const char *SEPARATORS = "_.- ";
+
+std::string trim(const std::string &s)
+{
+    size_t begin = s.find_first_not_of(" \t\r"), end = s.find_last_not_of(" \t\r");
+    return begin == std::string::npos ? std::string() : s.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> split_list(const std::string &s)
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+    for (;;) {
+        size_t comma = s.find(',', start);
+        items.push_back(trim(s.substr(start, comma == std::string::npos ? std::string::npos
+                                                                          : comma - start)));
+        if (comma == std::string::npos)
+            return items;
+        start = comma + 1;
+    }
+}
+
+std::string signal_name(std::string name)
+{
+    std::replace(name.begin(), name.end(), ' ', '_');
+    return name;
+}
+
+std::string column_base(const Column &c)
+{
+    std::string unit;
+    return strip_unit(c.name, unit);
+}
+
+/* prefix and element of a name ending in a component letter after a
+ * separator or a camelCase capital, or in an index; a bare component
+ * letter has an empty prefix, and Schema::group names its vector */
+bool split_element(const std::string &name, std::string &prefix, int &index, bool &letter)
+{
+    size_t n = name.size();
+    if (n == 1) {
+        const char *component = strchr(COMPONENTS, tolower((unsigned char)name[0]));
+        if (!component || !*component)
+            return false;
+        letter = true;
+        index = (int)(component - COMPONENTS);
+        prefix.clear();
+        return true;
+    }
+    if (n < 2)
+        return false;
+    char last = name[n - 1], before = name[n - 2];
+    const char *component = strchr(COMPONENTS, tolower((unsigned char)last));
+    if (component && *component) {
+        letter = true;
+        index = (int)(component - COMPONENTS);
+        if (strchr(SEPARATORS, before))
+            prefix = name.substr(0, n - 2);
+        else if (isupper((unsigned char)last) && islower((unsigned char)before))
+            prefix = name.substr(0, n - 1);
+        else
+            return false;
+    } else {
+        size_t digits = n;
+        while (digits > 0 && isdigit((unsigned char)name[digits - 1]))
+            digits--;
+        if (digits == n || digits == 0 || n - digits > 4)
+            return false;
+        letter = false;
+        index = atoi(name.c_str() + digits);
+        prefix = name.substr(0, digits);
+    }
+    while (!prefix.empty() && strchr(SEPARATORS, prefix.back()))
+        prefix.pop_back();
+    // an index needs something to be the index of
+    return letter || std::any_of(prefix.begin(), prefix.end(),
+                                 [](char ch) { return isalpha((unsigned char)ch); });
+}
+
+Signal make_signal(const Dataset &data, const std::string &name, const std::vector<size_t> &columns)
+{
+    Signal s;
+    s.name = name;
+    s.type = INT32;
+    s.columns = columns;
+    for (size_t i = 0; i < columns.size(); i++) {
+        const Column &c = data.columns()[columns[i]];
+        s.type = std::max(s.type, c.type);
+        s.min.push_back(c.min);
+        s.max.push_back(c.max);
+        // a unit only if every element has the same one
+        if (!i)
+            s.unit = c.unit;
+        else if (s.unit != c.unit)
+            s.unit.clear();
+    }
+    return s;
+}
+
+} // namespace
+
+std::string Schema::sidecar(const char *dataset_path)
+{
+    std::string path = dataset_path;
+    size_t dot = path.find_last_of('.'), slash = path.find_last_of('/');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        path.erase(dot);
+    return path + SCHEMA_SUFFIX;
+}
+
+bool Schema::read_config(const char *path, bool required, std::vector<Override> &overrides)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        if (required)
+            _error = std::string("cannot open ") + path;
+        return !required;
+    }
+    _config = path;
+    char buffer[4096];
+    for (int line = 1; fgets(buffer, sizeof(buffer), file); line++) {
+        std::string text = buffer;
+        text = trim(text.substr(0, text.find_first_of("#\n")));
+        if (text.empty())
+            continue;
+        size_t eq = text.find('=');
+        Override o;
+        o.signal = trim(text.substr(0, eq));
+        o.line = line;
+        if (eq == std::string::npos || o.signal.empty()) {
+            _error = _config + ":" + std::to_string(line) + ": expected <name> = <value>";
+            fclose(file);
+            return false;
+        }
+        size_t dot = o.signal.find_last_of('.');
+        if (dot != std::string::npos) {
+            std::string key = o.signal.substr(dot + 1);
+            if (key == "unit" || key == "min" || key == "max") {
+                o.key = key;
+                o.signal = trim(o.signal.substr(0, dot));
+            }
+        }
+        o.values = split_list(text.substr(eq + 1));
+        overrides.push_back(o);
+    }
+    fclose(file);
+    return true;
+}
+
+void Schema::group(const Dataset &data, std::vector<bool> &used, bool automatic)
+{
+    const std::vector<Column> &columns = data.columns();
+    struct Member
+    {
+        size_t column;
+        int index;
+    };
+    // candidate groups by prefix, in order of first appearance
+    std::vector<std::vector<Member> > groups;
+    std::vector<std::string> prefixes;
+    std::vector<bool> letters;
+    std::unordered_map<std::string, size_t> found;
+    for (size_t i = 0; automatic && i < columns.size(); i++) {
+        const Column &c = columns[i];
+        std::string prefix;
+        int index;
+        bool letter;
+        if (used[i] || c.is_date || !c.labels.empty()
+            || !split_element(column_base(c), prefix, index, letter))
+            continue;
+        // "a_x" and "a1" never share a group
+        auto it = found.emplace((letter ? "x:" : "n:") + prefix, groups.size());
+        if (it.second) {
+            groups.emplace_back();
+            prefixes.push_back(prefix);
+            letters.push_back(letter);
+        }
+        groups[it.first->second].push_back(Member{i, index});
+    }
+
+    std::vector<Signal> grouped;
+    for (size_t g = 0; g < groups.size(); g++) {
+        std::vector<Member> &members = groups[g];
+        bool letter = letters[g];
+        std::set<int> indices;
+        for (const Member &m : members)
+            indices.insert(m.index);
+        if (members.size() < 2 || indices.size() != members.size())
+            continue;
+        std::string name = prefixes[g];
+        if (letter) {
+            // x and y, then optionally z, then w with all three
+            bool x = indices.count(0), y = indices.count(1), z = indices.count(2), w = indices.count(3);
+            if (!x || !y || (w && !z))
+                continue;
+            if (name.empty()) {
+                for (const Member &m : members)
+                    name += COMPONENTS[m.index];
+            }
+        } else {
+            // a run of indices, in index order
+            if (*indices.rbegin() - *indices.begin() + 1 != (int)members.size())
+                continue;
+            std::sort(members.begin(), members.end(),
+                      [](const Member &a, const Member &b) { return a.index < b.index; });
+        }
+        std::vector<size_t> cols;
+        for (const Member &m : members) {
+            cols.push_back(m.column);
+            used[m.column] = true;
+        }
+        grouped.push_back(make_signal(data, signal_name(name), cols));
+    }
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (!used[i]) {
+            used[i] = true;
+            grouped.push_back(make_signal(data, signal_name(column_base(columns[i])), {i}));
+        }
+    }
+    _signals.insert(_signals.end(), grouped.begin(), grouped.end());
+}
+
+bool Schema::apply(const Override &o)
+{
+    std::string where = _config + ":" + std::to_string(o.line) + ": ";
+    // spelled as in the config or as the signal is published
+    std::string name = signal_name(o.signal);
+    auto s = std::find_if(_signals.begin(), _signals.end(),
+                          [&](const Signal &sig) { return sig.name == name; });
+    if (s == _signals.end()) {
+        _error = where + "no signal named " + name + " for its " + o.key;
+        return false;
+    }
+    if (o.key == "unit") {
+        s->unit = o.values[0];
+        return true;
+    }
+    size_t len = s->columns.size();
+    if (o.values.size() != 1 && o.values.size() != len) {
+        _error = where + o.signal + " has " + std::to_string(len) + " elements";
+        return false;
+    }
+    std::vector<double> &range = o.key == "min" ? s->min : s->max;
+    for (size_t i = 0; i < len; i++) {
+        const std::string &text = o.values[o.values.size() == 1 ? 0 : i];
+        char *end;
+        double value = strtod(text.c_str(), &end);
+        if (text.empty() || *end) {
+            _error = where + "expected a number, not \"" + text + "\"";
+            return false;
+        }
+        range[i] = value;
+    }
+    return true;
+}
+
+bool Schema::build(const Dataset &data, const char *config, bool required)
+{
+    _signals.clear();
+    _config.clear();
+    _error.clear();
+    std::vector<Override> overrides;
+    if (config && !read_config(config, required, overrides))
+        return false;
+
+    const std::vector<Column> &columns = data.columns();
+    auto find_column = [&](const std::string &name) {
+        for (size_t i = 0; i < columns.size(); i++) {
+            if (columns[i].name == name || signal_name(columns[i].name) == name
+                || signal_name(column_base(columns[i])) == name)
+                return (int)i;
+        }
+        return -1;
+    };
+
+    // signals named in the config claim their columns before grouping
+    std::vector<bool> used(columns.size());
+    bool automatic = true;
+    for (const Override &o : overrides) {
+        std::string where = _config + ":" + std::to_string(o.line) + ": ";
+        if (!o.key.empty())
+            continue;
+        if (o.signal == "group") {
+            automatic = o.values[0] != "no" && o.values[0] != "false" && o.values[0] != "0";
+            continue;
+        }
+        std::vector<size_t> cols;
+        for (const std::string &name : o.values) {
+            int col = find_column(name);
+            if (col < 0) {
+                _error = where + "no column named " + name;
+                return false;
+            }
+            if (used[col]) {
+                _error = where + name + " is already used";
+                return false;
+            }
+            used[col] = true;
+            cols.push_back(col);
+        }
+        if (o.signal != "omit")
+            _signals.push_back(make_signal(data, signal_name(o.signal), cols));
+    }
+    size_t named = _signals.size();
+    group(data, used, automatic);
+
+    // grouped names may repeat each other or a named signal; number them as
+    // pandas does repeated columns
+    std::set<std::string> taken;
+    for (size_t i = 0; i < _signals.size(); i++) {
+        std::string name = _signals[i].name;
+        for (int dup = 1; i >= named && taken.count(name); dup++)
+            name = _signals[i].name + "." + std::to_string(dup);
+        if (i < named && taken.count(name)) {
+            _error = _config + ": " + name + " is defined twice";
+            return false;
+        }
+        _signals[i].name = name;
+        taken.insert(name);
+    }
+    // in column order, so the device lists them as the file does
+    std::stable_sort(_signals.begin(), _signals.end(), [](const Signal &a, const Signal &b) {
+        return *std::min_element(a.columns.begin(), a.columns.end())
+             < *std::min_element(b.columns.begin(), b.columns.end());
+    });
+
+    for (const Override &o : overrides) {
+        if (!o.key.empty() && !apply(o))
+            return false;
+    }
+    return true;
+}
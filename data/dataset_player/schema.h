@@ -0,0 +1,69 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+/* The signals a dataset is published as. Related numeric columns are      *
+ * grouped into vector signals, so a wide row goes out as a few messages:   *
+ * columns sharing a prefix and ending in x, y, z (and w), as in "acc_x" or *
+ * "accX", or in a run of indices, as in "emg1", "emg2"... Each element's   *
+ * range is its column's, found while loading, and units come from names    *
+ * like "speed (km/h)". A sidecar file can regroup, rename, omit and set    *
+ * units and ranges:                                                        *
+ *                                                                          *
+ *     # comment                                                            *
+ *     grip = force left, force right   # a signal from these columns       *
+ *     grip.unit = N                                                        *
+ *     grip.min = 0                     # every element, or one per element *
+ *     grip.max = 50, 60                                                    *
+ *     omit = Unnamed: 0, notes                                             *
+ *     group = no                       # no automatic grouping             */
+
+#include <string>
+#include <vector>
+#include "dataset.h"
+
+#define SCHEMA_SUFFIX ".signals"   // sidecar of data.csv or data.dsb is data.signals
+
+namespace dataset {
+
+struct Signal
+{
+    std::string name;
+    // the widest type of its columns, so ints grouped with floats are floats
+    Type type;
+    std::vector<size_t> columns;    // one per element
+    std::string unit;
+    std::vector<double> min, max;   // one per element
+};
+
+class Schema
+{
+public:
+    /* groups data's columns, then applies the overrides in config; a
+     * missing config is not an error unless it was asked for by name */
+    bool build(const Dataset &data, const char *config = nullptr, bool required = false);
+
+    const std::vector<Signal> &signals() const { return _signals; }
+    const std::string &error() const { return _error; }
+
+    // the default sidecar path for a dataset file
+    static std::string sidecar(const char *dataset_path);
+
+private:
+    struct Override
+    {
+        std::string signal, key;
+        std::vector<std::string> values;
+        int line;
+    };
+    bool read_config(const char *path, bool required, std::vector<Override> &overrides);
+    void group(const Dataset &data, std::vector<bool> &used, bool automatic);
+    bool apply(const Override &o);
+
+    std::vector<Signal> _signals;
+    std::string _config;
+    std::string _error;
+};
+
+} // namespace dataset
+
+#endif // SCHEMA_H
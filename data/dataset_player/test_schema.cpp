@@ -0,0 +1,81 @@
+/* Checks of column grouping on small CSVs written to /tmp: bare x, y, z    *
+ * columns, prefixed and camelCase components, index runs, columns that     *
+ * must stay scalars, sidecar units and a date column that is not there.    *
+ * Prints each failure; exits non-zero if any.                             */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "dataset.h"
+#include "schema.h"
+
+static int failures = 0;
+
+// the signals a CSV with this header row and one row of zeros groups into,
+// as "name[columns]" in order with " unit" after those that have one, given
+// these sidecar lines, or the load or schema error
+static std::string grouped(const std::string &header, const std::string &config = "",
+                           int date_column = -1)
+{
+    const char *path = "/tmp/test_schema.csv", *config_path = "/tmp/test_schema.signals";
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return "cannot write " + std::string(path);
+    std::string row = "0";
+    for (char ch : header) {
+        if (ch == ',')
+            row += ",0";
+    }
+    fprintf(file, "%s\n%s\n", header.c_str(), row.c_str());
+    fclose(file);
+    file = fopen(config_path, "w");
+    if (!file)
+        return "cannot write " + std::string(config_path);
+    fprintf(file, "%s", config.c_str());
+    fclose(file);
+
+    dataset::Dataset data;
+    dataset::Schema schema;
+    bool loaded = data.load(path, date_column), built = loaded && schema.build(data, config_path);
+    remove(path);
+    remove(config_path);
+    if (!built)
+        return loaded ? schema.error() : data.error();
+    std::string out;
+    for (const dataset::Signal &s : schema.signals()) {
+        out += (out.empty() ? "" : " ") + s.name + "[" + std::to_string(s.columns.size()) + "]";
+        if (!s.unit.empty())
+            out += " " + s.unit;
+    }
+    return out;
+}
+
+static void check(const std::string &header, const std::string &expected,
+                  const std::string &config = "", int date_column = -1)
+{
+    std::string got = grouped(header, config, date_column);
+    if (got != expected) {
+        printf("%s: expected %s, got %s\n", header.c_str(), expected.c_str(), got.c_str());
+        failures++;
+    }
+}
+
+int main()
+{
+    check("x,y,z", "xyz[3]");
+    check("t,X,Y", "t[1] xy[2]");
+    check("x,y,z,w", "xyzw[4]");
+    check("x", "x[1]");
+    check("x,z", "x[1] z[1]");
+    check("acc_x,acc_y,acc_z,x,y", "acc[3] xy[2]");
+    check("accX,accY", "acc[2]");
+    check("emg1,emg2,emg3", "emg[3]");
+    check("a,b", "a[1] b[1]");
+    // overrides name signals as the config does or as they are published
+    check("force left,force right", "force_left[1] N force_right[1] kN",
+          "force left.unit = N\nforce_right.unit = kN\n");
+    check("a,b", "/tmp/test_schema.signals:1: no signal named c for its unit", "c.unit = V\n");
+    check("t,a", "/tmp/test_schema.csv has no column 2 for dates, only 0 to 1", "", 2);
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
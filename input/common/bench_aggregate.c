@@ -0,0 +1,41 @@
+/* Per-frame cost of the touch aggregate stage for 1-16 touches. */
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <time.h>
+#include "touch_aggregate.h"
+
+#define FRAMES 1000000
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main()
+{
+    ta_touch touches[16];
+    ta_aggregate agg;
+    float sink = 0;
+
+    for (int n = 1; n <= 16; n *= 2) {
+        double start = now();
+        for (int f = 0; f < FRAMES; f++) {
+            // fingers pinching and rotating around the middle of the pad
+            float a = f * 0.001f, r = 0.2f + 0.1f * (f & 63) / 64.f;
+            for (int i = 0; i < n; i++) {
+                float b = a + i * TA_TWOPI / n;
+                touches[i].last = touches[i].pos;
+                touches[i].pos.x = 0.5f + r * cosf(b);
+                touches[i].pos.y = 0.5f + r * sinf(b);
+            }
+            ta_compute(touches, n, 0.008f, &agg);
+            sink += agg.rotation + agg.growth;
+        }
+        double elapsed = now() - start;
+        printf("%2d touches: %6.1f ns/frame (including synthesis)\n", n, elapsed * 1e9 / FRAMES);
+    }
+    return sink == 12345.f;
+}
@@ -0,0 +1,111 @@
+#ifndef TOUCH_AGGREGATE_H
+#define TOUCH_AGGREGATE_H
+
+/* Once-per-frame pan/zoom/rotate aggregates over a set of touches.          *
+ * Header-only so it can be shared by the C trackpad bridge and the C++     *
+ * TUIO bridge without another library to build.                            */
+
+#include <math.h>
+
+#define TA_TWOPI 6.28318530717958647692f
+#define TA_MIN_RADIUS 1e-4f // touches closer than this to the centroid have no angle
+
+typedef struct {
+    float x, y;
+} ta_point;
+
+typedef struct {
+    ta_point pos;   // position in this frame
+    ta_point last;  // position in the previous frame, equal to pos for new touches
+} ta_touch;
+
+typedef struct {
+    int count;
+    ta_point centroid;
+    ta_point velocity;  // mean displacement, per second if a frame period was given
+    float spread;       // mean distance from the centroid
+    float growth;       // change in spread since the previous frame
+    float box_growth;   // change in the diagonal of the bounding box since the previous frame
+    float rotation;     // mean rotation around the centroid since the previous frame (radians)
+} ta_aggregate;
+
+static inline float ta_wrap_angle(float a)
+{
+    if (a > TA_TWOPI * 0.5f)
+        a -= TA_TWOPI;
+    else if (a < -TA_TWOPI * 0.5f)
+        a += TA_TWOPI;
+    return a;
+}
+
+/* Compute the aggregate of n active touches. dt is the frame period in
+ * seconds, or 0 to report velocity as displacement per frame. The current
+ * and previous centroids are taken over the same set of touches, so adding
+ * or lifting a finger does not register as a pan. Returns the touch count. */
+static inline int ta_compute(const ta_touch *touches, int n, float dt, ta_aggregate *out)
+{
+    int i, rotating = 0;
+    float cx = 0, cy = 0, lx = 0, ly = 0, spread = 0, last_spread = 0, rotation = 0;
+    ta_point lo, hi, last_lo, last_hi;
+
+    out->count = n;
+    out->centroid.x = out->centroid.y = 0;
+    out->velocity.x = out->velocity.y = 0;
+    out->spread = out->growth = out->box_growth = out->rotation = 0;
+    if (n <= 0)
+        return 0;
+
+    for (i = 0; i < n; i++) {
+        cx += touches[i].pos.x;
+        cy += touches[i].pos.y;
+        lx += touches[i].last.x;
+        ly += touches[i].last.y;
+    }
+    cx /= n;
+    cy /= n;
+    lx /= n;
+    ly /= n;
+
+    out->centroid.x = cx;
+    out->centroid.y = cy;
+    out->velocity.x = cx - lx;
+    out->velocity.y = cy - ly;
+    if (dt > 0) {
+        out->velocity.x /= dt;
+        out->velocity.y /= dt;
+    }
+    if (n < 2)
+        return n;
+
+    lo = hi = touches[0].pos;
+    last_lo = last_hi = touches[0].last;
+    for (i = 0; i < n; i++) {
+        const ta_touch *t = &touches[i];
+        lo.x = fminf(lo.x, t->pos.x);
+        lo.y = fminf(lo.y, t->pos.y);
+        hi.x = fmaxf(hi.x, t->pos.x);
+        hi.y = fmaxf(hi.y, t->pos.y);
+        last_lo.x = fminf(last_lo.x, t->last.x);
+        last_lo.y = fminf(last_lo.y, t->last.y);
+        last_hi.x = fmaxf(last_hi.x, t->last.x);
+        last_hi.y = fmaxf(last_hi.y, t->last.y);
+
+        float px = touches[i].pos.x - cx, py = touches[i].pos.y - cy;
+        float qx = touches[i].last.x - lx, qy = touches[i].last.y - ly;
+        float r = sqrtf(px * px + py * py), q = sqrtf(qx * qx + qy * qy);
+        spread += r;
+        last_spread += q;
+        if (r > TA_MIN_RADIUS && q > TA_MIN_RADIUS) {
+            rotation += ta_wrap_angle(atan2f(py, px) - atan2f(qy, qx));
+            ++rotating;
+        }
+    }
+    out->spread = spread / n;
+    out->growth = (spread - last_spread) / n;
+    out->box_growth = hypotf(hi.x - lo.x, hi.y - lo.y)
+                    - hypotf(last_hi.x - last_lo.x, last_hi.y - last_lo.y);
+    out->rotation = rotating ? rotation / rotating : 0;
+    return n;
+}
+
+#endif // TOUCH_AGGREGATE_H
@@ -0,0 +1,475 @@
+/* Linux multitouch bridge: publishes the same "touch" signals as            *
+ * macbook_trackpad_mapper from a multitouch protocol B evdev device, or      *
+ * from an evemu-record log for testing without hardware.                    */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#include <mapper/mapper.h>
+
+#define NUMTOUCHES 16
+#define MAX_EVENTS 64
+#define IDLE_POLL_MS 100
+#define BIT_IS_SET(bits, n) ((bits)[(n) / (8 * sizeof(long))] & (1UL << ((n) % (8 * sizeof(long)))))
+
+typedef struct {
+    int id;                 // tracking id, -1 if the slot is empty
+    int x, y;
+    int major, minor;
+    int orientation;
+    int pressure;
+    float last_x, last_y;   // normalized position at the previous report
+    double last_time;
+    int dirty;
+    int released;
+} slot_t;
+
+typedef struct {
+    int min, max, res;
+    int present;
+} axis_t;
+
+const char* default_name = "touchpad";
+mpr_dev mdev = 0;
+mpr_sig countSig = 0;
+mpr_sig angleSig = 0;
+mpr_sig ellipseSig = 0;
+mpr_sig positionSig = 0;
+mpr_sig velocitySig = 0;
+mpr_sig areaSig = 0;
+
+slot_t slots[NUMTOUCHES];
+axis_t axes[ABS_CNT];
+int cur_slot = 0;
+int dropped = 0;
+
+int fd = -1;
+FILE *replay = NULL;
+double replay_start = -1;
+struct timespec clock_start;
+
+int done = 0;
+int verbose = 1;
+
+static double event_time(const struct input_event *ev)
+{
+    return ev->input_event_sec + ev->input_event_usec * 0.000001;
+}
+
+static float normalize(int code, int value)
+{
+    axis_t *a = &axes[code];
+    if (!a->present || a->max <= a->min)
+        return value;
+    return (float)(value - a->min) / (a->max - a->min);
+}
+
+// convert an axis value to mm if the device reports a resolution
+static float to_mm(int code, int value)
+{
+    return axes[code].res > 0 ? (float)value / axes[code].res : value;
+}
+
+static void reset_slots()
+{
+    for (int i = 0; i < NUMTOUCHES; i++) {
+        memset(&slots[i], 0, sizeof(slot_t));
+        slots[i].id = -1;
+    }
+}
+
+// publish all slots touched since the last SYN_REPORT as one update
+static void report(double time)
+{
+    int i, count = 0;
+    float pair[2];
+
+    for (i = 0; i < NUMTOUCHES; i++) {
+        slot_t *s = &slots[i];
+        if (s->released) {
+            mpr_sig_release_inst(angleSig, i);
+            mpr_sig_release_inst(ellipseSig, i);
+            mpr_sig_release_inst(positionSig, i);
+            mpr_sig_release_inst(velocitySig, i);
+            mpr_sig_release_inst(areaSig, i);
+            s->released = 0;
+        }
+        if (s->id < 0)
+            continue;
+        ++count;
+        if (!s->dirty)
+            continue;
+        s->dirty = 0;
+
+        // orientation is reported as a quarter turn over the positive range
+        float angle = 0.f;
+        if (axes[ABS_MT_ORIENTATION].present && axes[ABS_MT_ORIENTATION].max > 0)
+            angle = (float)s->orientation / axes[ABS_MT_ORIENTATION].max * M_PI_2;
+        if (angle < 0)
+            angle += M_PI;
+        mpr_sig_set_value(angleSig, i, 1, MPR_FLT, &angle);
+
+        pair[0] = to_mm(ABS_MT_TOUCH_MAJOR, s->major);
+        pair[1] = axes[ABS_MT_TOUCH_MINOR].present ? to_mm(ABS_MT_TOUCH_MINOR, s->minor) : pair[0];
+        mpr_sig_set_value(ellipseSig, i, 2, MPR_FLT, pair);
+
+        float area = axes[ABS_MT_PRESSURE].present ? normalize(ABS_MT_PRESSURE, s->pressure)
+                                                   : pair[0] * pair[1] * M_PI_4;
+        mpr_sig_set_value(areaSig, i, 1, MPR_FLT, &area);
+
+        pair[0] = normalize(ABS_MT_POSITION_X, s->x);
+        pair[1] = normalize(ABS_MT_POSITION_Y, s->y);
+        mpr_sig_set_value(positionSig, i, 2, MPR_FLT, pair);
+
+        float vel[2] = {0.f, 0.f};
+        if (s->last_time > 0 && time > s->last_time) {
+            vel[0] = (pair[0] - s->last_x) / (time - s->last_time);
+            vel[1] = (pair[1] - s->last_y) / (time - s->last_time);
+        }
+        mpr_sig_set_value(velocitySig, i, 2, MPR_FLT, vel);
+        s->last_x = pair[0];
+        s->last_y = pair[1];
+        s->last_time = time;
+
+        if (verbose)
+            printf("  slot %2d, ID %5d, angle %4.2f, position %5.3f, %5.3f, "
+                   "vel %6.3f, %6.3f, area %6.3f\n", i, s->id, angle, pair[0], pair[1],
+                   vel[0], vel[1], area);
+    }
+
+    mpr_sig_set_value(countSig, 0, 1, MPR_INT32, &count);
+    if (verbose)
+        printf("Touch count: %d\n", count);
+    mpr_dev_update_maps(mdev);
+}
+
+static void set_slot_value(slot_t *s, int code, int value)
+{
+    switch (code) {
+        case ABS_MT_TRACKING_ID:
+            if (value < 0) {
+                if (s->id >= 0)
+                    s->released = 1;
+                s->last_time = 0;
+            }
+            else if (s->id < 0)
+                s->last_time = 0;
+            s->id = value;
+            break;
+        case ABS_MT_POSITION_X:     s->x = value;           break;
+        case ABS_MT_POSITION_Y:     s->y = value;           break;
+        case ABS_MT_TOUCH_MAJOR:    s->major = value;       break;
+        case ABS_MT_TOUCH_MINOR:    s->minor = value;       break;
+        case ABS_MT_ORIENTATION:    s->orientation = value; break;
+        case ABS_MT_PRESSURE:       s->pressure = value;    break;
+        default:
+            return;
+    }
+    s->dirty = 1;
+}
+
+// after SYN_DROPPED, re-read the complete slot state from the kernel
+static void resync()
+{
+    static const int codes[] = {ABS_MT_TRACKING_ID, ABS_MT_POSITION_X, ABS_MT_POSITION_Y,
+                                ABS_MT_TOUCH_MAJOR, ABS_MT_TOUCH_MINOR, ABS_MT_ORIENTATION,
+                                ABS_MT_PRESSURE};
+    struct {
+        __u32 code;
+        __s32 values[NUMTOUCHES];
+    } req;
+
+    if (fd < 0)
+        return;
+    for (int c = 0; c < sizeof(codes) / sizeof(codes[0]); c++) {
+        if (!axes[codes[c]].present)
+            continue;
+        req.code = codes[c];
+        if (ioctl(fd, EVIOCGMTSLOTS(sizeof(req)), &req) < 0)
+            continue;
+        for (int i = 0; i < NUMTOUCHES; i++)
+            set_slot_value(&slots[i], codes[c], req.values[i]);
+    }
+    struct input_absinfo info;
+    if (ioctl(fd, EVIOCGABS(ABS_MT_SLOT), &info) == 0)
+        cur_slot = info.value;
+}
+
+static void handle_event(const struct input_event *ev)
+{
+    if (ev->type == EV_SYN) {
+        if (ev->code == SYN_DROPPED) {
+            dropped = 1;
+            return;
+        }
+        if (ev->code != SYN_REPORT)
+            return;
+        if (dropped) {
+            dropped = 0;
+            resync();
+        }
+        report(event_time(ev));
+    }
+    else if (ev->type == EV_ABS && !dropped) {
+        if (ev->code == ABS_MT_SLOT)
+            cur_slot = ev->value;
+        else if (cur_slot >= 0 && cur_slot < NUMTOUCHES)
+            set_slot_value(&slots[cur_slot], ev->code, ev->value);
+    }
+}
+
+static int open_device(const char *path)
+{
+    unsigned long bits[ABS_CNT / (8 * sizeof(long)) + 1];
+    struct input_absinfo info;
+    char name[256] = "unknown";
+
+    int f = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (f < 0)
+        return -1;
+    memset(bits, 0, sizeof(bits));
+    if (ioctl(f, EVIOCGBIT(EV_ABS, sizeof(bits)), bits) < 0 || !BIT_IS_SET(bits, ABS_MT_SLOT)) {
+        close(f);
+        return -1;
+    }
+    ioctl(f, EVIOCGNAME(sizeof(name)), name);
+    printf("using multitouch device '%s' at %s\n", name, path);
+
+    for (int code = ABS_MT_SLOT; code <= ABS_MT_TOOL_Y && code < ABS_CNT; code++) {
+        if (!BIT_IS_SET(bits, code) || ioctl(f, EVIOCGABS(code), &info) < 0)
+            continue;
+        axes[code].present = 1;
+        axes[code].min = info.minimum;
+        axes[code].max = info.maximum;
+        axes[code].res = info.resolution;
+    }
+    return f;
+}
+
+static int find_device()
+{
+    char path[32];
+    for (int i = 0; i < 32; i++) {
+        snprintf(path, 32, "/dev/input/event%d", i);
+        int f = open_device(path);
+        if (f >= 0)
+            return f;
+    }
+    return -1;
+}
+
+// parse one line of an evemu-record log: absinfo ("A:") lines describe the
+// axes, event ("E:") lines are returned with their original timestamp
+static int read_replay_event(struct input_event *ev)
+{
+    char line[256];
+    while (fgets(line, sizeof(line), replay)) {
+        unsigned int type, code;
+        int value, min, max, fuzz, flat, res;
+        long sec, usec;
+        if (sscanf(line, "E: %ld.%ld %x %x %d", &sec, &usec, &type, &code, &value) == 5) {
+            ev->input_event_sec = sec;
+            ev->input_event_usec = usec;
+            ev->type = type;
+            ev->code = code;
+            ev->value = value;
+            return 1;
+        }
+        if (sscanf(line, "A: %x %d %d %d %d %d", &code, &min, &max, &fuzz, &flat, &res) >= 3
+            && code < ABS_CNT) {
+            axes[code].present = 1;
+            axes[code].min = min;
+            axes[code].max = max;
+            axes[code].res = res;
+        }
+    }
+    return 0;
+}
+
+// sleep until the recorded time of a report, relative to the first event
+static void wait_for(double time)
+{
+    if (replay_start < 0) {
+        replay_start = time;
+        clock_gettime(CLOCK_MONOTONIC, &clock_start);
+        return;
+    }
+    double offset = time - replay_start;
+    struct timespec deadline = clock_start;
+    deadline.tv_sec += (time_t)offset;
+    deadline.tv_nsec += (long)((offset - (time_t)offset) * 1e9);
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_nsec -= 1000000000;
+        ++deadline.tv_sec;
+    }
+    while (!done && clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {}
+}
+
+static void run_replay()
+{
+    struct input_event ev;
+    while (!done && read_replay_event(&ev)) {
+        if (ev.type == EV_SYN && ev.code == SYN_REPORT)
+            wait_for(event_time(&ev));
+        handle_event(&ev);
+        mpr_dev_poll(mdev, 0);
+    }
+}
+
+static void run_device()
+{
+    struct input_event evs[MAX_EVENTS];
+    struct epoll_event pev;
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+
+    pev.events = EPOLLIN;
+    pev.data.fd = fd;
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &pev) < 0) {
+        perror("epoll");
+        return;
+    }
+
+    while (!done) {
+        // block until touch data arrives; the timeout only services the graph
+        int n = epoll_wait(epfd, &pev, 1, IDLE_POLL_MS);
+        if (n > 0) {
+            ssize_t bytes;
+            while ((bytes = read(fd, evs, sizeof(evs))) > 0) {
+                for (int i = 0; i < bytes / sizeof(struct input_event); i++)
+                    handle_event(&evs[i]);
+            }
+            if (bytes < 0 && errno != EAGAIN && errno != EINTR) {
+                perror("read");
+                break;
+            }
+        }
+        mpr_dev_poll(mdev, 0);
+    }
+    close(epfd);
+}
+
+void add_signals()
+{
+    int mini = 0, num_touches = NUMTOUCHES;
+    countSig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/count", 1, MPR_INT32, NULL,
+                           &mini, &num_touches, NULL, 0, 0);
+
+    float minf[2] = {0.f, 0.f};
+    float maxf[2] = {M_PI, M_PI};
+    angleSig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/angle", 1, MPR_FLT, "radians",
+                           minf, maxf, &num_touches, 0, 0);
+
+    ellipseSig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/ellipse", 2, MPR_FLT,
+                             "mm", 0, 0, &num_touches, 0, 0);
+
+    minf[0] = 0.f; minf[1] = 0.f;
+    maxf[0] = 1.f; maxf[1] = 1.f;
+    positionSig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/position", 2, MPR_FLT,
+                              "normalized", minf, maxf, &num_touches, 0, 0);
+
+    velocitySig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/velocity", 2, MPR_FLT,
+                              "normalized", 0, 0, &num_touches, 0, 0);
+
+    areaSig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/area", 1, MPR_FLT,
+                          0, 0, 0, &num_touches, 0, 0);
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j;
+    const char* dev_name = default_name;
+    const char* path = NULL;
+    const char* replay_path = NULL;
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("linux_multitouch_mapper.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--device <path> (default: first multitouch device), "
+                               "--replay <evemu-record log>, "
+                               "--alias <string> (default: '%s')\n", default_name);
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case '-':
+                        if (++j < len && strcmp(argv[i]+j, "alias")==0) {
+                            if (++i < argc)
+                                dev_name = argv[i];
+                        }
+                        else if (strcmp(argv[i]+j, "device")==0) {
+                            if (++i < argc)
+                                path = argv[i];
+                        }
+                        else if (strcmp(argv[i]+j, "replay")==0) {
+                            if (++i < argc)
+                                replay_path = argv[i];
+                        }
+                        j = len;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    reset_slots();
+    if (replay_path) {
+        if (!(replay = fopen(replay_path, "r"))) {
+            printf("could not open replay file %s\n", replay_path);
+            return 1;
+        }
+    }
+    else {
+        fd = path ? open_device(path) : find_device();
+        if (fd < 0) {
+            printf("no multitouch (protocol B) input device found\n");
+            return 1;
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    mdev = mpr_dev_new(dev_name, 0);
+    add_signals();
+    while (!done && !mpr_dev_get_is_ready(mdev)) {
+        mpr_dev_poll(mdev, 25);
+    }
+    printf("Ctrl-C to abort\n");
+
+    if (replay)
+        run_replay();
+    else
+        run_device();
+
+    if (replay)
+        fclose(replay);
+    if (fd >= 0)
+        close(fd);
+
+    printf("freeing mapper device... ");
+    mpr_dev_free(mdev);
+    printf("done.\n");
+    return 0;
+}
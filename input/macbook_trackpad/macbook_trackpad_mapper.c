@@ -3,11 +3,16 @@
 
 #include <math.h>
 #include <unistd.h>
+#include <stdatomic.h>
 #include <sys/time.h>
+#include <dispatch/dispatch.h>
 #include <CoreFoundation/CoreFoundation.h>
 #include <mapper/mapper.h>
+#include "../common/touch_aggregate.h"
 
 #define NUMTOUCHES 16
+#define RING_SIZE 16 // must be a power of two
+#define IDLE_POLL_NS (100 * NSEC_PER_MSEC)
 
 typedef struct { float x,y; } mtPoint;
 typedef struct { mtPoint pos,vel; } mtReadout;
@@ -32,6 +37,13 @@ MTDeviceRef MTDeviceCreateDefault();
 void MTRegisterContactFrameCallback(MTDeviceRef, MTContactCallbackFunction);
 void MTDeviceStart(MTDeviceRef, int); // thanks comex
 
+// one contact frame as delivered by MultitouchSupport
+typedef struct {
+    int nFingers;
+    double timestamp;
+    Finger fingers[NUMTOUCHES];
+} TouchFrame;
+
 const char* default_name = "touchpad";
 mpr_dev mdev = 0;
 mpr_sig countSig = 0;
@@ -40,26 +52,105 @@ mpr_sig ellipseSig = 0;
 mpr_sig positionSig = 0;
 mpr_sig velocitySig = 0;
 mpr_sig areaSig = 0;
+mpr_sig aggCentroidSig = 0;
+mpr_sig aggVelocitySig = 0;
+mpr_sig aggGrowthSig = 0;
+mpr_sig aggRotationSig = 0;
+
+// active touches of the previous frame, for the aggregate stage
+int lastIds[NUMTOUCHES];
+ta_point lastPos[NUMTOUCHES];
+int lastCount = 0;
+double lastTimestamp = 0;
 
 int done = 0;
 int verbose = 1;
-int unpolled = 0;
+
+/* Single-producer single-consumer ring between the MultitouchSupport thread
+ * (producer) and the main thread, which owns the libmapper device. */
+TouchFrame ring[RING_SIZE];
+atomic_uint ring_head = 0;  // written by the callback only
+atomic_uint ring_tail = 0;  // written by the main thread only
+atomic_uint dropped = 0;
+dispatch_semaphore_t frame_ready;
 
 int callback(int device, Finger *data, int nFingers, double timestamp, int frame) {
+    unsigned int head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+    if (head - tail >= RING_SIZE) {
+        // main thread has fallen behind; drop rather than block this thread
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    TouchFrame *f = &ring[head & (RING_SIZE - 1)];
+    if (nFingers > NUMTOUCHES)
+        nFingers = NUMTOUCHES;
+    f->nFingers = nFingers;
+    f->timestamp = timestamp;
+    memcpy(f->fingers, data, nFingers * sizeof(Finger));
+
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+    dispatch_semaphore_signal(frame_ready);
+    return 0;
+}
+
+// pan/zoom/rotate over all active fingers, computed once per frame
+void aggregate(const TouchFrame *frame) {
+    ta_touch touches[NUMTOUCHES];
+    ta_aggregate agg;
+    int ids[NUMTOUCHES];
+    int i, j, n = 0;
+
+    for (i = 0; i < frame->nFingers; i++) {
+        const Finger *f = &frame->fingers[i];
+        if (f->size <= 0)
+            continue;
+        touches[n].pos.x = f->normalized.pos.x;
+        touches[n].pos.y = f->normalized.pos.y;
+        touches[n].last = touches[n].pos;
+        for (j = 0; j < lastCount; j++) {
+            if (lastIds[j] == f->identifier) {
+                touches[n].last = lastPos[j];
+                break;
+            }
+        }
+        ids[n++] = f->identifier;
+    }
+
+    float dt = lastTimestamp > 0 ? frame->timestamp - lastTimestamp : 0;
+    lastTimestamp = frame->timestamp;
+    lastCount = n;
+    for (i = 0; i < n; i++) {
+        lastIds[i] = ids[i];
+        lastPos[i] = touches[i].pos;
+    }
+
+    if (!ta_compute(touches, n, dt, &agg))
+        return;
+
+    mpr_sig_set_value(aggCentroidSig, 0, 2, MPR_FLT, &agg.centroid);
+    mpr_sig_set_value(aggVelocitySig, 0, 2, MPR_FLT, &agg.velocity);
+    mpr_sig_set_value(aggGrowthSig, 0, 1, MPR_FLT, &agg.growth);
+    mpr_sig_set_value(aggRotationSig, 0, 1, MPR_FLT, &agg.rotation);
+
+    if (verbose && n > 1)
+        printf("  aggregate centroid %5.3f, %5.3f, vel %6.3f, %6.3f, growth %6.3f, "
+               "rotation %6.3f\n", agg.centroid.x, agg.centroid.y, agg.velocity.x,
+               agg.velocity.y, agg.growth, agg.rotation);
+}
+
+void publish(const TouchFrame *frame) {
     float pair[2];
+    int nFingers = frame->nFingers;
 
     if (verbose)
         printf("Touch count: %d\n", nFingers);
-    else {
-        printf("\rTouch count: %d ", nFingers);
-        fflush(stdout);
-    }
 
     mpr_sig_set_value(countSig, 0, 1, MPR_INT32, &nFingers);
 
-    Finger *f = &data[0];
     for (int i = 0; i < nFingers; i++) {
-        Finger *f = &data[i];
+        const Finger *f = &frame->fingers[i];
         if (verbose)
             printf("  ID %2d, Angle %4.2f, ellipse %5.2f x%5.2f, "
                    "position %5.3f, %5.3f, vel %6.3f, %6.3f, area %6.3f\n",
@@ -89,14 +180,6 @@ int callback(int device, Finger *data, int nFingers, double timestamp, int frame
             mpr_sig_set_value(velocitySig, f->identifier, 2, MPR_FLT, pair);
 
             mpr_sig_set_value(areaSig, f->identifier, 1, MPR_FLT, &f->size);
-
-            if (f->size > 1) {
-                // calculate pan/rotate/zoom
-
-                // pan = avg velocity scaled by current zoom level
-
-                // zoom = average expansion/contraction around mutual centre
-            }
         }
         else {
             mpr_sig_release_inst(angleSig, f->identifier);
@@ -106,8 +189,18 @@ int callback(int device, Finger *data, int nFingers, double timestamp, int frame
             mpr_sig_release_inst(areaSig, f->identifier);
         }
     }
+    aggregate(frame);
     mpr_dev_update_maps(mdev);
-    return 0;
+}
+
+// publish every queued frame in order; called from the main thread only
+void drain() {
+    unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    while (tail != head) {
+        publish(&ring[tail & (RING_SIZE - 1)]);
+        atomic_store_explicit(&ring_tail, ++tail, memory_order_release);
+    }
 }
 
 void add_signals()
@@ -134,6 +227,21 @@ void add_signals()
 
     areaSig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/area", 1, MPR_FLT,
                           0, 0, 0, &num_touches, 0, 0);
+
+    aggCentroidSig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/aggregate/centroid", 2, MPR_FLT,
+                                 "normalized", minf, maxf, NULL, 0, 0);
+
+    aggVelocitySig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/aggregate/velocity", 2, MPR_FLT,
+                                 "normalized/sec", 0, 0, NULL, 0, 0);
+
+    minf[0] = -1.f;
+    aggGrowthSig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/aggregate/growth", 1, MPR_FLT,
+                               "normalized", minf, maxf, NULL, 0, 0);
+
+    minf[0] = -M_PI;
+    maxf[0] = M_PI;
+    aggRotationSig = mpr_sig_new(mdev, MPR_DIR_OUT, "touch/aggregate/rotation", 1, MPR_FLT,
+                                 "radians", minf, maxf, NULL, 0, 0);
 }
 
 void ctrlc(int sig)
@@ -180,17 +288,23 @@ int main(int argc, char **argv)
         mpr_dev_poll(mdev, 0);
     }
 
+    frame_ready = dispatch_semaphore_create(0);
+
     MTDeviceRef dev = MTDeviceCreateDefault();
     MTRegisterContactFrameCallback(dev, callback);
     MTDeviceStart(dev, 0);
     printf("Ctrl-C to abort\n");
 
-    // use non-blocking poll() to avoid being interrupted frequently by the touch callback
+    // sleep until the callback queues a frame; the timeout only services the graph
     while (!done) {
+        dispatch_semaphore_wait(frame_ready, dispatch_time(DISPATCH_TIME_NOW, IDLE_POLL_NS));
+        drain();
         mpr_dev_poll(mdev, 0);
-        usleep(10000);
     }
 
+    if (atomic_load(&dropped))
+        printf("dropped %u touch frames\n", atomic_load(&dropped));
+
     printf("freeing mapper device... ");
     mpr_dev_free(mdev);
     printf("done.\n");
@@ -0,0 +1,171 @@
+/* Throughput benchmark for the software contact tracker.                    *
+ * usage: bench_tracker [-H] [-n] [-l] [recording]                          *
+ * -H associates with the Hungarian method, -n disables splitting, and -l   *
+ * regroups by labels, which stand in for the firmware's labels_array and   *
+ * are computed up front as connected components over the threshold.        *
+ * Without a recording (see mpr.morph --record) a synthetic 185x105 session *
+ * of moving and merging contacts is generated.                              */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "blob_tracker.h"
+
+#define SYNTH_FRAMES 2000
+#define MIN_SECONDS 2.0
+#define NULL_LABEL 255
+
+static bool load(const char *path, SenselSensorInfo &info, std::vector<float> &frames)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("could not open %s\n", path);
+        return false;
+    }
+    bt_recording_header h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || strncmp(h.magic, "SFRC", 4)) {
+        printf("%s is not a force recording\n", path);
+        fclose(f);
+        return false;
+    }
+    info.num_rows = h.num_rows;
+    info.num_cols = h.num_cols;
+    info.width = h.width;
+    info.height = h.height;
+    size_t n = (size_t)h.num_rows * h.num_cols;
+    std::vector<float> frame(n);
+    while (fread(frame.data(), sizeof(float), n, f) == n)
+        frames.insert(frames.end(), frame.begin(), frame.end());
+    fclose(f);
+    return true;
+}
+
+static void synthesize(SenselSensorInfo &info, std::vector<float> &frames)
+{
+    info.num_rows = 105;
+    info.num_cols = 185;
+    info.width = 240.f;
+    info.height = 139.f;
+    size_t n = (size_t)info.num_rows * info.num_cols;
+    frames.assign(n * SYNTH_FRAMES, 0.f);
+
+    unsigned int seed = 1;
+    for (int t = 0; t < SYNTH_FRAMES; t++) {
+        float *frame = &frames[n * t];
+        // up to five fingers orbiting the centre; two of them periodically merge
+        int num = 1 + (t / 200) % 5;
+        for (int k = 0; k < num; k++) {
+            float a = t * 0.01f + k * 2.f * (float)M_PI / num;
+            float cx = 92.f + cosf(a) * (20.f + 10.f * k);
+            float cy = 52.f + sinf(a) * (15.f + 5.f * k);
+            if (k == 1)
+                cx += 12.f * sinf(t * 0.02f);
+            for (int r = (int)cy - 8; r <= (int)cy + 8; r++) {
+                for (int c = (int)cx - 8; c <= (int)cx + 8; c++) {
+                    if (r < 0 || r >= info.num_rows || c < 0 || c >= info.num_cols)
+                        continue;
+                    float d2 = (r - cy) * (r - cy) + (c - cx) * (c - cx);
+                    frame[r * info.num_cols + c] += 80.f * expf(-d2 / 8.f);
+                }
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            seed = seed * 1103515245 + 12345;
+            frame[i] += (seed >> 16 & 0xFF) / 255.f;
+        }
+    }
+}
+
+// 4-connected components of the sensels above threshold, numbered as the
+// firmware does, with NULL_LABEL for the rest and once labels run out
+static void label(const SenselSensorInfo &info, float threshold, const float *force,
+                  unsigned char *labels)
+{
+    int rows = info.num_rows, cols = info.num_cols;
+    std::vector<int> stack;
+    memset(labels, NULL_LABEL, (size_t)rows * cols);
+    int next = 0;
+    for (int i = 0; i < rows * cols && next < NULL_LABEL; i++) {
+        if (labels[i] != NULL_LABEL || force[i] < threshold)
+            continue;
+        labels[i] = (unsigned char)next;
+        stack.assign(1, i);
+        while (!stack.empty()) {
+            int j = stack.back(), r = j / cols, c = j % cols;
+            stack.pop_back();
+            int neighbours[4] = {r > 0 ? j - cols : -1, r < rows - 1 ? j + cols : -1,
+                                 c > 0 ? j - 1 : -1, c < cols - 1 ? j + 1 : -1};
+            for (int k : neighbours) {
+                if (k >= 0 && labels[k] == NULL_LABEL && force[k] >= threshold) {
+                    labels[k] = (unsigned char)next;
+                    stack.push_back(k);
+                }
+            }
+        }
+        next++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = 0;
+    SenselSensorInfo info;
+    bt_config config;
+    std::vector<float> frames;
+    std::vector<unsigned char> labels;
+
+    memset(&info, 0, sizeof(info));
+    bt_config_default(&config);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-H") == 0)
+            config.assoc = BT_ASSOC_HUNGARIAN;
+        else if (strcmp(argv[i], "-n") == 0)
+            config.split_distance = 0;
+        else if (strcmp(argv[i], "-l") == 0)
+            config.segment = BT_SEGMENT_LABELS;
+        else
+            path = argv[i];
+    }
+
+    if (path ? !load(path, info, frames) : (synthesize(info, frames), false))
+        return 1;
+    size_t n = (size_t)info.num_rows * info.num_cols;
+    size_t num_frames = frames.size() / n;
+    if (!num_frames) {
+        printf("no frames to process\n");
+        return 1;
+    }
+    bool by_labels = config.segment == BT_SEGMENT_LABELS;
+    if (by_labels) {
+        labels.resize(frames.size());
+        for (size_t t = 0; t < num_frames; t++)
+            label(info, config.threshold, &frames[n * t], &labels[n * t]);
+    }
+    printf("%zu frames of %dx%d sensels (%s, %s, %s association%s)\n", num_frames,
+           info.num_cols, info.num_rows, path ? path : "synthetic",
+           by_labels ? "labels" : "force",
+           config.assoc == BT_ASSOC_HUNGARIAN ? "hungarian" : "greedy",
+           config.split_distance > 0 && !by_labels ? ", splitting" : "");
+
+    blob_tracker tracker = bt_new(&info, &config);
+    if (!tracker)
+        return 1;
+
+    size_t processed = 0, contacts = 0;
+    double elapsed = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (elapsed < MIN_SECONDS) {
+        for (size_t t = 0; t < num_frames; t++)
+            contacts += bt_process(tracker, &frames[n * t], by_labels ? &labels[n * t] : NULL);
+        processed += num_frames;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    bt_free(tracker);
+
+    printf("%zu frames in %.3f s: %.0f fps, %.1f us/frame, %.2f contacts/frame\n",
+           processed, elapsed, processed / elapsed, elapsed * 1e6 / processed,
+           (double)contacts / processed);
+    return 0;
+}
@@ -0,0 +1,562 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "blob_tracker.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define NULL_LABEL 255
+#define NO_MATCH_COST 1e9
+
+using namespace sensel;
+
+// write 1 to mask for every sensel with force >= threshold, 0 otherwise
+static void threshold(const float *force, unsigned char *mask, int n, float thresh)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128 t = _mm_set1_ps(thresh);
+    const __m128i one = _mm_set1_epi8(1);
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_castps_si128(_mm_cmpge_ps(_mm_loadu_ps(force + i), t));
+        __m128i b = _mm_castps_si128(_mm_cmpge_ps(_mm_loadu_ps(force + i + 4), t));
+        __m128i c = _mm_castps_si128(_mm_cmpge_ps(_mm_loadu_ps(force + i + 8), t));
+        __m128i d = _mm_castps_si128(_mm_cmpge_ps(_mm_loadu_ps(force + i + 12), t));
+        __m128i m = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128((__m128i*)(mask + i), _mm_and_si128(m, one));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t t = vdupq_n_f32(thresh);
+    const uint8x8_t one = vdup_n_u8(1);
+    for (; i + 8 <= n; i += 8) {
+        uint32x4_t a = vcgeq_f32(vld1q_f32(force + i), t);
+        uint32x4_t b = vcgeq_f32(vld1q_f32(force + i + 4), t);
+        uint8x8_t m = vmovn_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(b)));
+        vst1_u8(mask + i, vand_u8(m, one));
+    }
+#endif
+    for (; i < n; i++)
+        mask[i] = force[i] >= thresh;
+}
+
+void Moments::add(float force, int col, int row)
+{
+    f += force;
+    x += force * col;
+    y += force * row;
+    xx += force * col * col;
+    yy += force * row * row;
+    xy += force * col * row;
+    ++n;
+    if (force > peak) {
+        peak = force;
+        peak_x = col;
+        peak_y = row;
+    }
+}
+
+bool Moments::finish(const bt_config &config, Blob &b) const
+{
+    if (f <= 0 || n < config.min_area || peak < config.peak_threshold)
+        return false;
+    b.x = x / f;
+    b.y = y / f;
+    b.sxx = xx / f - b.x * b.x;
+    b.syy = yy / f - b.y * b.y;
+    b.sxy = xy / f - b.x * b.y;
+    b.force = f;
+    b.area = n;
+    b.peak_x = peak_x;
+    b.peak_y = peak_y;
+    b.peak_force = peak;
+    return true;
+}
+
+/********************************** ForceSegmenter **********************************/
+
+ForceSegmenter::ForceSegmenter(int rows, int cols, const bt_config &config)
+: _rows(rows), _cols(cols), _config(config)
+{
+    _mask.resize(rows * cols);
+    _labels.resize(rows * cols);
+    _pixels.resize(rows * cols);
+    _parent.reserve(rows * cols / 2 + 1);
+}
+
+int ForceSegmenter::find(int label)
+{
+    while (_parent[label] != label) {
+        _parent[label] = _parent[_parent[label]];
+        label = _parent[label];
+    }
+    return label;
+}
+
+void ForceSegmenter::segment(const float *force, const unsigned char *labels,
+                             std::vector<Blob> &blobs)
+{
+    int r, c, i, n = _rows * _cols;
+    unsigned char *mask = _mask.data();
+    int *lab = _labels.data();
+    blobs.clear();
+
+    threshold(force, mask, n, _config.threshold);
+
+    // first pass: provisional labels with 8-connectivity, equivalences in _parent
+    _parent.assign(1, 0);
+    for (r = 0, i = 0; r < _rows; r++) {
+        for (c = 0; c < _cols; c++, i++) {
+            if (!mask[i]) {
+                lab[i] = 0;
+                continue;
+            }
+            int l = 0;
+            int neighbours[4] = {
+                c > 0 ? lab[i - 1] : 0,
+                r > 0 && c > 0 ? lab[i - _cols - 1] : 0,
+                r > 0 ? lab[i - _cols] : 0,
+                r > 0 && c < _cols - 1 ? lab[i - _cols + 1] : 0
+            };
+            for (int k = 0; k < 4; k++) {
+                int nl = neighbours[k];
+                if (!nl)
+                    continue;
+                if (!l) {
+                    l = find(nl);
+                    continue;
+                }
+                nl = find(nl);
+                if (nl < l)
+                    std::swap(nl, l);
+                _parent[nl] = l;
+            }
+            if (!l) {
+                l = (int)_parent.size();
+                _parent.push_back(l);
+            }
+            lab[i] = l;
+        }
+    }
+
+    // roots are always the smallest label in their set, so one ascending pass
+    // both flattens the forest and assigns compact component indices
+    int num_comp = 0, num_labels = (int)_parent.size();
+    for (int l = 1; l < num_labels; l++) {
+        int p = _parent[l];
+        _parent[l] = (p == l) ? ++num_comp : _parent[p];
+    }
+    if (!num_comp)
+        return;
+
+    // second pass: bucket sensel indices by component
+    _offsets.assign(num_comp + 2, 0);
+    for (i = 0; i < n; i++) {
+        if (lab[i]) {
+            lab[i] = _parent[lab[i]];
+            ++_offsets[lab[i] + 1];
+        }
+    }
+    for (int k = 1; k <= num_comp + 1; k++)
+        _offsets[k] += _offsets[k - 1];
+    _cursor.assign(_offsets.begin(), _offsets.end());
+    for (i = 0; i < n; i++) {
+        if (lab[i])
+            _pixels[_cursor[lab[i]]++] = i;
+    }
+
+    for (int k = 1; k <= num_comp; k++) {
+        const int *pixels = &_pixels[_offsets[k]];
+        int count = _offsets[k + 1] - _offsets[k];
+        // palm rejection applies to the whole region before any splitting
+        if (count < _config.min_area || count > _config.max_area)
+            continue;
+        if (_config.split_distance > 0)
+            split(force, pixels, count, blobs);
+        else {
+            Moments m;
+            m.clear();
+            for (int j = 0; j < count; j++)
+                m.add(force[pixels[j]], pixels[j] % _cols, pixels[j] / _cols);
+            Blob b;
+            if (m.finish(_config, b))
+                blobs.push_back(b);
+        }
+    }
+}
+
+// separate a region containing several well-separated force peaks by assigning
+// each sensel to its nearest peak
+void ForceSegmenter::split(const float *force, const int *pixels, int count,
+                           std::vector<Blob> &blobs)
+{
+    _peaks.clear();
+    for (int j = 0; j < count; j++) {
+        int p = pixels[j], r = p / _cols, c = p % _cols;
+        float f = force[p];
+        if (f < _config.peak_threshold)
+            continue;
+        bool is_peak = true;
+        for (int dr = -1; dr <= 1 && is_peak; dr++) {
+            for (int dc = -1; dc <= 1; dc++) {
+                int rr = r + dr, cc = c + dc;
+                if ((!dr && !dc) || rr < 0 || rr >= _rows || cc < 0 || cc >= _cols)
+                    continue;
+                // break ties in scan order so a plateau yields a single peak
+                float g = force[rr * _cols + cc];
+                if (g > f || (g == f && (dr < 0 || (!dr && dc < 0)))) {
+                    is_peak = false;
+                    break;
+                }
+            }
+        }
+        if (is_peak)
+            _peaks.push_back(p);
+    }
+
+    // non-maximum suppression, strongest peaks first
+    std::sort(_peaks.begin(), _peaks.end(),
+              [force](int a, int b) { return force[a] > force[b]; });
+    float min_dist2 = _config.split_distance * _config.split_distance;
+    int kept = 0;
+    for (size_t j = 0; j < _peaks.size() && kept < BT_MAX_CONTACTS; j++) {
+        int r = _peaks[j] / _cols, c = _peaks[j] % _cols;
+        bool keep = true;
+        for (int k = 0; k < kept; k++) {
+            int dr = r - _peaks[k] / _cols, dc = c - _peaks[k] % _cols;
+            if (dr * dr + dc * dc < min_dist2) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep)
+            _peaks[kept++] = _peaks[j];
+    }
+    if (!kept)
+        kept = 1;
+
+    Moments m[BT_MAX_CONTACTS];
+    for (int k = 0; k < kept; k++)
+        m[k].clear();
+    for (int j = 0; j < count; j++) {
+        int p = pixels[j], r = p / _cols, c = p % _cols, best = 0;
+        if (kept > 1) {
+            int best_dist = 0x7FFFFFFF;
+            for (int k = 0; k < kept; k++) {
+                int dr = r - _peaks[k] / _cols, dc = c - _peaks[k] % _cols;
+                int dist = dr * dr + dc * dc;
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = k;
+                }
+            }
+        }
+        m[best].add(force[p], c, r);
+    }
+    for (int k = 0; k < kept; k++) {
+        Blob b;
+        if (m[k].finish(_config, b))
+            blobs.push_back(b);
+    }
+}
+
+/********************************** LabelSegmenter **********************************/
+
+LabelSegmenter::LabelSegmenter(int rows, int cols, const bt_config &config)
+: _rows(rows), _cols(cols), _config(config)
+{
+    _acc.resize(NULL_LABEL);
+}
+
+void LabelSegmenter::segment(const float *force, const unsigned char *labels,
+                             std::vector<Blob> &blobs)
+{
+    blobs.clear();
+    if (!labels)
+        return;
+    for (auto &m : _acc)
+        m.clear();
+    for (int r = 0, i = 0; r < _rows; r++) {
+        for (int c = 0; c < _cols; c++, i++) {
+            if (labels[i] != NULL_LABEL)
+                _acc[labels[i]].add(force[i], c, r);
+        }
+    }
+    for (auto &m : _acc) {
+        Blob b;
+        if (m.n <= _config.max_area && m.finish(_config, b))
+            blobs.push_back(b);
+    }
+}
+
+/********************************* GreedyAssociator *********************************/
+
+static inline float distance(const SenselContact &a, const SenselContact &b)
+{
+    float dx = a.x_pos - b.x_pos, dy = a.y_pos - b.y_pos;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+void GreedyAssociator::associate(const std::vector<SenselContact> &prev,
+                                 const std::vector<SenselContact> &cur,
+                                 float max_jump, std::vector<int> &match)
+{
+    match.assign(cur.size(), -1);
+    _pairs.clear();
+    for (size_t i = 0; i < prev.size(); i++) {
+        for (size_t j = 0; j < cur.size(); j++) {
+            float d = distance(prev[i], cur[j]);
+            if (d <= max_jump)
+                _pairs.push_back({d, (int)i, (int)j});
+        }
+    }
+    std::sort(_pairs.begin(), _pairs.end(),
+              [](const Pair &a, const Pair &b) { return a.dist < b.dist; });
+
+    unsigned int prev_taken = 0;
+    for (auto &p : _pairs) {
+        if (match[p.cur] >= 0 || (prev_taken & (1u << p.prev)))
+            continue;
+        match[p.cur] = p.prev;
+        prev_taken |= 1u << p.prev;
+    }
+}
+
+/******************************* HungarianAssociator ********************************/
+
+void HungarianAssociator::associate(const std::vector<SenselContact> &prev,
+                                    const std::vector<SenselContact> &cur,
+                                    float max_jump, std::vector<int> &match)
+{
+    int np = (int)prev.size(), nc = (int)cur.size(), n = std::max(np, nc);
+    match.assign(nc, -1);
+    if (!np || !nc)
+        return;
+
+    // square cost matrix (1-based), padded with zero-cost dummy rows/columns;
+    // pairs beyond the gate get a prohibitive cost and are discarded afterwards
+    _cost.assign((n + 1) * (n + 1), 0);
+    for (int i = 0; i < np; i++) {
+        for (int j = 0; j < nc; j++) {
+            float d = distance(prev[i], cur[j]);
+            _cost[(i + 1) * (n + 1) + j + 1] = d <= max_jump ? d : NO_MATCH_COST;
+        }
+    }
+
+    _u.assign(n + 1, 0);
+    _v.assign(n + 1, 0);
+    _p.assign(n + 1, 0);
+    _way.assign(n + 1, 0);
+    for (int i = 1; i <= n; i++) {
+        _p[0] = i;
+        int j0 = 0;
+        _minv.assign(n + 1, INFINITY);
+        _used.assign(n + 1, 0);
+        do {
+            _used[j0] = 1;
+            int i0 = _p[j0], j1 = 0;
+            double delta = INFINITY;
+            for (int j = 1; j <= n; j++) {
+                if (_used[j])
+                    continue;
+                double cij = _cost[i0 * (n + 1) + j] - _u[i0] - _v[j];
+                if (cij < _minv[j]) {
+                    _minv[j] = cij;
+                    _way[j] = j0;
+                }
+                if (_minv[j] < delta) {
+                    delta = _minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= n; j++) {
+                if (_used[j]) {
+                    _u[_p[j]] += delta;
+                    _v[j] -= delta;
+                }
+                else
+                    _minv[j] -= delta;
+            }
+            j0 = j1;
+        } while (_p[j0]);
+        do {
+            int j1 = _way[j0];
+            _p[j0] = _p[j1];
+            j0 = j1;
+        } while (j0);
+    }
+
+    for (int j = 1; j <= nc; j++) {
+        int i = _p[j];
+        if (i >= 1 && i <= np && _cost[i * (n + 1) + j] < NO_MATCH_COST)
+            match[j - 1] = i - 1;
+    }
+}
+
+/*********************************** BlobTracker ************************************/
+
+BlobTracker::BlobTracker(const SenselSensorInfo &info, const bt_config &config)
+: _info(info), _config(config)
+{
+    _x_scale = info.num_cols ? info.width / info.num_cols : 1.f;
+    _y_scale = info.num_rows ? info.height / info.num_rows : 1.f;
+
+    if (config.segment == BT_SEGMENT_LABELS)
+        _segmenter.reset(new LabelSegmenter(info.num_rows, info.num_cols, config));
+    else
+        _segmenter.reset(new ForceSegmenter(info.num_rows, info.num_cols, config));
+
+    if (config.assoc == BT_ASSOC_HUNGARIAN)
+        _associator.reset(new HungarianAssociator);
+    else
+        _associator.reset(new GreedyAssociator);
+
+    _prev.reserve(BT_MAX_CONTACTS);
+    _cur.reserve(BT_MAX_CONTACTS);
+    _out.reserve(BT_MAX_CONTACTS * 2);
+}
+
+void BlobTracker::to_contact(const Blob &b, SenselContact &c)
+{
+    memset(&c, 0, sizeof(c));
+    c.content_bit_mask = CONTACT_MASK_ELLIPSE | CONTACT_MASK_DELTAS | CONTACT_MASK_PEAK;
+    c.x_pos = (b.x + 0.5f) * _x_scale;
+    c.y_pos = (b.y + 0.5f) * _y_scale;
+    c.total_force = b.force;
+    c.area = b.area;
+
+    // ellipse from the eigen-decomposition of the covariance in mm,
+    // axes are reported as full lengths at two standard deviations
+    float a = b.sxx * _x_scale * _x_scale;
+    float d = b.syy * _y_scale * _y_scale;
+    float o = b.sxy * _x_scale * _y_scale;
+    float mean = (a + d) * 0.5f;
+    float diff = sqrtf((a - d) * (a - d) * 0.25f + o * o);
+    c.major_axis = 4.f * sqrtf(std::max(mean + diff, 0.f));
+    c.minor_axis = 4.f * sqrtf(std::max(mean - diff, 0.f));
+    float angle = 0.5f * atan2f(2.f * o, a - d) * 180.f / (float)M_PI;
+    c.orientation = angle < 0 ? angle + 180.f : angle;
+
+    c.peak_x = (b.peak_x + 0.5f) * _x_scale;
+    c.peak_y = (b.peak_y + 0.5f) * _y_scale;
+    c.peak_force = b.peak_force;
+}
+
+int BlobTracker::process(const float *force, const unsigned char *labels)
+{
+    _segmenter->segment(force, labels, _blobs);
+
+    // keep the strongest blobs if there are more than we have ids for
+    if (_blobs.size() > BT_MAX_CONTACTS) {
+        std::partial_sort(_blobs.begin(), _blobs.begin() + BT_MAX_CONTACTS, _blobs.end(),
+                          [](const Blob &a, const Blob &b) { return a.force > b.force; });
+        _blobs.resize(BT_MAX_CONTACTS);
+    }
+
+    _cur.resize(_blobs.size());
+    for (size_t i = 0; i < _blobs.size(); i++)
+        to_contact(_blobs[i], _cur[i]);
+
+    _associator->associate(_prev, _cur, _config.max_jump, _match);
+
+    // ids of every previous contact stay reserved for this frame so that a
+    // released id is never restarted in the same frame it ends
+    memset(_id_used, 0, sizeof(_id_used));
+    unsigned int prev_matched = 0;
+    for (auto &p : _prev)
+        _id_used[p.id] = true;
+
+    _out.clear();
+    for (size_t i = 0; i < _cur.size(); i++) {
+        SenselContact &c = _cur[i];
+        int m = _match[i];
+        if (m >= 0) {
+            const SenselContact &p = _prev[m];
+            c.id = p.id;
+            c.state = CONTACT_MOVE;
+            c.delta_x = c.x_pos - p.x_pos;
+            c.delta_y = c.y_pos - p.y_pos;
+            c.delta_force = c.total_force - p.total_force;
+            c.delta_area = c.area - p.area;
+            prev_matched |= 1u << m;
+        }
+        else {
+            int id = 0;
+            while (id < BT_MAX_CONTACTS && _id_used[id])
+                ++id;
+            if (id == BT_MAX_CONTACTS)
+                continue;
+            _id_used[id] = true;
+            c.id = id;
+            c.state = CONTACT_START;
+        }
+        _out.push_back(c);
+    }
+
+    for (size_t i = 0; i < _prev.size(); i++) {
+        if (prev_matched & (1u << i))
+            continue;
+        SenselContact c = _prev[i];
+        c.state = CONTACT_END;
+        c.delta_x = c.delta_y = c.delta_force = c.delta_area = 0;
+        _out.push_back(c);
+    }
+
+    _prev.clear();
+    for (auto &c : _out) {
+        if (c.state != CONTACT_END)
+            _prev.push_back(c);
+    }
+    return (int)_out.size();
+}
+
+/************************************** C API ***************************************/
+
+struct _blob_tracker
+{
+    _blob_tracker(const SenselSensorInfo &info, const bt_config &config)
+    : tracker(info, config) {}
+    BlobTracker tracker;
+};
+
+void bt_config_default(bt_config *config)
+{
+    config->segment = BT_SEGMENT_FORCE;
+    config->assoc = BT_ASSOC_GREEDY;
+    config->threshold = 2.f;
+    config->peak_threshold = 10.f;
+    config->min_area = 2.f;
+    config->max_area = 400.f;
+    config->split_distance = 6.f;
+    config->max_jump = 20.f;
+}
+
+blob_tracker bt_new(const SenselSensorInfo *info, const bt_config *config)
+{
+    bt_config defaults;
+    if (!info || !info->num_rows || !info->num_cols)
+        return NULL;
+    if (!config) {
+        bt_config_default(&defaults);
+        config = &defaults;
+    }
+    return new _blob_tracker(*info, *config);
+}
+
+void bt_free(blob_tracker tracker)
+{
+    delete tracker;
+}
+
+int bt_process(blob_tracker tracker, const float *force, const unsigned char *labels)
+{
+    return tracker->tracker.process(force, labels);
+}
+
+SenselContact *bt_get_contacts(blob_tracker tracker)
+{
+    return tracker->tracker.contacts();
+}
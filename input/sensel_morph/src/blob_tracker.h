@@ -0,0 +1,199 @@
+#ifndef BLOB_TRACKER_H
+#define BLOB_TRACKER_H
+
+/* Software contact tracking over the raw Sensel force image.                *
+ * The firmware contact detection cannot be tuned, so this engine segments   *
+ * force_array (or regroups labels_array) itself and reports the results as  *
+ * ordinary SenselContact structures with persistent ids.                    */
+
+#include "sensel.h"
+
+#define BT_MAX_CONTACTS 16
+
+typedef enum {
+    BT_SEGMENT_FORCE  = 0,  // threshold + connected components on force_array
+    BT_SEGMENT_LABELS = 1,  // regroup force_array by the firmware labels_array
+} bt_segment_mode;
+
+typedef enum {
+    BT_ASSOC_GREEDY    = 0, // nearest pairs first
+    BT_ASSOC_HUNGARIAN = 1, // minimum total displacement
+} bt_assoc_mode;
+
+typedef struct {
+    bt_segment_mode segment;
+    bt_assoc_mode assoc;
+    float threshold;        // minimum sensel force (g) to be part of a blob
+    float peak_threshold;   // minimum peak force (g) for a blob to be reported
+    float min_area;         // smaller blobs are dropped (sensels)
+    float max_area;         // palm rejection: larger blobs are dropped (sensels)
+    float split_distance;   // min peak separation (sensels) to split merged blobs, 0 disables
+    float max_jump;         // max displacement (mm) between frames for id association
+} bt_config;
+
+/* header of a raw force recording written by mpr.morph --record, followed
+ * by frames of num_rows * num_cols floats */
+typedef struct {
+    char magic[4];          // "SFRC"
+    unsigned short num_rows;
+    unsigned short num_cols;
+    float width;
+    float height;
+} bt_recording_header;
+
+typedef struct _blob_tracker *blob_tracker;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void bt_config_default(bt_config *config);
+
+blob_tracker bt_new(const SenselSensorInfo *info, const bt_config *config);
+
+void bt_free(blob_tracker tracker);
+
+/* Process one frame. labels may be NULL unless the segment mode is
+ * BT_SEGMENT_LABELS. Returns the number of contacts, including contacts in
+ * CONTACT_END state for ids released since the previous frame. */
+int bt_process(blob_tracker tracker, const float *force, const unsigned char *labels);
+
+/* Contacts produced by the last call to bt_process(); valid until the next call. */
+SenselContact *bt_get_contacts(blob_tracker tracker);
+
+#ifdef __cplusplus
+}
+
+#include <memory>
+#include <vector>
+
+namespace sensel {
+
+// a segmented region of the force image, in sensel coordinates
+struct Blob
+{
+    float x, y;             // force-weighted centroid
+    float force;            // total force
+    float area;             // number of sensels
+    float sxx, syy, sxy;    // force-weighted second central moments
+    float peak_x, peak_y, peak_force;
+};
+
+// running sums used to reduce a set of sensels to a Blob
+struct Moments
+{
+    double f, x, y, xx, yy, xy;
+    int n;
+    float peak;
+    int peak_x, peak_y;
+
+    void clear() { f = x = y = xx = yy = xy = 0; n = 0; peak = 0; peak_x = peak_y = 0; }
+    void add(float force, int col, int row);
+    bool finish(const bt_config &config, Blob &b) const;
+};
+
+class Segmenter
+{
+public:
+    virtual ~Segmenter() {}
+    virtual void segment(const float *force, const unsigned char *labels,
+                         std::vector<Blob> &blobs) = 0;
+};
+
+class Associator
+{
+public:
+    virtual ~Associator() {}
+    // fill match[i] with the index into prev for cur[i], or -1 for a new contact
+    virtual void associate(const std::vector<SenselContact> &prev,
+                           const std::vector<SenselContact> &cur,
+                           float max_jump, std::vector<int> &match) = 0;
+};
+
+class ForceSegmenter : public Segmenter
+{
+public:
+    ForceSegmenter(int rows, int cols, const bt_config &config);
+    void segment(const float *force, const unsigned char *labels, std::vector<Blob> &blobs);
+
+private:
+    int find(int label);
+    void split(const float *force, const int *pixels, int count, std::vector<Blob> &blobs);
+
+    int _rows, _cols;
+    bt_config _config;
+    std::vector<unsigned char> _mask;
+    std::vector<int> _labels;
+    std::vector<int> _parent;
+    std::vector<int> _offsets;
+    std::vector<int> _cursor;
+    std::vector<int> _pixels;
+    std::vector<int> _peaks;
+};
+
+class LabelSegmenter : public Segmenter
+{
+public:
+    LabelSegmenter(int rows, int cols, const bt_config &config);
+    void segment(const float *force, const unsigned char *labels, std::vector<Blob> &blobs);
+
+private:
+    int _rows, _cols;
+    bt_config _config;
+    std::vector<Moments> _acc;
+};
+
+class GreedyAssociator : public Associator
+{
+public:
+    void associate(const std::vector<SenselContact> &prev, const std::vector<SenselContact> &cur,
+                   float max_jump, std::vector<int> &match);
+
+private:
+    struct Pair { float dist; int prev, cur; };
+    std::vector<Pair> _pairs;
+};
+
+class HungarianAssociator : public Associator
+{
+public:
+    void associate(const std::vector<SenselContact> &prev, const std::vector<SenselContact> &cur,
+                   float max_jump, std::vector<int> &match);
+
+private:
+    std::vector<double> _cost, _u, _v, _minv;
+    std::vector<int> _p, _way;
+    std::vector<char> _used;
+};
+
+class BlobTracker
+{
+public:
+    BlobTracker(const SenselSensorInfo &info, const bt_config &config);
+
+    // replace the segmentation or association stage
+    void set_segmenter(std::unique_ptr<Segmenter> segmenter) { _segmenter = std::move(segmenter); }
+    void set_associator(std::unique_ptr<Associator> associator) { _associator = std::move(associator); }
+
+    int process(const float *force, const unsigned char *labels);
+    SenselContact *contacts() { return _out.data(); }
+
+private:
+    void to_contact(const Blob &b, SenselContact &c);
+
+    SenselSensorInfo _info;
+    bt_config _config;
+    float _x_scale, _y_scale;
+    std::unique_ptr<Segmenter> _segmenter;
+    std::unique_ptr<Associator> _associator;
+    std::vector<Blob> _blobs;
+    std::vector<SenselContact> _prev, _cur, _out;
+    std::vector<int> _match;
+    bool _id_used[BT_MAX_CONTACTS];
+};
+
+} // namespace sensel
+
+#endif // __cplusplus
+
+#endif // BLOB_TRACKER_H
@@ -6,6 +6,7 @@
 #include "sensel.h"
 #include "sensel_device.h"
 #include "mapper/mapper.h"
+#include "blob_tracker.h"
 
 const char *default_name = "morph";
 SENSEL_HANDLE handle = NULL;
@@ -15,6 +16,11 @@ SenselFrameData *frame = NULL;
 unsigned int last_n_contacts = 0;
 int verbose = 1;
 int done = 0;
+int software_tracking = 0;
+bt_assoc_mode assoc = BT_ASSOC_GREEDY;
+bt_segment_mode segment = BT_SEGMENT_FORCE;
+blob_tracker tracker = NULL;
+FILE *record = NULL;
 
 mpr_dev dev;
 mpr_sig num_contacts;
@@ -39,7 +45,9 @@ static void eprintf(const char *format, ...)
 
 void loop()
 {
-    unsigned int n_frames = 0;
+    unsigned int n_frames = 0, n_contacts;
+    size_t n_sensels = (size_t)sensor_info.num_rows * sensor_info.num_cols;
+    SenselContact *contacts;
 
     while (!done) {
         senselReadSensor(handle);
@@ -48,16 +56,28 @@ void loop()
         for (int f = 0; f < n_frames; f++) {
             senselGetFrame(handle, frame);
 
-            if (!frame->n_contacts && !last_n_contacts)
+            if (record)
+                fwrite(frame->force_array, sizeof(float), n_sensels, record);
+
+            if (tracker) {
+                n_contacts = bt_process(tracker, frame->force_array, frame->labels_array);
+                contacts = bt_get_contacts(tracker);
+            }
+            else {
+                n_contacts = frame->n_contacts;
+                contacts = frame->contacts;
+            }
+
+            if (!n_contacts && !last_n_contacts)
                 continue;
-            else if (frame->n_contacts != last_n_contacts)
-                eprintf("num_contacts: %d\n", frame->n_contacts);
+            else if (n_contacts != last_n_contacts)
+                eprintf("num_contacts: %d\n", n_contacts);
 
-            mpr_sig_set_value(num_contacts, 0, 1, MPR_INT32, &frame->n_contacts);
+            mpr_sig_set_value(num_contacts, 0, 1, MPR_INT32, &n_contacts);
             mpr_sig_set_value(acceleration, 0, 3, MPR_INT32, &frame->accel_data);
 
-            for (int c = 0; c < frame->n_contacts; c++) {
-                SenselContact sc = frame->contacts[c];
+            for (int c = 0; c < n_contacts; c++) {
+                SenselContact sc = contacts[c];
                 unsigned int state = sc.state;
                 register int id = (int)sc.id;
 
@@ -83,7 +103,7 @@ void loop()
                 }
             }
             mpr_dev_update_maps(dev);
-            last_n_contacts = frame->n_contacts;
+            last_n_contacts = n_contacts;
         }
         mpr_dev_poll(dev, 0);
     }
@@ -108,17 +128,36 @@ int main(int argc, char **argv)
                     case 'h':
                         printf("mpr.morph.c: possible arguments "
                                "-q quiet (suppress output), "
+                               "-s software contact tracking, "
                                "-h help, "
+                               "--hungarian optimal contact id association, "
+                               "--labels software tracking of the firmware's contact labels, "
+                               "--record <file> record raw force frames, "
                                "--alias <string> (default: '%s')\n", default_name);
                         return 1;
                         break;
                     case 'q':
                         verbose = 0;
                         break;
+                    case 's':
+                        software_tracking = 1;
+                        break;
                     case '-':
-                        if (++j < len && strcmp(argv[i]+j, "alias")==0)
+                        if (++j < len && strcmp(argv[i]+j, "alias")==0) {
                             if (++i < argc)
                                 dev_name = argv[i];
+                        }
+                        else if (strcmp(argv[i]+j, "hungarian")==0)
+                            assoc = BT_ASSOC_HUNGARIAN;
+                        else if (strcmp(argv[i]+j, "labels")==0) {
+                            segment = BT_SEGMENT_LABELS;
+                            software_tracking = 1;
+                        }
+                        else if (strcmp(argv[i]+j, "record")==0) {
+                            if (++i < argc && !(record = fopen(argv[i], "wb")))
+                                printf("could not open %s for recording\n", argv[i]);
+                        }
+                        j = len;
                         break;
                     default:
                         break;
@@ -179,8 +218,33 @@ int main(int argc, char **argv)
 
     // open connection to Sensel Morph
     senselOpenDeviceByID(&handle, list.devices[0].idx);
-    // setup for contact and accelerometer data
-    senselSetFrameContent(handle, FRAME_CONTENT_CONTACTS_MASK | FRAME_CONTENT_ACCEL_MASK);
+    senselGetSensorInfo(handle, &sensor_info);
+
+    // setup for contact and accelerometer data, plus the force image if we
+    // are tracking contacts ourselves or recording, and the firmware's
+    // labels of it if we track those
+    unsigned char content = FRAME_CONTENT_CONTACTS_MASK | FRAME_CONTENT_ACCEL_MASK;
+    if (software_tracking || record)
+        content |= FRAME_CONTENT_PRESSURE_MASK;
+    if (segment == BT_SEGMENT_LABELS)
+        content |= FRAME_CONTENT_LABELS_MASK;
+    senselSetFrameContent(handle, content);
+
+    if (software_tracking) {
+        bt_config config;
+        bt_config_default(&config);
+        config.assoc = assoc;
+        config.segment = segment;
+        tracker = bt_new(&sensor_info, &config);
+        eprintf("using software contact tracking%s\n",
+                segment == BT_SEGMENT_LABELS ? " of the firmware's labels" : "");
+    }
+    if (record) {
+        bt_recording_header header = {{'S', 'F', 'R', 'C'}, sensor_info.num_rows,
+                                      sensor_info.num_cols, sensor_info.width,
+                                      sensor_info.height};
+        fwrite(&header, sizeof(header), 1, record);
+    }
     // pre-allocate a frame of data
     senselAllocateFrameData(handle, &frame);
     // start scanning
@@ -198,7 +262,13 @@ int main(int argc, char **argv)
     senselWriteReg(handle, 0xD0, 1, val);
     senselClose(handle);
 
+    if (tracker)
+        bt_free(tracker);
+
 done:
+    if (record)
+        fclose(record);
+
     // unregister from mapping graph
     mpr_dev_free(dev);
     return 0;
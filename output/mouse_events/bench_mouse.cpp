@@ -0,0 +1,45 @@
+/* Cost of the mouse core at 1 kHz input, flushed at typical poll rates. */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include "mouse_core.h"
+
+#define INPUT_RATE 1000
+#define SECONDS 600 // simulated
+
+int main()
+{
+    const int poll_rates[] = {125, 250, 500, 1000};
+    FILE *devnull = fopen("/dev/null", "w");
+
+    for (int sink_type = 0; sink_type < 2; sink_type++) {
+        for (int rate : poll_rates) {
+            mouse::NullSink null_sink;
+            mouse::RecordingSink record_sink(devnull);
+            mouse::Sink &sink = sink_type ? (mouse::Sink&)record_sink : (mouse::Sink&)null_sink;
+            mouse::Core core(sink);
+            long updates = (long)INPUT_RATE * SECONDS, events = 0;
+            int per_poll = INPUT_RATE / rate;
+
+            auto start = std::chrono::steady_clock::now();
+            for (long i = 0; i < updates; i++) {
+                double t = (double)i / INPUT_RATE;
+                core.move(0.5f + 0.4f * sinf(t), 0.5f + 0.4f * cosf(t * 0.7f));
+                // a click every two seconds, dragging for half a second
+                if (i % 2000 == 0)
+                    core.button(MC_BUTTON_LEFT, true);
+                else if (i % 2000 == 500)
+                    core.button(MC_BUTTON_LEFT, false);
+                if ((i + 1) % per_poll == 0)
+                    events += core.flush(t);
+            }
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf("%s sink, %4d Hz polls: %5.1f ns/update, %.2f updates per event, %.1fx real time\n",
+                   sink_type ? "recording" : "null", rate, elapsed * 1e9 / updates,
+                   (double)updates / events, SECONDS / elapsed);
+        }
+    }
+    fclose(devnull);
+    return 0;
+}
@@ -0,0 +1,170 @@
+/* Headless/Linux libmapper mouse bridge built on the portable mouse core.   *
+ * Events go to a uinput virtual pointer by default, or are logged with      *
+ * timestamps using --record <file> (use '-' for stdout).                    */
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <memory>
+#include <mapper/mapper.h>
+#include "mouse_core.h"
+
+const char *default_name = "mouse";
+mouse::Core *core = NULL;
+int done = 0;
+
+void cursor_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                    mpr_type type, const void *val, mpr_time time)
+{
+    if (!val)
+        return;
+    const float *valf = (const float*)val;
+    core->move(valf[0], valf[1]);
+}
+
+void drag_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                  mpr_type type, const void *val, mpr_time time)
+{
+    switch (evt) {
+        case MPR_SIG_INST_NEW:
+            core->drag(true);
+            break;
+        case MPR_SIG_REL_UPSTRM:
+            mpr_sig_release_inst(sig, inst);
+            core->drag(false);
+            break;
+        case MPR_SIG_UPDATE:
+            if (val)
+                core->move(((const float*)val)[0], ((const float*)val)[1]);
+            break;
+        default:
+            break;
+    }
+}
+
+void left_button_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                         mpr_type type, const void *val, mpr_time time)
+{
+    core->button(MC_BUTTON_LEFT, val && *(const int*)val > 0);
+}
+
+void right_button_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                          mpr_type type, const void *val, mpr_time time)
+{
+    core->button(MC_BUTTON_RIGHT, val && *(const int*)val > 0);
+}
+
+void scroll_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                    mpr_type type, const void *val, mpr_time time)
+{
+    if (val)
+        core->scroll(((const float*)val)[0], ((const float*)val)[1]);
+}
+
+mpr_dev start_mpr_dev(const char *name)
+{
+    printf("starting mpr_dev with name %s\n", name);
+    mpr_dev d = mpr_dev_new(name, 0);
+
+    int one = 1;
+    float minf[2] = {0.f, 0.f}, maxf[2] = {1.f, 1.f};
+    mpr_sig_new(d, MPR_DIR_IN, "position", 2, MPR_FLT, "normalized", minf, maxf,
+                NULL, cursor_handler, MPR_SIG_UPDATE);
+    mpr_sig_new(d, MPR_DIR_IN, "drag", 2, MPR_FLT, "normalized", minf, maxf,
+                &one, drag_handler, MPR_SIG_ALL);
+
+    minf[0] = minf[1] = -1.f;
+    mpr_sig_new(d, MPR_DIR_IN, "scrollWheel", 2, MPR_FLT, "normalized", minf, maxf,
+                NULL, scroll_handler, MPR_SIG_UPDATE);
+
+    int mini = 0, maxi = 1;
+    mpr_sig_new(d, MPR_DIR_IN, "button/left", 1, MPR_INT32, NULL, &mini, &maxi,
+                NULL, left_button_handler, MPR_SIG_UPDATE);
+    mpr_sig_new(d, MPR_DIR_IN, "button/right", 1, MPR_INT32, NULL, &mini, &maxi,
+                NULL, right_button_handler, MPR_SIG_UPDATE);
+    return d;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j;
+    const char *dev_name = default_name;
+    const char *record_path = NULL;
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("mapper_mouse: possible arguments "
+                               "-h help, "
+                               "--record <file> log events instead of injecting them ('-' for stdout), "
+                               "--alias <string> (default: '%s')\n", default_name);
+                        return 1;
+                        break;
+                    case '-':
+                        if (++j < len && strcmp(argv[i]+j, "alias")==0) {
+                            if (++i < argc)
+                                dev_name = argv[i];
+                        }
+                        else if (strcmp(argv[i]+j, "record")==0) {
+                            if (++i < argc)
+                                record_path = argv[i];
+                        }
+                        j = len;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    std::unique_ptr<mouse::Sink> sink;
+    FILE *record = NULL;
+    if (record_path) {
+        record = strcmp(record_path, "-") ? fopen(record_path, "w") : stdout;
+        if (!record) {
+            printf("could not open %s\n", record_path);
+            return 1;
+        }
+        sink.reset(new mouse::RecordingSink(record));
+    }
+    else {
+#ifdef __linux__
+        mouse::UinputSink *uinput = new mouse::UinputSink;
+        sink.reset(uinput);
+        if (!uinput->ok()) {
+            perror("could not create uinput device (try --record)");
+            return 1;
+        }
+#else
+        printf("no event injection on this platform, use --record\n");
+        return 1;
+#endif
+    }
+    core = new mouse::Core(*sink);
+
+    signal(SIGINT, ctrlc);
+    mpr_dev dev = start_mpr_dev(dev_name);
+
+    // everything received during one poll is coalesced into a single flush
+    auto start = std::chrono::steady_clock::now();
+    while (!done) {
+        mpr_dev_poll(dev, 1);
+        core->flush(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    printf("freeing mpr dev %s\n", mpr_obj_get_prop_as_str(dev, MPR_PROP_NAME, NULL));
+    mpr_dev_free(dev);
+    delete core;
+    if (record && record != stdout)
+        fclose(record);
+    return 0;
+}
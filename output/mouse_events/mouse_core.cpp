@@ -0,0 +1,287 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include "mouse_core.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+#define UINPUT_ABS_MAX 65535
+#define UINPUT_SCROLL_SCALE 10.f // wheel detents per normalized unit
+#endif
+
+#define MAX_PENDING 16
+#define DOUBLE_CLICK_SEC 1.0
+
+using namespace mouse;
+
+const char *mouse::event_name(int type)
+{
+    switch (type) {
+        case MOUSE_MOVED:           return "MOUSE_MOVED";
+        case LEFT_BUTTON_UP:        return "LEFT_BUTTON_UP";
+        case LEFT_BUTTON_DOWN:      return "LEFT_BUTTON_DOWN";
+        case LEFT_MOUSE_DRAGGED:    return "LEFT_MOUSE_DRAGGED";
+        case RIGHT_BUTTON_UP:       return "RIGHT_BUTTON_UP";
+        case RIGHT_BUTTON_DOWN:     return "RIGHT_BUTTON_DOWN";
+        case RIGHT_MOUSE_DRAGGED:   return "RIGHT_MOUSE_DRAGGED";
+        case SCROLL_WHEEL:          return "SCROLL_WHEEL";
+        default:                    return "UNKNOWN";
+    }
+}
+
+/************************************** Core ****************************************/
+
+Core::Core(Sink &sink, float epsilon)
+: _sink(sink), _epsilon(epsilon), _updated(false), _scrolled(false),
+  _click_counter(1), _click_time(-DOUBLE_CLICK_SEC)
+{
+    _current.x = _current.y = _last.x = _last.y = 0;
+    _scroll.x = _scroll.y = 0;
+    _down[MC_BUTTON_LEFT] = _down[MC_BUTTON_RIGHT] = false;
+    _pending.reserve(MAX_PENDING);
+}
+
+void Core::move(float x, float y)
+{
+    // check for NaN just in case
+    if (x != x || y != y)
+        return;
+    _current.x = x;
+    _current.y = y;
+    _updated = true;
+}
+
+void Core::button(int button, bool pressed)
+{
+    if (button != MC_BUTTON_LEFT && button != MC_BUTTON_RIGHT)
+        return;
+    if (_down[button] == pressed || _pending.size() >= MAX_PENDING)
+        return;
+    _down[button] = pressed;
+    if (button == MC_BUTTON_LEFT)
+        _pending.push_back(pressed ? LEFT_BUTTON_DOWN : LEFT_BUTTON_UP);
+    else
+        _pending.push_back(pressed ? RIGHT_BUTTON_DOWN : RIGHT_BUTTON_UP);
+}
+
+void Core::drag(bool active)
+{
+    button(MC_BUTTON_LEFT, active);
+}
+
+void Core::scroll(float dx, float dy)
+{
+    _scroll.x += dx;
+    _scroll.y += dy;
+    _scrolled = true;
+}
+
+// a button down within DOUBLE_CLICK_SEC of the previous one is a double click
+int Core::click_count(int evt, double now)
+{
+    if (evt == LEFT_BUTTON_DOWN || evt == RIGHT_BUTTON_DOWN) {
+        _click_counter = (now - _click_time) < DOUBLE_CLICK_SEC ? 2 : 1;
+        _click_time = now;
+    }
+    return _click_counter;
+}
+
+int Core::flush(double now)
+{
+    int emitted = 0;
+
+    // button transitions carry the latest position, so they also complete any
+    // motion received during this poll
+    if (!_pending.empty()) {
+        for (int evt : _pending)
+            _sink.emit(evt, _current.x, _current.y, click_count(evt, now));
+        emitted += (int)_pending.size();
+        _pending.clear();
+        _last = _current;
+        _updated = false;
+    }
+
+    if (_scrolled) {
+        _sink.emit(SCROLL_WHEEL, _scroll.x, _scroll.y, 1);
+        _scroll.x = _scroll.y = 0;
+        _scrolled = false;
+        ++emitted;
+    }
+
+    if (!_updated)
+        return emitted;
+    _updated = false;
+
+    if (fabsf(_current.x - _last.x) < _epsilon && fabsf(_current.y - _last.y) < _epsilon)
+        return emitted;
+    _last = _current;
+
+    int evt = MOUSE_MOVED;
+    if (_down[MC_BUTTON_LEFT])
+        evt = LEFT_MOUSE_DRAGGED;
+    else if (_down[MC_BUTTON_RIGHT])
+        evt = RIGHT_MOUSE_DRAGGED;
+    _sink.emit(evt, _current.x, _current.y, 0);
+    return emitted + 1;
+}
+
+/********************************* RecordingSink ************************************/
+
+static double monotonic_seconds()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+RecordingSink::RecordingSink(FILE *file)
+: _file(file), _start(monotonic_seconds())
+{}
+
+void RecordingSink::emit(int type, float x, float y, int count)
+{
+    fprintf(_file, "%.6f %s %f %f %d\n", monotonic_seconds() - _start, event_name(type),
+            x, y, count);
+}
+
+/*********************************** UinputSink *************************************/
+
+#ifdef __linux__
+
+UinputSink::UinputSink(const char *name)
+{
+    struct uinput_setup setup;
+    struct uinput_abs_setup abs;
+
+    _fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (_fd < 0)
+        return;
+
+    ioctl(_fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(_fd, UI_SET_KEYBIT, BTN_LEFT);
+    ioctl(_fd, UI_SET_KEYBIT, BTN_RIGHT);
+    ioctl(_fd, UI_SET_EVBIT, EV_REL);
+    ioctl(_fd, UI_SET_RELBIT, REL_WHEEL);
+    ioctl(_fd, UI_SET_RELBIT, REL_HWHEEL);
+    ioctl(_fd, UI_SET_EVBIT, EV_ABS);
+    ioctl(_fd, UI_SET_ABSBIT, ABS_X);
+    ioctl(_fd, UI_SET_ABSBIT, ABS_Y);
+    ioctl(_fd, UI_SET_PROPBIT, INPUT_PROP_POINTER);
+
+    memset(&abs, 0, sizeof(abs));
+    abs.absinfo.maximum = UINPUT_ABS_MAX;
+    abs.code = ABS_X;
+    ioctl(_fd, UI_ABS_SETUP, &abs);
+    abs.code = ABS_Y;
+    ioctl(_fd, UI_ABS_SETUP, &abs);
+
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1);
+    if (ioctl(_fd, UI_DEV_SETUP, &setup) < 0 || ioctl(_fd, UI_DEV_CREATE) < 0) {
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+UinputSink::~UinputSink()
+{
+    if (_fd < 0)
+        return;
+    ioctl(_fd, UI_DEV_DESTROY);
+    close(_fd);
+}
+
+void UinputSink::write_event(int type, int code, int value)
+{
+    struct input_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+    if (write(_fd, &ev, sizeof(ev)) < 0)
+        perror("uinput");
+}
+
+// the kernel does its own double-click detection, so count is not used here
+void UinputSink::emit(int type, float x, float y, int count)
+{
+    if (_fd < 0)
+        return;
+    if (type == SCROLL_WHEEL) {
+        int h = (int)lrintf(x * UINPUT_SCROLL_SCALE), v = (int)lrintf(y * UINPUT_SCROLL_SCALE);
+        if (h)
+            write_event(EV_REL, REL_HWHEEL, h);
+        if (v)
+            write_event(EV_REL, REL_WHEEL, v);
+        write_event(EV_SYN, SYN_REPORT, 0);
+        return;
+    }
+
+    x = x < 0 ? 0 : x > 1 ? 1 : x;
+    y = y < 0 ? 0 : y > 1 ? 1 : y;
+    write_event(EV_ABS, ABS_X, (int)(x * UINPUT_ABS_MAX));
+    write_event(EV_ABS, ABS_Y, (int)(y * UINPUT_ABS_MAX));
+    switch (type) {
+        case LEFT_BUTTON_DOWN:  write_event(EV_KEY, BTN_LEFT, 1);   break;
+        case LEFT_BUTTON_UP:    write_event(EV_KEY, BTN_LEFT, 0);   break;
+        case RIGHT_BUTTON_DOWN: write_event(EV_KEY, BTN_RIGHT, 1);  break;
+        case RIGHT_BUTTON_UP:   write_event(EV_KEY, BTN_RIGHT, 0);  break;
+        default:                                                    break;
+    }
+    write_event(EV_SYN, SYN_REPORT, 0);
+}
+
+#endif // __linux__
+
+/************************************** C API ***************************************/
+
+struct _mouse_core
+{
+    _mouse_core(mc_emit_func emit) : sink(emit), core(sink) {}
+    FunctionSink sink;
+    Core core;
+};
+
+mouse_core mc_new(mc_emit_func emit)
+{
+    return emit ? new _mouse_core(emit) : NULL;
+}
+
+void mc_free(mouse_core core)
+{
+    delete core;
+}
+
+void mc_set_epsilon(mouse_core core, float epsilon)
+{
+    core->core.set_epsilon(epsilon);
+}
+
+void mc_move(mouse_core core, float x, float y)
+{
+    core->core.move(x, y);
+}
+
+void mc_button(mouse_core core, int button, int pressed)
+{
+    core->core.button(button, pressed != 0);
+}
+
+void mc_drag(mouse_core core, int active)
+{
+    core->core.drag(active != 0);
+}
+
+void mc_scroll(mouse_core core, float dx, float dy)
+{
+    core->core.scroll(dx, dy);
+}
+
+int mc_flush(mouse_core core, double now)
+{
+    return core->core.flush(now);
+}
@@ -0,0 +1,150 @@
+#ifndef MOUSE_CORE_H
+#define MOUSE_CORE_H
+
+/* Platform-neutral mouse event synthesis: click counting, drag state and    *
+ * epsilon filtering for the libmapper mouse bridges. Input handlers only    *
+ * update state; mc_flush() turns everything received since the last poll    *
+ * into at most one motion event plus any button and scroll events.          */
+
+#ifndef MOUSE_MOVED
+#define MOUSE_MOVED 0
+#define LEFT_BUTTON_UP 1
+#define LEFT_BUTTON_DOWN 2
+#define LEFT_MOUSE_DRAGGED 3
+#define RIGHT_BUTTON_UP 4
+#define RIGHT_BUTTON_DOWN 5
+#define RIGHT_MOUSE_DRAGGED 6
+#define SCROLL_WHEEL 7
+#endif
+
+#define MC_BUTTON_LEFT 0
+#define MC_BUTTON_RIGHT 1
+
+typedef void (*mc_emit_func)(int type, float x, float y, int count);
+
+typedef struct _mouse_core *mouse_core;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* create a core that emits through a plain function, e.g. emit_mouse_evt() */
+mouse_core mc_new(mc_emit_func emit);
+
+void mc_free(mouse_core core);
+
+void mc_set_epsilon(mouse_core core, float epsilon);
+
+void mc_move(mouse_core core, float x, float y);
+
+void mc_button(mouse_core core, int button, int pressed);
+
+/* a drag instance starting (active = 1) or ending (active = 0) */
+void mc_drag(mouse_core core, int active);
+
+void mc_scroll(mouse_core core, float dx, float dy);
+
+/* emit events for everything received since the previous flush; now is in
+ * seconds and only used for click counting. Returns the number of events. */
+int mc_flush(mouse_core core, double now);
+
+#ifdef __cplusplus
+}
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace mouse {
+
+class Sink
+{
+public:
+    virtual ~Sink() {}
+    virtual void emit(int type, float x, float y, int count) = 0;
+};
+
+// discards everything, for benchmarking the core
+class NullSink : public Sink
+{
+public:
+    NullSink() : events(0) {}
+    void emit(int type, float x, float y, int count) { ++events; }
+    unsigned long events;
+};
+
+// forwards to a C function such as the Swift emit_mouse_evt()
+class FunctionSink : public Sink
+{
+public:
+    FunctionSink(mc_emit_func func) : _func(func) {}
+    void emit(int type, float x, float y, int count) { _func(type, x, y, count); }
+
+private:
+    mc_emit_func _func;
+};
+
+// logs timestamped events to a file so the bridge can be exercised headless
+class RecordingSink : public Sink
+{
+public:
+    RecordingSink(FILE *file);
+    void emit(int type, float x, float y, int count);
+
+private:
+    FILE *_file;
+    double _start;
+};
+
+#ifdef __linux__
+// injects events into the kernel through /dev/uinput as an absolute pointer
+class UinputSink : public Sink
+{
+public:
+    UinputSink(const char *name = "libmapper mouse");
+    ~UinputSink();
+    bool ok() const { return _fd >= 0; }
+    void emit(int type, float x, float y, int count);
+
+private:
+    void write_event(int type, int code, int value);
+    int _fd;
+};
+#endif
+
+const char *event_name(int type);
+
+class Core
+{
+public:
+    Core(Sink &sink, float epsilon = 0.001f);
+
+    void set_epsilon(float epsilon) { _epsilon = epsilon; }
+    void move(float x, float y);
+    void button(int button, bool pressed);
+    void drag(bool active);
+    void scroll(float dx, float dy);
+    int flush(double now);
+
+private:
+    struct Point { float x, y; };
+
+    int click_count(int evt, double now);
+
+    Sink &_sink;
+    float _epsilon;
+    Point _current, _last;
+    Point _scroll;
+    bool _updated, _scrolled;
+    bool _down[2];
+    // button transitions in arrival order, so fast clicks are not lost
+    std::vector<int> _pending;
+    int _click_counter;
+    double _click_time;
+};
+
+} // namespace mouse
+
+#endif // __cplusplus
+
+#endif // MOUSE_CORE_H
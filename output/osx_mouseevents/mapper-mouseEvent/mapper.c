@@ -11,112 +11,26 @@
 extern void emit_mouse_evt(int, float, float, int);
 
 mpr_dev dev = NULL;
-
-int updated;
-float epsilon = 0.001;
-
-int leftButtonStatus = 0;
-int rightButtonStatus = 0;
-
-typedef struct {
-    float x;
-    float y;
-} point;
-
-point current;
-point last;
+mouse_core core = NULL;
 
 void errorHandler(int num, const char *msg, const char *where)
 {
     printf("liblo server error %d in path %s: %s\n", num, where, msg);
 }
 
-int sign(int value)
-{
-    return value > 0 ? 1 : -1;
-}
-
 double get_current_time() {
     struct timeval tv;
     gettimeofday(&tv, NULL);
     return (double)tv.tv_sec + tv.tv_usec / 1000000.0;
 }
 
-// grab time when button down pressed, if within 1sec increment click count
-int click_count(int evt)
-{
-    static int click_counter = 1;
-    static double timetag = 0;
-
-    if (evt == LEFT_BUTTON_DOWN || evt == RIGHT_BUTTON_DOWN) {
-        double now = get_current_time();
-        if ((now - timetag) < 1.0)
-            click_counter = 2;
-        else
-            click_counter = 1;
-        timetag = now;
-    }
-    return click_counter;
-}
-
-int emit()
-{
-    float dx = current.x - last.x;
-    float dy = current.y - last.y;
-
-    // handle buttons
-    int evt = 0;
-    if (leftButtonStatus > 1)
-        evt = LEFT_BUTTON_DOWN;
-    else if (leftButtonStatus < -1)
-        evt = LEFT_BUTTON_UP;
-    else if (rightButtonStatus > 1)
-        evt = RIGHT_BUTTON_DOWN;
-    else if (rightButtonStatus < -1)
-        evt = RIGHT_BUTTON_UP;
-
-    if (evt) {
-        int count = click_count(evt);
-        printf("emitting CLICK %d x %d\n", evt, count);
-        emit_mouse_evt(evt, current.x, current.y, count);
-        leftButtonStatus = sign(leftButtonStatus);
-        rightButtonStatus = sign(rightButtonStatus);
-        return 0;
-    }
-
-    if (fabsf(dx) < epsilon && fabsf(dy) < epsilon)
-        return 0;
-
-    last.x = current.x;
-    last.y = current.y;
-
-    if (leftButtonStatus > 0) {
-        // left mouse drag
-        printf("emitting LEFT_MOUSE_DRAGGED\n");
-        emit_mouse_evt(LEFT_MOUSE_DRAGGED, current.x, current.y, 0);
-    }
-    else if (rightButtonStatus > 0) {
-        // right mouse drag
-        printf("emitting RIGHT_MOUSE_DRAGGED\n");
-        emit_mouse_evt(RIGHT_MOUSE_DRAGGED, current.x, current.y, 0);
-    }
-    else {
-        // mouse move
-        printf("emitting MOUSE_MOVED\n");
-        emit_mouse_evt(MOUSE_MOVED, current.x, current.y, 0);
-    }
-    return 0;
-}
-
 void cursor_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
                     mpr_type type, const void *val, mpr_time time)
 {
     if (!val)
         return;
     float *valf = (float*)val;
-    current.x = valf[0];
-    current.y = valf[1];
-    updated = 1;
+    mc_move(core, valf[0], valf[1]);
 }
 
 void drag_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
@@ -124,25 +38,17 @@ void drag_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
 {
     switch (evt) {
         case MPR_SIG_INST_NEW:
-//            if (sign(leftButtonStatus) != -1)
-//                break;
-            leftButtonStatus = 2;
-            updated = 1;
+            mc_drag(core, 1);
             break;
         case MPR_SIG_REL_UPSTRM:
-//            if (sign(leftButtonStatus) != 1)
-//                break;
             mpr_sig_release_inst(sig, inst);
-            leftButtonStatus = -2;
-            updated = 1;
+            mc_drag(core, 0);
             break;
         case MPR_SIG_UPDATE: {
             if (!val)
                 return;
             float *valf = (float*)val;
-            current.x = valf[0];
-            current.y = valf[1];
-            updated = 1;
+            mc_move(core, valf[0], valf[1]);
             break;
         }
         default:
@@ -153,21 +59,13 @@ void drag_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
 void left_button_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
                          mpr_type type, const void *val, mpr_time time)
 {
-    int status = val ? sign(*(int*)val) : -1;
-    if (status == sign(leftButtonStatus)) // no change
-        return;
-    leftButtonStatus += status * 2;
-    updated = 1;
+    mc_button(core, MC_BUTTON_LEFT, val && *(int*)val > 0);
 }
 
 void right_button_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
                           mpr_type type, const void *val, mpr_time time)
 {
-    int status = val ? sign(*(int*)val) : -1;
-    if (status == sign(rightButtonStatus)) // no change
-        return;
-    rightButtonStatus += status * 2;
-    updated = 1;
+    mc_button(core, MC_BUTTON_RIGHT, val && *(int*)val > 0);
 }
 
 void scroll_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
@@ -176,7 +74,7 @@ void scroll_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
     if (!val)
         return;
     float *position = (float*)val;
-    emit_mouse_evt(SCROLL_WHEEL, position[0], position[1], 1);
+    mc_scroll(core, position[0], position[1]);
 }
 
 void zoom_handler(mpr_sig sig, mpr_id inst, int len, mpr_type type,
@@ -194,6 +92,8 @@ void rotation_handler(mpr_sig sig, mpr_id inst, int len, mpr_type type,
 mpr_dev start_mpr_dev(const char *name) {
     printf("starting mpr_dev with name %s\n", name);
     mpr_dev d = mpr_dev_new(name, 0);
+    if (!core)
+        core = mc_new(emit_mouse_evt);
 
     int one = 1;
     float minf[2] = {0.f, 0.f}, maxf[2] = {1.f, 1.f};
@@ -222,14 +122,15 @@ mpr_dev start_mpr_dev(const char *name) {
 }
 
 int poll_mpr_dev(mpr_dev d) {
-    updated = 0;
+    // everything received during one poll is coalesced into a single flush
     mpr_dev_poll(d, 1);
-    if (updated)
-        emit();
+    mc_flush(core, get_current_time());
     return 0;
 }
 
 void quit_mpr_dev(mpr_dev d) {
     printf("freeing mpr dev %s\n", mpr_obj_get_prop_as_str(d, MPR_PROP_NAME, NULL));
     mpr_dev_free(d);
+    mc_free(core);
+    core = NULL;
 }
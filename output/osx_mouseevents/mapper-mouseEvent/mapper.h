@@ -13,14 +13,6 @@
 #include <math.h>
 #include <sys/time.h>
 #include <mapper/mapper.h>
-
-#define MOUSE_MOVED 0
-#define LEFT_BUTTON_UP 1
-#define LEFT_BUTTON_DOWN 2
-#define LEFT_MOUSE_DRAGGED 3
-#define RIGHT_BUTTON_UP 4
-#define RIGHT_BUTTON_DOWN 5
-#define RIGHT_MOUSE_DRAGGED 6
-#define SCROLL_WHEEL 7
+#include "../../mouse_events/mouse_core.h"
 
 #endif /* mapper_h */
@@ -4,10 +4,10 @@
 #include <math.h>
 #include <lo/lo.h>
 #include <mapper/mapper_cpp.h>
+#include "../../input/common/touch_aggregate.h"
 
 #define MAX_TOUCH 10
 #define MAX_OBJECT 10
-#define TWOPI (M_PI * 2)
 
 lo_server server;
 mapper::Device dev("tuio");
@@ -52,31 +52,6 @@ public:
     private:
 };
 
-class Box
-{
-public:
-    Box(float minx, float miny, float maxx, float maxy) : min(minx, miny), max(maxx, maxy) {}
-    Box(float _min, float _max) : min(_min, _min), max(_max, _max) {}
-    Point min;
-    Point max;
-
-    Box& updateExtrema(Point p) {
-        if (p.x < min.x) min.x = p.x;
-        if (p.x > max.x) max.x = p.x;
-        if (p.y < min.y) min.y = p.y;
-        if (p.y > max.y) max.y = p.y;
-        return (*this);
-    }
-
-    float width() { return max.x > min.x ? max.x - min.x : min.x - max.x; }
-    float height() { return max.y > min.y ? max.y - min.y : min.y - max.y; }
-    float diagonal() {
-        float w = width();
-        float h = height();
-        return sqrtf(w * w + h * h);
-    }
-};
-
 class Touch
 {
 public:
@@ -129,53 +104,28 @@ int bundleStartHandler(lo_timetag tt, void *user_data)
 int bundleEndHandler(void *user_data)
 {
 //    printf("bundleEndHandler\n");
-    // calculate aggregate centre
     int i, count = 0;
-
-    Point meanPosition(0.f, 0.f), deltaPosition(0.f, 0.f);
-    Box lastBox(1.f, 0.f), currentBox(1.f, 0.f);
+    ta_touch active[MAX_TOUCH];
+    ta_aggregate agg;
 
     for (i = 0; i < MAX_TOUCH; i++) {
-        Touch t = touches[i];
+        Touch &t = touches[i];
         if (t.sessionId == -1)
             continue;
-        meanPosition += t.currentPosition;
-        deltaPosition += (t.currentPosition - t.lastPosition);
+        active[count].pos.x = t.currentPosition.x;
+        active[count].pos.y = t.currentPosition.y;
+        active[count].last.x = t.lastPosition.x;
+        active[count].last.y = t.lastPosition.y;
         ++count;
-
-        lastBox.updateExtrema(t.lastPosition);
-        currentBox.updateExtrema(t.currentPosition);
     }
-    if (count > 0) {
-        meanPosition /= count;
-        touchAggregateCentroid.set_value(meanPosition.coord, 2);
-
-        // calculate aggregate translation
-        deltaPosition /= count;
-        touchAggregateTranslation.set_value(deltaPosition.coord, 2);
-
-        // find bounding box dimensions and calculate growth
-//        float dw = currentBox.width() - lastBox.width();
-//        float dh = currentBox.height() - lastBox.height();
-        float growth = currentBox.diagonal() - lastBox.diagonal();
-        touchAggregateGrowth.set_value(growth);
-
-        // find aggregate rotation
-        float aggrot = 0;
-        for (i = 0; i < MAX_TOUCH; i++) {
-            Point p = touches[i].lastPosition - meanPosition;
-            float a1 = atan2f(p.y, p.x);
-            p = touches[i].currentPosition - meanPosition;
-            float a2 = atan2f(p.y, p.x);
-            float diff = a2 - a1;
-            if (diff > M_PI)
-                diff -= TWOPI;
-            else if (diff < -M_PI)
-                diff += TWOPI;
-            aggrot += diff;
-        }
-        aggrot /= count;
-        touchAggregateRotation.set_value(aggrot);
+
+    // centroid, translation, growth and rotation are computed once per bundle
+    if (ta_compute(active, count, 0, &agg)) {
+        touchAggregateCentroid.set_value(&agg.centroid.x, 2);
+        touchAggregateTranslation.set_value(&agg.velocity.x, 2);
+        // growth keeps its original meaning, the change in the bounding box diagonal
+        touchAggregateGrowth.set_value(agg.box_growth);
+        touchAggregateRotation.set_value(agg.rotation);
 
         // clear screen & cursor to home
         printf("\e[2J\e[0;0H");
@@ -204,9 +154,8 @@ int bundleEndHandler(void *user_data)
             printf("\n");
 
         printf("TOUCH AGGREGATE:\n");
-        printf("TRANS: [%f, %f], BOX: [%f, %f], GROWTH: %f, ROT: %f\n",
-               deltaPosition.x, deltaPosition.y, currentBox.width(),
-               currentBox.height(), growth, aggrot);
+        printf("TRANS: [%f, %f], SPREAD: %f, GROWTH: %f, ROT: %f\n",
+               agg.velocity.x, agg.velocity.y, agg.spread, agg.box_growth, agg.rotation);
     }
 
     dev.update_maps();
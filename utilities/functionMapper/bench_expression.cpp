@@ -0,0 +1,89 @@
+/* Evaluation rate of 100-term programs: a sum of scalar terms over eight   *
+ * inputs, the same with history reads mixed in, and terms over 3-element   *
+ * vectors. Each update writes the inputs, evaluates and reads the outputs, *
+ * as the device does. "bench_expression -p" prints the programs.          */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "expression.h"
+
+#define BENCH_TERMS 100
+#define BENCH_UPDATES 1000000
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// term i of a program over inputs x0..x7, with history read if history > 0
+std::string term(int i, int history, const char *suffix = "")
+{
+    std::string x = "x" + std::to_string(i % 8) + suffix, y = "x" + std::to_string((i * 5 + 3) % 8) + suffix;
+    if (history && i % 3 == 0)
+        x += "{-" + std::to_string(i % history + 1) + "}";
+    std::string c = std::to_string(0.5 + (i % 7) * 0.25);
+    switch (i % 6) {
+        case 0:     return c + " * " + x;
+        case 1:     return "sin(" + x + ")";
+        case 2:     return x + " * " + y;
+        case 3:     return "abs(" + x + " - " + c + ")";
+        case 4:     return "(" + x + " > " + c + " ? " + y + " : " + c + ")";
+        default:    return "sqrt(" + x + " * " + x + " + 1)";
+    }
+}
+
+std::string program(const char *kind)
+{
+    std::string source;
+    bool vector = strcmp(kind, "vector") == 0;
+    if (vector)
+        source = "input x0[3], x1[3], x2[3], x3[3], x4[3], x5[3], x6[3], x7[3]\n";
+    source += "y = ";
+    for (int i = 0; i < BENCH_TERMS; i++)
+        source += (i ? " + " : "") + term(i, strcmp(kind, "history") == 0 ? 10 : 0);
+    return source + "\n";
+}
+
+int main(int argc, char **argv)
+{
+    bool print = argc > 1 && strcmp(argv[1], "-p") == 0;
+    const char *kinds[] = {"scalar", "history", "vector"};
+    for (const char *kind : kinds) {
+        std::string source = program(kind);
+        if (print) {
+            printf("# %s\n%s\n", kind, source.c_str());
+            continue;
+        }
+
+        fexpr::Program p;
+        Clock::time_point start = Clock::now();
+        if (!p.compile(source)) {
+            printf("%s: %s\n", kind, p.error().c_str());
+            return 1;
+        }
+        double compile = seconds_since(start);
+
+        fexpr::State state(p);
+        double sum = 0;
+        start = Clock::now();
+        for (int u = 0; u < BENCH_UPDATES; u++) {
+            for (size_t i = 0; i < p.inputs().size(); i++) {
+                double *x = state.input(i);
+                for (int e = 0; e < p.inputs()[i].length; e++)
+                    x[e] = (u % 100) * 0.01 + i + e;
+            }
+            state.evaluate();
+            sum += state.output(0)[0];
+        }
+        double run = seconds_since(start);
+        printf("%-8s %d terms, %zu instructions, compiled in %.0f us: %.2f M evaluations/sec, "
+               "%.0f ns each (%g)\n", kind, BENCH_TERMS, p.instructions(), compile * 1e6,
+               BENCH_UPDATES / run / 1e6, run / BENCH_UPDATES * 1e9, sum);
+    }
+    return 0;
+}
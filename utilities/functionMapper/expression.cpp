@@ -0,0 +1,901 @@
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include "expression.h"
+
+using namespace fexpr;
+
+namespace {
+
+enum Op {
+    // elementwise over a and b
+    ADD, SUB, MUL, DIV, MOD, POW, ATAN2, HYPOT, MIN, MAX,
+    LT, LE, GT, GE, EQ, NE, AND, OR,
+    // elementwise over a
+    NEG, NOT, SIN, COS, TAN, ASIN, ACOS, ATAN, SINH, COSH, TANH,
+    SQRT, EXP, LOG, LOG2, LOG10, ABS, FLOOR, CEIL, ROUND, SIGN,
+    // elementwise over a, b and c
+    SELECT, CLAMP,
+    // a scalar from the len elements of a, or of a and b
+    SUM, MEAN, VMIN, VMAX, NORM, DOT,
+    COPY,       // len elements of a
+    HISTORY,    // len elements of ring a of depth b, from c updates ago
+    // added to an elementwise op whose operands are all scalars, the common
+    // case, which skips the loop
+    SCALAR = 64
+};
+
+struct Function
+{
+    const char *name;
+    int args;
+    Op op;
+};
+
+const Function FUNCTIONS[] = {
+    {"sin", 1, SIN}, {"cos", 1, COS}, {"tan", 1, TAN},
+    {"asin", 1, ASIN}, {"acos", 1, ACOS}, {"atan", 1, ATAN}, {"atan2", 2, ATAN2},
+    {"sinh", 1, SINH}, {"cosh", 1, COSH}, {"tanh", 1, TANH},
+    {"sqrt", 1, SQRT}, {"exp", 1, EXP}, {"log", 1, LOG}, {"log2", 1, LOG2},
+    {"log10", 1, LOG10}, {"pow", 2, POW}, {"hypot", 2, HYPOT},
+    {"abs", 1, ABS}, {"floor", 1, FLOOR}, {"ceil", 1, CEIL}, {"round", 1, ROUND},
+    {"sign", 1, SIGN}, {"clamp", 3, CLAMP},
+    // min and max of two values are elementwise, and of one, over its elements
+    {"min", 2, MIN}, {"max", 2, MAX}, {"min", 1, VMIN}, {"max", 1, VMAX},
+    {"sum", 1, SUM}, {"mean", 1, MEAN}, {"norm", 1, NORM}, {"dot", 2, DOT},
+};
+
+// binary operators by precedence, loosest first
+const char *LEVELS[][5] = {
+    {"||"}, {"&&"}, {"==", "!="}, {"<", "<=", ">", ">="}, {"+", "-"}, {"*", "/", "%"},
+};
+const Op LEVEL_OPS[][5] = {
+    {OR}, {AND}, {EQ, NE}, {LT, LE, GT, GE}, {ADD, SUB}, {MUL, DIV, MOD},
+};
+const int NUM_LEVELS = sizeof(LEVELS) / sizeof(LEVELS[0]);
+
+typedef Program::Instr Instr;
+
+#define ELEMENTWISE(OP, EXPR)                           \
+    case OP:                                            \
+        for (size_t i = 0; i < n; i++) {                \
+            double x = a[i * sa], y = b[i * sb];        \
+            (void)y;                                    \
+            d[i] = (EXPR);                              \
+        }                                               \
+        break;                                          \
+    case OP + SCALAR: {                                 \
+        double x = *a, y = *b;                          \
+        (void)y;                                        \
+        *d = (EXPR);                                    \
+        break;                                          \
+    }
+
+void execute(const Instr *in, const Instr *end, double *r, const double *rings, uint64_t count)
+{
+    for (; in < end; in++) {
+        double *d = r + in->dst;
+        const double *a = r + in->a, *b = r + in->b, *c = r + in->c;
+        size_t n = in->len, sa = in->sa, sb = in->sb, sc = in->sc;
+        switch (in->op) {
+            ELEMENTWISE(ADD, x + y)
+            ELEMENTWISE(SUB, x - y)
+            ELEMENTWISE(MUL, x * y)
+            ELEMENTWISE(DIV, x / y)
+            ELEMENTWISE(MOD, fmod(x, y))
+            ELEMENTWISE(POW, pow(x, y))
+            ELEMENTWISE(ATAN2, atan2(x, y))
+            ELEMENTWISE(HYPOT, hypot(x, y))
+            ELEMENTWISE(MIN, y < x ? y : x)
+            ELEMENTWISE(MAX, y > x ? y : x)
+            ELEMENTWISE(LT, x < y)
+            ELEMENTWISE(LE, x <= y)
+            ELEMENTWISE(GT, x > y)
+            ELEMENTWISE(GE, x >= y)
+            ELEMENTWISE(EQ, x == y)
+            ELEMENTWISE(NE, x != y)
+            ELEMENTWISE(AND, x != 0 && y != 0)
+            ELEMENTWISE(OR, x != 0 || y != 0)
+            ELEMENTWISE(NEG, -x)
+            ELEMENTWISE(NOT, x == 0)
+            ELEMENTWISE(SIN, sin(x))
+            ELEMENTWISE(COS, cos(x))
+            ELEMENTWISE(TAN, tan(x))
+            ELEMENTWISE(ASIN, asin(x))
+            ELEMENTWISE(ACOS, acos(x))
+            ELEMENTWISE(ATAN, atan(x))
+            ELEMENTWISE(SINH, sinh(x))
+            ELEMENTWISE(COSH, cosh(x))
+            ELEMENTWISE(TANH, tanh(x))
+            ELEMENTWISE(SQRT, sqrt(x))
+            ELEMENTWISE(EXP, exp(x))
+            ELEMENTWISE(LOG, log(x))
+            ELEMENTWISE(LOG2, log2(x))
+            ELEMENTWISE(LOG10, log10(x))
+            ELEMENTWISE(ABS, fabs(x))
+            ELEMENTWISE(FLOOR, floor(x))
+            ELEMENTWISE(CEIL, ceil(x))
+            ELEMENTWISE(ROUND, round(x))
+            ELEMENTWISE(SIGN, (x > 0) - (x < 0))
+            case SELECT:
+                for (size_t i = 0; i < n; i++)
+                    d[i] = a[i * sa] != 0 ? b[i * sb] : c[i * sc];
+                break;
+            case SELECT + SCALAR:
+                *d = *a != 0 ? *b : *c;
+                break;
+            case CLAMP:
+                for (size_t i = 0; i < n; i++)
+                    d[i] = std::min(std::max(a[i * sa], b[i * sb]), c[i * sc]);
+                break;
+            case SUM:
+            case MEAN: {
+                double s = 0;
+                for (size_t i = 0; i < n; i++)
+                    s += a[i];
+                d[0] = in->op == MEAN ? s / n : s;
+                break;
+            }
+            case VMIN:
+                d[0] = *std::min_element(a, a + n);
+                break;
+            case VMAX:
+                d[0] = *std::max_element(a, a + n);
+                break;
+            case NORM: {
+                double s = 0;
+                for (size_t i = 0; i < n; i++)
+                    s += a[i] * a[i];
+                d[0] = sqrt(s);
+                break;
+            }
+            case DOT: {
+                double s = 0;
+                for (size_t i = 0; i < n; i++)
+                    s += a[i * sa] * b[i * sb];
+                d[0] = s;
+                break;
+            }
+            case COPY:
+                std::copy(a, a + n, d);
+                break;
+            case HISTORY: {
+                uint64_t depth = in->b;
+                const double *past = rings + in->a + (count % depth + depth - in->c) % depth * n;
+                std::copy(past, past + n, d);
+                break;
+            }
+        }
+    }
+}
+
+} // namespace
+
+namespace fexpr {
+
+class Compiler
+{
+public:
+    Compiler(Program &program, const std::string &source)
+    : _p(program), _src(source), _tok(0) {}
+
+    bool compile();
+
+private:
+    struct Token
+    {
+        enum Kind { NUMBER, NAME, SYMBOL, END, DONE } kind;
+        std::string text;
+        double value;
+        int line, column;
+    };
+    struct Node
+    {
+        enum Kind { NUMBER, NAME, HISTORY, INDEX, LIST, OP } kind;
+        int op;
+        double value;
+        std::string name;
+        int first, last;        // of an INDEX; the updates ago of a HISTORY
+        std::vector<int> args;
+        int line, column;
+    };
+    struct Statement
+    {
+        size_t var;
+        int expr;
+        int line, column;
+    };
+    struct Var
+    {
+        std::string name;
+        enum Kind { INPUT, OUTPUT, LOCAL } kind;
+        int length;
+        bool declared, assigned;
+        bool assumed;           // history read before assignment, as a scalar
+        bool constant;
+        int history;
+        uint32_t offset, ring;
+        int line, column;
+    };
+    struct Value
+    {
+        uint32_t offset;
+        int length;
+        bool constant;
+    };
+
+    bool fail(int line, int column, const std::string &message);
+    bool fail(const Token &t, const std::string &message) { return fail(t.line, t.column, message); }
+    bool fail(const Node &n, const std::string &message) { return fail(n.line, n.column, message); }
+    int error(const Token &t, const std::string &message) { fail(t, message); return -1; }
+
+    // source to tokens, and tokens to nodes; parsing functions return -1 on errors
+    bool lex();
+    const Token &tok() const { return _tokens[_tok]; }
+    bool is(const char *symbol) const { return tok().kind == Token::SYMBOL && tok().text == symbol; }
+    bool expect(const char *symbol);
+    bool integer(int &value);
+    int node(Node::Kind kind, const Token &at);
+    bool parse();
+    bool declaration(bool input);
+    int ternary();
+    int binary(int level);
+    int unary();
+    int power();
+    int postfix();
+    int primary();
+
+    // nodes to instructions
+    size_t var(const std::string &name, Var::Kind kind, int length, const Node *at);
+    uint32_t alloc(int length);
+    bool emit(int node, Value &v);
+    bool emit_op(const Node &n, Op op, const std::vector<Value> &args, Value &v);
+    bool link();
+
+    Program &_p;
+    const std::string &_src;
+    std::vector<Token> _tokens;
+    size_t _tok;
+    std::vector<Node> _nodes;
+    std::vector<Statement> _statements;
+    std::vector<Var> _vars;
+    std::unordered_map<std::string, size_t> _var_index;
+};
+
+bool Compiler::fail(int line, int column, const std::string &message)
+{
+    if (_p._error.empty())
+        _p._error = std::to_string(line) + ":" + std::to_string(column) + ": " + message;
+    return false;
+}
+
+bool Compiler::lex()
+{
+    static const char *pairs[] = {"<=", ">=", "==", "!=", "&&", "||"};
+    int line = 1, depth = 0;
+    size_t line_start = 0, i = 0;
+    while (i <= _src.size()) {
+        Token t;
+        t.line = line;
+        t.column = (int)(i - line_start) + 1;
+        t.value = 0;
+        char ch = i < _src.size() ? _src[i] : 0;
+        if (!ch) {
+            t.kind = Token::DONE;
+            _tokens.push_back(t);
+            return true;
+        }
+        if (ch == '#') {
+            while (i < _src.size() && _src[i] != '\n')
+                i++;
+            continue;
+        }
+        if (ch == '\n' || ch == ';') {
+            i++;
+            if (ch == '\n') {
+                line++;
+                line_start = i;
+            }
+            // a line continues inside brackets
+            if (!depth || ch == ';') {
+                t.kind = Token::END;
+                _tokens.push_back(t);
+            }
+            continue;
+        }
+        if (isspace((unsigned char)ch)) {
+            i++;
+            continue;
+        }
+        if (isdigit((unsigned char)ch) || (ch == '.' && isdigit((unsigned char)_src[i + 1]))) {
+            char *end;
+            t.kind = Token::NUMBER;
+            t.value = strtod(_src.c_str() + i, &end);
+            size_t len = end - (_src.c_str() + i);
+            t.text = _src.substr(i, len);
+            i += len;
+        } else if (isalpha((unsigned char)ch) || ch == '_') {
+            size_t start = i;
+            while (i < _src.size() && (isalnum((unsigned char)_src[i]) || _src[i] == '_'))
+                i++;
+            t.kind = Token::NAME;
+            t.text = _src.substr(start, i - start);
+        } else {
+            t.kind = Token::SYMBOL;
+            t.text = _src.substr(i, 2);
+            if (std::find(pairs, pairs + 6, t.text) == pairs + 6) {
+                if (!strchr("+-*/%^<>!?:=,()[]{}", ch))
+                    return fail(t, std::string("unexpected \"") + ch + "\"");
+                t.text = ch;
+                depth += strchr("([{", ch) ? 1 : strchr(")]}", ch) && depth ? -1 : 0;
+            }
+            i += t.text.size();
+        }
+        _tokens.push_back(t);
+    }
+    return true;
+}
+
+bool Compiler::expect(const char *symbol)
+{
+    if (!is(symbol))
+        return fail(tok(), std::string("expected \"") + symbol + "\"");
+    _tok++;
+    return true;
+}
+
+bool Compiler::integer(int &value)
+{
+    const Token &t = tok();
+    if (t.kind != Token::NUMBER || t.value != floor(t.value) || t.value > MAX_HISTORY + MAX_LENGTH)
+        return fail(t, "expected a whole number");
+    value = (int)t.value;
+    _tok++;
+    return true;
+}
+
+int Compiler::node(Node::Kind kind, const Token &at)
+{
+    Node n;
+    n.kind = kind;
+    n.op = 0;
+    n.value = 0;
+    n.first = n.last = 0;
+    n.line = at.line;
+    n.column = at.column;
+    _nodes.push_back(n);
+    return (int)_nodes.size() - 1;
+}
+
+bool Compiler::parse()
+{
+    while (tok().kind != Token::DONE) {
+        const Token &t = tok();
+        if (t.kind == Token::END) {
+            _tok++;
+            continue;
+        }
+        if (t.kind != Token::NAME)
+            return fail(t, "expected an assignment");
+        bool declares = (t.text == "input" || t.text == "output")
+                      && _tokens[_tok + 1].kind == Token::NAME;
+        if (declares) {
+            _tok++;
+            if (!declaration(t.text == "input"))
+                return false;
+        } else {
+            if (t.text == "pi")
+                return fail(t, "pi is a constant");
+            _tok++;
+            if (!expect("="))
+                return false;
+            Statement s;
+            s.var = var(t.text, t.text[0] == '_' ? Var::LOCAL : Var::OUTPUT, 1, NULL);
+            s.line = t.line;
+            s.column = t.column;
+            Var &v = _vars[s.var];
+            if (v.kind == Var::INPUT)
+                return fail(t, t.text + " is an input and cannot be assigned");
+            for (const Statement &other : _statements) {
+                if (other.var == s.var)
+                    return fail(t, t.text + " is assigned twice");
+            }
+            if ((s.expr = ternary()) < 0)
+                return false;
+            _statements.push_back(s);
+        }
+        if (tok().kind != Token::END && tok().kind != Token::DONE)
+            return fail(tok(), "expected the end of the line");
+    }
+    return true;
+}
+
+bool Compiler::declaration(bool input)
+{
+    for (;;) {
+        const Token &t = tok();
+        if (t.kind != Token::NAME || t.text == "pi")
+            return fail(t, "expected a signal name");
+        _tok++;
+        int length = 1;
+        if (is("[")) {
+            _tok++;
+            if (!integer(length) || !expect("]"))
+                return false;
+            if (length < 1 || length > MAX_LENGTH)
+                return fail(t, "the length of " + t.text + " must be from 1 to "
+                               + std::to_string(MAX_LENGTH));
+        }
+        if (_var_index.count(t.text))
+            return fail(t, t.text + " is already declared");
+        Var::Kind kind = input ? Var::INPUT : t.text[0] == '_' ? Var::LOCAL : Var::OUTPUT;
+        Var &v = _vars[var(t.text, kind, length, NULL)];
+        v.declared = true;
+        v.line = t.line;
+        v.column = t.column;
+        if (!is(","))
+            return true;
+        _tok++;
+    }
+}
+
+int Compiler::ternary()
+{
+    int cond = binary(0);
+    if (cond < 0 || !is("?"))
+        return cond;
+    int n = node(Node::OP, tok());
+    _tok++;
+    int a = ternary();
+    if (a < 0 || !expect(":"))
+        return -1;
+    int b = ternary();
+    if (b < 0)
+        return -1;
+    _nodes[n].op = SELECT;
+    _nodes[n].args = {cond, a, b};
+    return n;
+}
+
+int Compiler::binary(int level)
+{
+    if (level == NUM_LEVELS)
+        return unary();
+    int left = binary(level + 1);
+    while (left >= 0 && tok().kind == Token::SYMBOL) {
+        int i = 0;
+        while (i < 5 && LEVELS[level][i] && tok().text != LEVELS[level][i])
+            i++;
+        if (i == 5 || !LEVELS[level][i])
+            break;
+        int n = node(Node::OP, tok());
+        _tok++;
+        int right = binary(level + 1);
+        if (right < 0)
+            return -1;
+        _nodes[n].op = LEVEL_OPS[level][i];
+        _nodes[n].args = {left, right};
+        left = n;
+    }
+    return left;
+}
+
+int Compiler::unary()
+{
+    if (is("+")) {
+        _tok++;
+        return unary();
+    }
+    if (!is("-") && !is("!"))
+        return power();
+    int n = node(Node::OP, tok());
+    _nodes[n].op = is("-") ? NEG : NOT;
+    _tok++;
+    int arg = unary();
+    if (arg < 0)
+        return -1;
+    _nodes[n].args = {arg};
+    return n;
+}
+
+// -x^2 is -(x^2), and 2^-x is 2^(-x)
+int Compiler::power()
+{
+    int base = postfix();
+    if (base < 0 || !is("^"))
+        return base;
+    int n = node(Node::OP, tok());
+    _tok++;
+    int exponent = unary();
+    if (exponent < 0)
+        return -1;
+    _nodes[n].op = POW;
+    _nodes[n].args = {base, exponent};
+    return n;
+}
+
+int Compiler::postfix()
+{
+    int n = primary();
+    while (n >= 0) {
+        const Token &t = tok();
+        if (is("{")) {
+            if (_nodes[n].kind != Node::NAME)
+                return error(t, "only signals have a history");
+            _tok++;
+            int ago = 0;
+            if (is("-"))
+                _tok++;
+            else if (tok().kind != Token::NUMBER || tok().value)
+                return error(tok(), "expected {-n}, n updates ago");
+            if (!integer(ago) || !expect("}"))
+                return -1;
+            if (ago > MAX_HISTORY)
+                return error(t, "history is kept for at most " + std::to_string(MAX_HISTORY)
+                                   + " updates");
+            _nodes[n].kind = Node::HISTORY;
+            _nodes[n].first = ago;
+        } else if (is("[")) {
+            int index = node(Node::INDEX, t);
+            _tok++;
+            int first, last;
+            if (!integer(first))
+                return -1;
+            last = first;
+            if (is(":")) {
+                _tok++;
+                if (!integer(last))
+                    return -1;
+            }
+            if (!expect("]"))
+                return -1;
+            _nodes[index].first = first;
+            _nodes[index].last = last;
+            _nodes[index].args = {n};
+            n = index;
+        } else {
+            break;
+        }
+    }
+    return n;
+}
+
+int Compiler::primary()
+{
+    const Token &t = tok();
+    if (t.kind == Token::NUMBER) {
+        int n = node(Node::NUMBER, t);
+        _nodes[n].value = t.value;
+        _tok++;
+        return n;
+    }
+    if (is("(")) {
+        _tok++;
+        int n = ternary();
+        return n >= 0 && expect(")") ? n : -1;
+    }
+    if (is("[")) {
+        int n = node(Node::LIST, t);
+        _tok++;
+        for (;;) {
+            int element = ternary();
+            if (element < 0)
+                return -1;
+            _nodes[n].args.push_back(element);
+            if (!is(","))
+                break;
+            _tok++;
+        }
+        return expect("]") ? n : -1;
+    }
+    if (t.kind != Token::NAME)
+        return error(t, t.kind == Token::END || t.kind == Token::DONE
+                        ? "unexpected end of line" : "unexpected \"" + t.text + "\"");
+    _tok++;
+    if (t.text == "pi") {
+        int n = node(Node::NUMBER, t);
+        _nodes[n].value = M_PI;
+        return n;
+    }
+    if (!is("(")) {
+        int n = node(Node::NAME, t);
+        _nodes[n].name = t.text;
+        return n;
+    }
+
+    int n = node(Node::OP, t);
+    _tok++;
+    std::vector<int> args;
+    while (!is(")")) {
+        int arg = ternary();
+        if (arg < 0)
+            return -1;
+        args.push_back(arg);
+        if (!is(")") && !expect(","))
+            return -1;
+    }
+    _tok++;
+    const Function *f = NULL;
+    bool known = false;
+    for (const Function &candidate : FUNCTIONS) {
+        if (t.text == candidate.name) {
+            known = true;
+            if (candidate.args == (int)args.size())
+                f = &candidate;
+        }
+    }
+    if (!f)
+        return error(t, known ? t.text + "() does not take " + std::to_string(args.size())
+                                + " arguments" : "unknown function " + t.text + "()");
+    _nodes[n].op = f->op;
+    _nodes[n].args = args;
+    return n;
+}
+
+size_t Compiler::var(const std::string &name, Var::Kind kind, int length, const Node *at)
+{
+    auto found = _var_index.find(name);
+    if (found != _var_index.end())
+        return found->second;
+    Var v;
+    v.name = name;
+    v.kind = kind;
+    v.length = length;
+    v.declared = v.assigned = v.assumed = v.constant = false;
+    v.history = 0;
+    v.offset = kind == Var::INPUT ? alloc(length) : 0;
+    v.ring = 0;
+    v.line = at ? at->line : 0;
+    v.column = at ? at->column : 0;
+    _vars.push_back(v);
+    _var_index[name] = _vars.size() - 1;
+    return _vars.size() - 1;
+}
+
+uint32_t Compiler::alloc(int length)
+{
+    uint32_t offset = (uint32_t)_p._registers.size();
+    _p._registers.resize(offset + length, 0);
+    return offset;
+}
+
+bool Compiler::emit(int index, Value &v)
+{
+    const Node &n = _nodes[index];
+    switch (n.kind) {
+        case Node::NUMBER:
+            v.offset = alloc(1);
+            v.length = 1;
+            v.constant = true;
+            _p._registers[v.offset] = n.value;
+            return true;
+
+        case Node::NAME:
+        case Node::HISTORY: {
+            Var &x = _vars[var(n.name, Var::INPUT, 1, &n)];
+            int ago = n.kind == Node::HISTORY ? n.first : 0;
+            if (x.kind != Var::INPUT && !x.assigned && !ago)
+                return fail(n, n.name + " is used before it is assigned");
+            if (!ago) {
+                v.offset = x.offset;
+                v.length = x.length;
+                v.constant = x.constant;
+                return true;
+            }
+            if (x.kind != Var::INPUT && !x.assigned && !x.declared)
+                x.assumed = true;
+            x.history = std::max(x.history, ago);
+            Instr in = {};
+            in.op = HISTORY;
+            in.len = x.length;
+            in.dst = v.offset = alloc(x.length);
+            in.a = (uint32_t)(&x - &_vars[0]);     // the variable until link()
+            in.c = ago;
+            _p._code.push_back(in);
+            v.length = x.length;
+            v.constant = false;
+            return true;
+        }
+
+        case Node::INDEX: {
+            Value of;
+            if (!emit(n.args[0], of))
+                return false;
+            if (n.first > n.last || n.last >= of.length)
+                return fail(n, "[" + std::to_string(n.first) + (n.first == n.last ? "" : ":"
+                               + std::to_string(n.last)) + "] is out of range for a length of "
+                               + std::to_string(of.length));
+            // elements are read in place
+            v.offset = of.offset + n.first;
+            v.length = n.last - n.first + 1;
+            v.constant = of.constant;
+            return true;
+        }
+
+        case Node::LIST: {
+            std::vector<Value> elements(n.args.size());
+            int length = 0;
+            v.constant = true;
+            for (size_t i = 0; i < n.args.size(); i++) {
+                if (!emit(n.args[i], elements[i]))
+                    return false;
+                length += elements[i].length;
+                v.constant = v.constant && elements[i].constant;
+            }
+            if (length > MAX_LENGTH)
+                return fail(n, "vectors are at most " + std::to_string(MAX_LENGTH) + " long");
+            v.offset = alloc(length);
+            v.length = length;
+            // constant elements are written once, here
+            uint32_t dst = v.offset;
+            for (const Value &e : elements) {
+                if (e.constant) {
+                    std::copy(_p._registers.begin() + e.offset,
+                              _p._registers.begin() + e.offset + e.length,
+                              _p._registers.begin() + dst);
+                } else {
+                    Instr in = {};
+                    in.op = COPY;
+                    in.len = e.length;
+                    in.dst = dst;
+                    in.a = e.offset;
+                    _p._code.push_back(in);
+                }
+                dst += e.length;
+            }
+            return true;
+        }
+
+        case Node::OP: {
+            std::vector<Value> args(n.args.size());
+            for (size_t i = 0; i < n.args.size(); i++) {
+                if (!emit(n.args[i], args[i]))
+                    return false;
+            }
+            return emit_op(n, (Op)n.op, args, v);
+        }
+    }
+    return false;
+}
+
+bool Compiler::emit_op(const Node &n, Op op, const std::vector<Value> &args, Value &v)
+{
+    Instr in = {};
+    in.op = op;
+    in.len = 1;
+    uint32_t *operands[] = {&in.a, &in.b, &in.c};
+    uint8_t *steps[] = {&in.sa, &in.sb, &in.sc};
+    bool constant = true;
+    for (size_t i = 0; i < args.size(); i++) {
+        // scalars are repeated over the others' elements
+        if (args[i].length > 1 && in.len > 1 && (int)in.len != args[i].length)
+            return fail(n, "lengths " + std::to_string(in.len) + " and "
+                           + std::to_string(args[i].length) + " do not match");
+        in.len = std::max<uint32_t>(in.len, args[i].length);
+        *operands[i] = args[i].offset;
+        *steps[i] = args[i].length > 1;
+        constant = constant && args[i].constant;
+    }
+    bool reduces = op >= SUM && op <= DOT;
+    v.length = reduces ? 1 : in.len;
+    if (in.len == 1 && op <= SELECT)
+        in.op += SCALAR;
+    in.dst = v.offset = alloc(v.length);
+    v.constant = constant;
+    if (constant)
+        execute(&in, &in + 1, &_p._registers[0], NULL, 0);
+    else
+        _p._code.push_back(in);
+    return true;
+}
+
+// gives variables with history their rings, and their readers the rings' places
+bool Compiler::link()
+{
+    _p._ring_size = 0;
+    for (Var &x : _vars) {
+        if (x.kind != Var::INPUT && !x.assigned)
+            return fail(x.line, x.column, x.name + " is declared but never assigned");
+        if (x.history) {
+            x.ring = (uint32_t)_p._ring_size;
+            _p._ring_size += x.history * x.length;
+        }
+    }
+    for (Instr &in : _p._code) {
+        if (in.op == HISTORY) {
+            const Var &x = _vars[in.a];
+            in.a = x.ring;
+            in.b = x.history;
+        }
+    }
+
+    for (const Var &x : _vars) {
+        Variable out = {x.name, x.length, x.history, x.offset, x.ring};
+        if (x.kind == Var::INPUT)
+            _p._inputs.push_back(out);
+        else if (x.kind == Var::LOCAL && x.history)
+            _p._locals.push_back(out);
+    }
+    for (const Statement &s : _statements) {
+        const Var &x = _vars[s.var];
+        if (x.kind == Var::OUTPUT)
+            _p._outputs.push_back(Variable{x.name, x.length, x.history, x.offset, x.ring});
+    }
+    return true;
+}
+
+bool Compiler::compile()
+{
+    if (!lex() || !parse())
+        return false;
+    for (const Statement &s : _statements) {
+        Value v;
+        if (!emit(s.expr, v))
+            return false;
+        Var &x = _vars[s.var];
+        if (x.declared && v.length != x.length)
+            return fail(s.line, s.column, x.name + " is declared with length "
+                        + std::to_string(x.length) + " but assigned " + std::to_string(v.length)
+                        + " values");
+        if (x.assumed && v.length != 1)
+            return fail(s.line, s.column, "the history of " + x.name + " is read before it is "
+                        "assigned; declare its length with \"output " + x.name + "["
+                        + std::to_string(v.length) + "]\"");
+        x.assigned = true;
+        x.offset = v.offset;
+        x.length = v.length;
+        x.constant = v.constant;
+    }
+    return link();
+}
+
+} // namespace fexpr
+
+bool Program::compile(const std::string &source)
+{
+    _code.clear();
+    _registers.clear();
+    _inputs.clear();
+    _outputs.clear();
+    _locals.clear();
+    _ring_size = 0;
+    _error.clear();
+    Compiler compiler(*this, source);
+    return compiler.compile();
+}
+
+State::State(const Program &program)
+: _program(program)
+{
+    reset();
+}
+
+void State::reset()
+{
+    _registers = _program._registers;
+    _rings.assign(_program._ring_size, 0);
+    _count = 0;
+}
+
+void State::record(const std::vector<Variable> &vars)
+{
+    for (const Variable &v : vars) {
+        if (!v.history)
+            continue;
+        const double *value = &_registers[v.offset];
+        std::copy(value, value + v.length, &_rings[v.ring + _count % v.history * v.length]);
+    }
+}
+
+void State::evaluate()
+{
+    const std::vector<Program::Instr> &code = _program._code;
+    execute(code.data(), code.data() + code.size(), _registers.data(), _rings.data(), _count);
+    record(_program._inputs);
+    record(_program._outputs);
+    record(_program._locals);
+    _count++;
+}
@@ -0,0 +1,102 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+/* The expression language of the native functionMapper. A program is a     *
+ * list of assignments, one per line or separated by ";":                   *
+ *                                                                          *
+ *     # comment                                                            *
+ *     input acc[3], gain           # vector inputs are declared; others    *
+ *                                  # are scalars named where they are used *
+ *     level = norm(acc) * gain                                             *
+ *     smooth = 0.9 * smooth{-1} + 0.1 * level   # value one update ago     *
+ *     _d = acc - acc{-1}           # leading "_": a local, not an output   *
+ *     jerk = [_d[0], _d[1:2] * 2]  # vectors, elements and ranges          *
+ *     peak = level > 1 ? 1 : 0                                             *
+ *                                                                          *
+ * Values are doubles, and vectors combine elementwise with scalars         *
+ * repeated. An output's history can be read before it is assigned; if it   *
+ * is not a scalar, declare it: "output smooth[3]". Operators are those of  *
+ * C plus "^" for powers, and the functions are listed in expression.cpp.   *
+ *                                                                          *
+ * compile() parses the source and flattens it into a list of instructions  *
+ * over a single array of registers, so that every value has a fixed place  *
+ * and length. Constant subexpressions are folded away. A State holds the   *
+ * registers and history of one program, and evaluates it without           *
+ * allocating.                                                             */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define MAX_HISTORY 1000    // the deepest x{-k} a program may read
+#define MAX_LENGTH 1024     // the longest vector
+
+namespace fexpr {
+
+struct Variable
+{
+    std::string name;
+    int length;
+    int history;        // the deepest {-k} read, 0 for none
+    uint32_t offset;    // of the current value, in the registers
+    uint32_t ring;      // of the history, history * length values
+};
+
+class Program
+{
+public:
+    // false with error() set to "line:column: message" if source has errors
+    bool compile(const std::string &source);
+
+    const std::vector<Variable> &inputs() const { return _inputs; }
+    // published outputs, in the order they are assigned
+    const std::vector<Variable> &outputs() const { return _outputs; }
+    const std::string &error() const { return _error; }
+    size_t instructions() const { return _code.size(); }
+
+    struct Instr
+    {
+        uint16_t op;
+        // whether a, b and c step through their elements or repeat a scalar
+        uint8_t sa, sb, sc;
+        uint32_t len;
+        uint32_t dst, a, b, c;
+    };
+
+private:
+    friend class Compiler;
+    friend class State;
+
+    std::vector<Instr> _code;
+    std::vector<double> _registers; // initial values, holding the constants
+    std::vector<Variable> _inputs, _outputs;
+    std::vector<Variable> _locals;  // locals whose history is read
+    size_t _ring_size;
+    std::string _error;
+};
+
+class State
+{
+public:
+    // program must outlive the State
+    explicit State(const Program &program);
+
+    // zeroes the inputs and all history
+    void reset();
+    // an input's current value, to be written before evaluate()
+    double *input(size_t i) { return &_registers[_program._inputs[i].offset]; }
+    const double *output(size_t i) const { return &_registers[_program._outputs[i].offset]; }
+    // runs the program once, then records the history it reads
+    void evaluate();
+
+private:
+    void record(const std::vector<Variable> &vars);
+
+    const Program &_program;
+    std::vector<double> _registers, _rings;
+    uint64_t _count;    // evaluations so far
+};
+
+} // namespace fexpr
+
+#endif // EXPRESSION_H
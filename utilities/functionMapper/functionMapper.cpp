@@ -0,0 +1,322 @@
+/* Native counterpart of functionMapper.py: the mapping function is a       *
+ * program in the expression language of expression.h, read from a file     *
+ * and compiled again whenever the file changes, so it can be edited with   *
+ * any editor. The program's inputs and outputs are libmapper signals, and  *
+ * every input update evaluates it once and publishes its outputs. New      *
+ * programs are compiled on a watcher thread and handed to the device       *
+ * whole, between updates: an edit that does not compile leaves the running *
+ * program in place, and signals that keep their name and length keep their *
+ * maps.                                                                   */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mapper/mapper.h>
+#include "expression.h"
+
+#define WATCH_MS 250        // how often the program file is read for changes
+#define DEFAULT_PROGRAM "# inputs and outputs become signals; see expression.h\ny = x * 10\n"
+
+typedef std::shared_ptr<const fexpr::Program> ProgramPtr;
+
+std::atomic<bool> done(false);
+
+class Mapper
+{
+public:
+    Mapper(const char *name);
+    ~Mapper();
+
+    bool ok() const { return _dev != NULL; }
+    // from any thread; the device switches to program before its next update
+    void load(ProgramPtr program) { std::atomic_store(&_pending, program); }
+    void poll();
+    // evaluates the program with a new value of the input sig, and publishes
+    void update(mpr_sig sig, int len, mpr_type type, const void *value);
+
+private:
+    struct Port
+    {
+        mpr_sig sig;
+        std::string name;
+        int length;
+    };
+    void swap(ProgramPtr program);
+    void keep(const std::vector<fexpr::Variable> &vars, std::vector<Port> &ports,
+              std::vector<int> &kept);
+    bool make(std::vector<Port> &ports, const std::vector<int> &kept, mpr_dir dir);
+    void stop();
+    void publish();
+
+    mpr_dev _dev;
+    ProgramPtr _program, _pending;
+    fexpr::State *_state;
+    std::vector<Port> _inputs, _outputs;   // in the program's order
+    std::vector<float> _values;
+};
+
+Mapper *mapper = NULL;
+
+void input_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                   mpr_type type, const void *val, mpr_time time)
+{
+    if (val)
+        mapper->update(sig, len, type, val);
+}
+
+Mapper::Mapper(const char *name)
+: _state(NULL)
+{
+    _dev = mpr_dev_new(name, 0);
+}
+
+Mapper::~Mapper()
+{
+    if (_dev)
+        mpr_dev_free(_dev);
+    delete _state;
+}
+
+/* Matches the signals of a new program against the current ones by name and
+ * length; kept[i] is the current index of vars[i], or -1 for a new signal,
+ * left without one until make(). Signals the program no longer has are
+ * freed here, so that swap() can drop the stale inputs and outputs both
+ * before any new signal takes one of their names.                          */
+void Mapper::keep(const std::vector<fexpr::Variable> &vars, std::vector<Port> &ports,
+                  std::vector<int> &kept)
+{
+    std::vector<Port> next(vars.size());
+    std::vector<bool> used(ports.size());
+    kept.assign(vars.size(), -1);
+    for (size_t i = 0; i < vars.size(); i++) {
+        for (size_t j = 0; j < ports.size(); j++) {
+            if (!used[j] && ports[j].name == vars[i].name && ports[j].length == vars[i].length) {
+                used[j] = true;
+                kept[i] = (int)j;
+                next[i] = ports[j];
+            }
+        }
+    }
+    for (size_t j = 0; j < ports.size(); j++) {
+        if (!used[j])
+            mpr_sig_free(ports[j].sig);
+    }
+    for (size_t i = 0; i < vars.size(); i++) {
+        if (kept[i] >= 0)
+            continue;
+        next[i].sig = NULL;
+        next[i].name = vars[i].name;
+        next[i].length = vars[i].length;
+    }
+    ports.swap(next);
+}
+
+// creates the signals keep() left out; false if libmapper refuses one
+bool Mapper::make(std::vector<Port> &ports, const std::vector<int> &kept, mpr_dir dir)
+{
+    for (size_t i = 0; i < ports.size(); i++) {
+        if (kept[i] >= 0)
+            continue;
+        ports[i].sig = mpr_sig_new(_dev, dir, ports[i].name.c_str(), ports[i].length, MPR_FLT,
+                                   NULL, NULL, NULL, NULL, dir == MPR_DIR_IN ? input_handler : NULL,
+                                   dir == MPR_DIR_IN ? MPR_SIG_UPDATE : 0);
+        if (!ports[i].sig) {
+            printf("cannot create the %s signal %s\n", dir == MPR_DIR_IN ? "input" : "output",
+                   ports[i].name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// frees every signal and runs no program until the next good one
+void Mapper::stop()
+{
+    for (std::vector<Port> *ports : {&_inputs, &_outputs}) {
+        for (const Port &p : *ports) {
+            if (p.sig)
+                mpr_sig_free(p.sig);
+        }
+        ports->clear();
+    }
+    delete _state;
+    _state = NULL;
+    _program.reset();
+}
+
+void Mapper::swap(ProgramPtr program)
+{
+    std::vector<int> inputs, outputs;
+    // stale signals in both directions go before any is made, as an input
+    // may take the name of an old output or the other way round
+    keep(program->inputs(), _inputs, inputs);
+    keep(program->outputs(), _outputs, outputs);
+    if (!make(_inputs, inputs, MPR_DIR_IN) || !make(_outputs, outputs, MPR_DIR_OUT)) {
+        // the old program's signals are partly gone, so it cannot carry on
+        stop();
+        printf("no program is running until the next edit\n");
+        fflush(stdout);
+        return;
+    }
+
+    fexpr::State *state = new fexpr::State(*program);
+    // inputs that stay carry their last values over; all history starts again
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (inputs[i] >= 0 && _state) {
+            const double *last = _state->input(inputs[i]);
+            std::copy(last, last + _inputs[i].length, state->input(i));
+        }
+    }
+    delete _state;
+    _state = state;
+    _program = program;
+
+    size_t longest = 0;
+    for (const Port &p : _outputs)
+        longest = std::max<size_t>(longest, p.length);
+    _values.resize(longest);
+
+    printf("program of %zu instructions:", _program->instructions());
+    for (size_t i = 0; i < _inputs.size(); i++)
+        printf("%s %s", i ? "," : " inputs", _inputs[i].name.c_str());
+    for (size_t i = 0; i < _outputs.size(); i++)
+        printf("%s %s", i ? "," : "; outputs", _outputs[i].name.c_str());
+    printf("\n");
+    fflush(stdout);
+
+    // outputs follow an edit at once, even of a program without inputs
+    _state->evaluate();
+    publish();
+}
+
+void Mapper::update(mpr_sig sig, int len, mpr_type type, const void *value)
+{
+    size_t i = 0;
+    while (i < _inputs.size() && _inputs[i].sig != sig)
+        i++;
+    if (i == _inputs.size() || !_state)
+        return;
+    double *x = _state->input(i);
+    len = std::min(len, _inputs[i].length);
+    for (int e = 0; e < len; e++) {
+        switch (type) {
+            case MPR_INT32: x[e] = ((const int*)value)[e];      break;
+            case MPR_FLT:   x[e] = ((const float*)value)[e];    break;
+            case MPR_DBL:   x[e] = ((const double*)value)[e];   break;
+        }
+    }
+    _state->evaluate();
+    publish();
+}
+
+void Mapper::publish()
+{
+    for (size_t o = 0; o < _outputs.size(); o++) {
+        const double *y = _state->output(o);
+        for (int e = 0; e < _outputs[o].length; e++)
+            _values[e] = (float)y[e];
+        mpr_sig_set_value(_outputs[o].sig, 0, _outputs[o].length, MPR_FLT, _values.data());
+    }
+}
+
+void Mapper::poll()
+{
+    while (!done) {
+        ProgramPtr program = std::atomic_exchange(&_pending, ProgramPtr());
+        if (program)
+            swap(program);
+        mpr_dev_poll(_dev, 10);
+    }
+}
+
+bool read_file(const std::string &path, std::string &text)
+{
+    FILE *file = fopen(path.c_str(), "r");
+    if (!file)
+        return false;
+    text.clear();
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, n);
+    fclose(file);
+    return true;
+}
+
+// compiles the file whenever its text changes, and hands good programs to the device
+void watch(const std::string &path)
+{
+    std::string last;
+    bool first = true;
+    while (!done) {
+        std::string source;
+        if (read_file(path, source) && (first || source != last)) {
+            first = false;
+            last = source;
+            std::shared_ptr<fexpr::Program> program(new fexpr::Program);
+            if (program->compile(source))
+                mapper->load(program);
+            else
+                printf("%s:%s\n", path.c_str(), program->error().c_str());
+            fflush(stdout);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_MS));
+    }
+}
+
+void handler_done(int sig)
+{
+    done = true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = "functionMapper";
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printf("functionMapper [program file] [--name <device name>]\n");
+            return 0;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path.empty()) {
+        const char *home = getenv("HOME");
+        path = std::string(home ? home : ".") + "/.functionMapper.expr";
+    }
+    std::string source;
+    if (!read_file(path, source)) {
+        FILE *file = fopen(path.c_str(), "w");
+        if (!file) {
+            printf("cannot open %s\n", path.c_str());
+            return 1;
+        }
+        fputs(DEFAULT_PROGRAM, file);
+        fclose(file);
+        printf("wrote an example program to %s\n", path.c_str());
+    }
+    signal(SIGINT, handler_done);
+    signal(SIGTERM, handler_done);
+
+    mapper = new Mapper(name);
+    if (mapper->ok()) {
+        printf("editing %s; changes are loaded when it is saved\n", path.c_str());
+        std::thread watcher(watch, path);
+        mapper->poll();
+        watcher.join();
+    }
+    delete mapper;
+    printf("done\n");
+    return 0;
+}
@@ -0,0 +1,137 @@
+/* Native counterpart of preset_switcher.py: switches between the presets   *
+ * of a presets file (see presets.h), chosen by name or number on standard  *
+ * input or by writing an index to the device's "preset" input, and prints  *
+ * how long each switch took to take effect on the graph. With --bench <n>  *
+ * it cycles through the presets n times once their signals are all on the  *
+ * graph, and reports the switch latency.                                  */
+
+#include <sys/select.h>
+#include <unistd.h>
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <mapper/mapper.h>
+#include "presets.h"
+
+#define RESOLVE_TIMEOUT_MS 5000     // how long --bench waits for the presets' signals
+
+int done = 0;
+presets::Switcher *switcher = NULL;
+
+void preset_handler(mpr_sig sig, mpr_sig_evt evt, mpr_id inst, int len,
+                    mpr_type type, const void *val, mpr_time time)
+{
+    int index = val ? *(const int*)val : -1;
+    if (index >= 0 && index < (int)switcher->presets().size())
+        switcher->select(index);
+}
+
+// a preset named or numbered on a line of standard input, without blocking
+void read_stdin()
+{
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(STDIN_FILENO, &fds);
+    timeval now = {0, 0};
+    char line[256];
+    if (select(STDIN_FILENO + 1, &fds, NULL, NULL, &now) <= 0 || !fgets(line, sizeof(line), stdin))
+        return;
+    std::string name = line;
+    name.erase(name.find_last_not_of(" \t\r\n") + 1);
+    int index = switcher->find(name);
+    if (index >= 0)
+        switcher->select(index);
+    else if (!name.empty())
+        printf("no preset %s\n", name.c_str());
+}
+
+void bench(mpr_dev dev, int cycles)
+{
+    for (int waited = 0; !switcher->resolved() && !done; waited += 10) {
+        if (waited > RESOLVE_TIMEOUT_MS) {
+            printf("not every signal in the presets is on the graph\n");
+            return;
+        }
+        mpr_dev_poll(dev, 10);
+    }
+    double total = 0, longest = 0;
+    int switches = 0, failed = 0;
+    size_t count = switcher->presets().size();
+    for (int i = 0; i < cycles * (int)count && !done; i++) {
+        switcher->select(i % count);
+        while (switcher->switching() && !done) {
+            mpr_dev_poll(dev, 0);
+            switcher->check();
+        }
+        double ms = switcher->latency_ms();
+        if (ms < 0) {
+            failed++;
+            continue;
+        }
+        total += ms;
+        longest = std::max(longest, ms);
+        switches++;
+    }
+    printf("%d switches, latency mean %.1f ms, max %.1f ms, %d timed out\n", switches,
+           switches ? total / switches : 0, longest, failed);
+}
+
+void handler_done(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = "example.presets";
+    int cycles = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            cycles = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printf("preset_switcher [presets file] [--bench <cycles>]\n");
+            return 0;
+        } else {
+            path = argv[i];
+        }
+    }
+    signal(SIGINT, handler_done);
+    signal(SIGTERM, handler_done);
+
+    // the device shares a graph that follows every device, signal and map
+    mpr_graph graph = mpr_graph_new(MPR_OBJ);
+    switcher = new presets::Switcher(graph);
+    if (!switcher->load(path)) {
+        printf("%s\n", switcher->error().c_str());
+        delete switcher;
+        mpr_graph_free(graph);
+        return 1;
+    }
+    for (size_t i = 0; i < switcher->presets().size(); i++) {
+        const presets::Preset &p = switcher->presets()[i];
+        printf("%zu: %s (%zu maps)\n", i, p.name.c_str(), p.maps.size());
+    }
+
+    mpr_dev dev = mpr_dev_new("preset_switcher", graph);
+    int min = 0, max = (int)switcher->presets().size() - 1;
+    mpr_sig_new(dev, MPR_DIR_IN, "preset", 1, MPR_INT32, NULL, &min, &max, NULL,
+                preset_handler, MPR_SIG_UPDATE);
+    if (cycles > 0) {
+        bench(dev, cycles);
+    } else {
+        printf("type a preset's name or number to switch to it\n");
+        while (!done) {
+            mpr_dev_poll(dev, 10);
+            switcher->check();
+            read_stdin();
+        }
+    }
+    delete switcher;
+    mpr_dev_free(dev);
+    mpr_graph_free(graph);
+    printf("done\n");
+    return 0;
+}
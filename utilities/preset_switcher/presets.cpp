@@ -0,0 +1,342 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <unordered_set>
+#include "presets.h"
+
+using namespace presets;
+
+namespace {
+
+std::string trim(const std::string &s)
+{
+    size_t begin = s.find_first_not_of(" \t\r"), end = s.find_last_not_of(" \t\r");
+    return begin == std::string::npos ? std::string() : s.substr(begin, end - begin + 1);
+}
+
+void graph_handler(mpr_graph graph, mpr_obj obj, const mpr_graph_evt evt, const void *data)
+{
+    ((Switcher*)data)->on_graph(obj, evt);
+}
+
+} // namespace
+
+std::string Map::key() const
+{
+    std::string k;
+    for (size_t i = 0; i < sources.size(); i++)
+        k += (i ? "," : "") + sources[i];
+    return k + "->" + destination;
+}
+
+Switcher::Switcher(mpr_graph graph)
+: _graph(graph), _current(-1), _switching(false), _kept(0), _changed(0), _released(0),
+  _created(0), _latency_ms(-1)
+{
+    mpr_graph_add_cb(_graph, graph_handler, MPR_SIG | MPR_MAP, this);
+}
+
+Switcher::~Switcher()
+{
+    mpr_graph_remove_cb(_graph, graph_handler, this);
+}
+
+bool Switcher::load(const char *path)
+{
+    _presets.clear();
+    _error.clear();
+    _current = -1;
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        _error = std::string("cannot open ") + path;
+        return false;
+    }
+    char buffer[4096];
+    for (int line = 1; fgets(buffer, sizeof(buffer), file); line++) {
+        std::string text = buffer;
+        text = trim(text.substr(0, text.find_first_of("#\n")));
+        std::string where = std::string(path) + ":" + std::to_string(line) + ": ";
+        if (text.empty())
+            continue;
+        if (text[0] == '[') {
+            Preset p;
+            p.name = trim(text.substr(1, text.find(']') - 1));
+            if (text.back() != ']' || p.name.empty())
+                _error = where + "expected [preset name]";
+            for (const Preset &other : _presets) {
+                if (other.name == p.name)
+                    _error = where + "a preset named " + p.name + " is already defined";
+            }
+            _presets.push_back(p);
+        } else if (_presets.empty()) {
+            _error = where + "expected [preset name] before its maps";
+        } else {
+            // sources -> destination [: expression], and expressions may hold ':'
+            size_t arrow = text.find("->");
+            size_t colon = arrow == std::string::npos ? arrow : text.find(':', arrow);
+            Map m;
+            if (arrow != std::string::npos) {
+                std::string sources = text.substr(0, arrow);
+                for (size_t start = 0, comma; start <= sources.size(); start = comma + 1) {
+                    comma = sources.find(',', start);
+                    if (comma == std::string::npos)
+                        comma = sources.size();
+                    m.sources.push_back(trim(sources.substr(start, comma - start)));
+                }
+                m.destination = trim(text.substr(arrow + 2, colon == std::string::npos
+                                                           ? colon : colon - arrow - 2));
+                if (colon != std::string::npos)
+                    m.expression = trim(text.substr(colon + 1));
+            }
+            std::vector<std::string> names = m.sources;
+            names.push_back(m.destination);
+            for (const std::string &name : names) {
+                size_t slash = name.find('/');
+                if (slash == std::string::npos || !slash || slash + 1 == name.size())
+                    _error = where + "expected <device>/<signal>, ... -> <device>/<signal>"
+                           " [: expression]";
+            }
+            for (const Map &other : _presets.back().maps) {
+                if (other.key() == m.key())
+                    _error = where + "this map is already in " + _presets.back().name;
+            }
+            _presets.back().maps.push_back(m);
+        }
+        if (!_error.empty())
+            break;
+    }
+    fclose(file);
+    if (_error.empty() && _presets.empty())
+        _error = std::string(path) + ": no presets";
+    return _error.empty();
+}
+
+int Switcher::find(const std::string &name) const
+{
+    for (size_t i = 0; i < _presets.size(); i++) {
+        if (_presets[i].name == name)
+            return (int)i;
+    }
+    char *end;
+    long index = strtol(name.c_str(), &end, 10);
+    return !name.empty() && !*end && index >= 0 && index < (long)_presets.size() ? (int)index : -1;
+}
+
+bool Switcher::resolved() const
+{
+    for (const Preset &p : _presets) {
+        for (const Map &m : p.maps) {
+            if (!signal(m.destination))
+                return false;
+            for (const std::string &s : m.sources) {
+                if (!signal(s))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+mpr_sig Switcher::signal(const std::string &name) const
+{
+    auto found = _signals.find(name);
+    return found == _signals.end() ? NULL : found->second;
+}
+
+std::string Switcher::full_name(mpr_sig sig) const
+{
+    mpr_dev dev = mpr_sig_get_dev(sig);
+    const char *dev_name = mpr_obj_get_prop_as_str((mpr_obj)dev, MPR_PROP_NAME, NULL);
+    const char *sig_name = mpr_obj_get_prop_as_str((mpr_obj)sig, MPR_PROP_NAME, NULL);
+    return std::string(dev_name ? dev_name : "") + "/" + (sig_name ? sig_name : "");
+}
+
+std::string Switcher::key(mpr_map map) const
+{
+    Map m;
+    mpr_list sigs = mpr_map_get_sigs(map, MPR_LOC_SRC);
+    while (sigs) {
+        m.sources.push_back(full_name((mpr_sig)*sigs));
+        sigs = mpr_list_get_next(sigs);
+    }
+    sigs = mpr_map_get_sigs(map, MPR_LOC_DST);
+    if (sigs) {
+        m.destination = full_name((mpr_sig)*sigs);
+        mpr_list_free(sigs);
+    }
+    return m.key();
+}
+
+void Switcher::on_graph(mpr_obj obj, mpr_graph_evt evt)
+{
+    bool gone = evt == MPR_OBJ_REM || evt == MPR_OBJ_EXP;
+    switch (mpr_obj_get_type(obj)) {
+        case MPR_SIG: {
+            mpr_sig sig = (mpr_sig)obj;
+            auto found = _names.find(sig);
+            if (gone && found != _names.end()) {
+                _signals.erase(found->second);
+                _names.erase(found);
+            } else if (!gone && found == _names.end()) {
+                std::string name = full_name(sig);
+                _signals[name] = sig;
+                _names[sig] = name;
+            }
+            break;
+        }
+        case MPR_MAP: {
+            mpr_map map = (mpr_map)obj;
+            auto releasing = _releasing.find(map);
+            if (releasing != _releasing.end()) {
+                // only its removal matters, as its key may be a new map's by now
+                if (gone) {
+                    auto waiting = _waiting.find(releasing->second);
+                    if (waiting != _waiting.end() && !waiting->second)
+                        _waiting.erase(waiting);
+                    _releasing.erase(releasing);
+                }
+                break;
+            }
+            // the signals of a map being removed may be gone already
+            auto found = _keys.find(map);
+            std::string k = found != _keys.end() ? found->second : gone ? std::string() : key(map);
+            if (k.empty())
+                break;
+            if (gone) {
+                if (_maps.count(k) && _maps[k] == map)
+                    _maps.erase(k);
+                _keys.erase(map);
+            } else {
+                _maps[k] = map;
+                _keys[map] = k;
+            }
+            auto waiting = _waiting.find(k);
+            if (waiting != _waiting.end()
+                && (waiting->second ? !gone && mpr_map_get_is_ready(map) : gone))
+                _waiting.erase(waiting);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+bool Switcher::select(size_t index)
+{
+    const Preset &next = _presets[index];
+    std::unordered_set<std::string> wanted;
+    for (const Map &m : next.maps)
+        wanted.insert(m.key());
+
+    // every signal of a map to create is found before anything changes, so
+    // that a switch either happens whole or not at all
+    std::vector<std::vector<mpr_sig>> created(next.maps.size());
+    std::set<std::string> missing;
+    for (size_t i = 0; i < next.maps.size(); i++) {
+        const Map &m = next.maps[i];
+        if (_maps.count(m.key()))
+            continue;
+        std::vector<std::string> names = m.sources;
+        names.push_back(m.destination);
+        for (const std::string &name : names) {
+            mpr_sig sig = signal(name);
+            if (!sig)
+                missing.insert(name);
+            created[i].push_back(sig);
+        }
+    }
+    if (!missing.empty()) {
+        printf("%s: not switching, as", next.name.c_str());
+        for (const std::string &name : missing)
+            printf(" %s", name.c_str());
+        printf(" %s not on the graph\n", missing.size() > 1 ? "are" : "is");
+        fflush(stdout);
+        return false;
+    }
+
+    _started = Clock::now();
+    _waiting.clear();
+    _kept = _changed = _released = _created = 0;
+
+    // everything below is queued without polling, so the graph never sees a
+    // preset half switched for long
+    if (_current >= 0) {
+        for (const Map &m : _presets[_current].maps) {
+            std::string k = m.key();
+            auto found = _maps.find(k);
+            if (wanted.count(k) || found == _maps.end())
+                continue;
+            // no longer this preset's map, even before the graph reports it
+            // gone, so that switching straight back creates it again; and
+            // before releasing, as a local map can be removed at once
+            mpr_map map = found->second;
+            _waiting[k] = false;
+            _releasing[map] = k;
+            _keys.erase(map);
+            _maps.erase(found);
+            mpr_map_release(map);
+            _released++;
+        }
+    }
+    for (size_t i = 0; i < next.maps.size(); i++) {
+        const Map &m = next.maps[i];
+        std::string k = m.key();
+        if (created[i].empty()) {
+            mpr_obj map = (mpr_obj)_maps[k];
+            const char *expr = mpr_obj_get_prop_as_str(map, MPR_PROP_EXPR, NULL);
+            if (m.expression.empty() || (expr && m.expression == expr)) {
+                _kept++;
+            } else {
+                mpr_obj_set_prop(map, MPR_PROP_EXPR, NULL, 1, MPR_STR, m.expression.c_str(), 1);
+                mpr_obj_push(map);
+                _changed++;
+            }
+            continue;
+        }
+
+        // the destination was resolved last
+        mpr_sig destination = created[i].back();
+        created[i].pop_back();
+        mpr_map map = mpr_map_new((int)created[i].size(), created[i].data(), 1, &destination);
+        if (!m.expression.empty()) {
+            mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXPR, NULL, 1, MPR_STR,
+                             m.expression.c_str(), 1);
+        }
+        mpr_obj_push((mpr_obj)map);
+        // libmapper may hand back a released map that is still on the graph
+        _releasing.erase(map);
+        _maps[k] = map;
+        _keys[map] = k;
+        _waiting[k] = true;
+        _created++;
+    }
+    _current = (int)index;
+    _switching = true;
+    check();
+    return true;
+}
+
+void Switcher::check()
+{
+    if (!_switching)
+        return;
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - _started).count();
+    const char *name = _presets[_current].name.c_str();
+    if (_waiting.empty()) {
+        printf("switched to %s in %.1f ms: %zu kept, %zu changed, %zu released, %zu created\n",
+               name, ms, _kept, _changed, _released, _created);
+        _latency_ms = ms;
+    } else if (ms > SWITCH_TIMEOUT_MS) {
+        printf("switch to %s incomplete after %.0f ms, waiting on", name, ms);
+        for (const auto &w : _waiting)
+            printf(" %s (%s)", w.first.c_str(), w.second ? "to be ready" : "to be removed");
+        printf("\n");
+        _waiting.clear();
+        _latency_ms = -1;
+    } else {
+        return;
+    }
+    fflush(stdout);
+    _switching = false;
+}
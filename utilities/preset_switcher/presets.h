@@ -0,0 +1,103 @@
+#ifndef PRESETS_H
+#define PRESETS_H
+
+/* Presets of maps between signals named "device/signal", and switching     *
+ * between them in one step. Signals are found through a table kept up to   *
+ * date from graph callbacks, not searched for, and a switch applies only   *
+ * the difference between the current preset and the next: maps in both are *
+ * kept, with their expression changed if it differs (a map given none      *
+ * keeps the one it has), and the rest are released or created, all in one  *
+ * pass without polling in between. Nothing changes unless every signal the *
+ * new maps need is on the graph. The switch is timed until the graph       *
+ * reports every new map ready and every old one gone. A presets file       *
+ * reads:                                                                   *
+ *                                                                          *
+ *     # comment                                                            *
+ *     [Duty]                                                               *
+ *     tkgui.1/signal0 -> tk_pwm.1/duty : y=x                               *
+ *     [Mix]                                                                *
+ *     tkgui.1/signal0, tkgui.1/signal1 -> tk_pwm.1/gain : y=x0*x1         */
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <mapper/mapper.h>
+
+#define SWITCH_TIMEOUT_MS 2000  // when a switch still waiting on the graph is reported
+
+namespace presets {
+
+struct Map
+{
+    std::vector<std::string> sources;
+    std::string destination;
+    std::string expression;     // empty for libmapper's default
+
+    // identifies the map by its signals, whatever its expression
+    std::string key() const;
+};
+
+struct Preset
+{
+    std::string name;
+    std::vector<Map> maps;
+};
+
+class Switcher
+{
+public:
+    // graph should subscribe to devices, signals and maps
+    explicit Switcher(mpr_graph graph);
+    ~Switcher();
+
+    // false with error() set to "file:line: message" if path has errors
+    bool load(const char *path);
+    const std::vector<Preset> &presets() const { return _presets; }
+    const std::string &error() const { return _error; }
+    // the index of the preset with this name or number, or -1
+    int find(const std::string &name) const;
+
+    // applies presets()[index] in place of the current preset; false, with
+    // nothing changed, if a signal it needs is not on the graph
+    bool select(size_t index);
+    // reports a switch once the graph has caught up with it, or has timed out
+    void check();
+    bool switching() const { return _switching; }
+    // of the last switch to finish, or -1 if it timed out
+    double latency_ms() const { return _latency_ms; }
+    // whether every signal the presets name is on the graph
+    bool resolved() const;
+
+    void on_graph(mpr_obj obj, mpr_graph_evt evt);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    mpr_sig signal(const std::string &name) const;
+    std::string full_name(mpr_sig sig) const;
+    // the key of a map on the graph, from its signals
+    std::string key(mpr_map map) const;
+
+    mpr_graph _graph;
+    std::vector<Preset> _presets;
+    std::string _error;
+    int _current;
+
+    std::unordered_map<std::string, mpr_sig> _signals;     // by "device/signal"
+    std::unordered_map<mpr_sig, std::string> _names;
+    std::unordered_map<std::string, mpr_map> _maps;        // by Map::key()
+    std::unordered_map<mpr_map, std::string> _keys;
+    std::unordered_map<mpr_map, std::string> _releasing;  // released, until seen gone
+
+    // the switch in progress: maps to see ready, and to see removed
+    Clock::time_point _started;
+    std::unordered_map<std::string, bool> _waiting;         // key -> wanted
+    bool _switching;
+    size_t _kept, _changed, _released, _created;
+    double _latency_ms;
+};
+
+} // namespace presets
+
+#endif // PRESETS_H
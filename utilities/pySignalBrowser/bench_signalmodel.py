@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+# Time to show a synthetic graph of 50 devices x 200 signals, and to remove
+# it again, in the QTreeWidget pySignalBrowser used to fill with a findItems()
+# search per event, against SignalModel. Events arrive in ticks of EVENTS_PER_TICK
+# as graph.poll() would deliver them, and the view is laid out after each tick.
+#
+#   QT_QPA_PLATFORM=offscreen python3 bench_signalmodel.py [devices [signals]]
+
+import sys, time
+from PySide6 import QtWidgets, QtCore
+from signalmodel import SignalModel, SORT_ROLE
+
+EVENTS_PER_TICK = 500
+
+def events(devices, signals):
+    for d in range(devices):
+        dev_id = (d + 1) << 32
+        yield ('device', dev_id, 'device_%d' % d)
+        for s in range(signals):
+            yield ('signal', dev_id + s + 1, dev_id, 'signal_%d' % s, 'float', 1, 'out')
+
+def removals(devices, signals):
+    for d in range(devices):
+        dev_id = (d + 1) << 32
+        for s in range(signals):
+            yield ('signal', dev_id + s + 1)
+        yield ('device', dev_id)
+
+def ticks(stream):
+    tick = []
+    for e in stream:
+        tick.append(e)
+        if len(tick) == EVENTS_PER_TICK:
+            yield tick
+            tick = []
+    if tick:
+        yield tick
+
+def tree_widget(app, devices, signals):
+    # the former MainWindow.on_event
+    tree = QtWidgets.QTreeWidget()
+    tree.setHeaderLabels(['name', 'id', 'type', 'length', 'direction'])
+    tree.setSortingEnabled(True)
+    tree.show()
+    start = time.perf_counter()
+    for tick in ticks(events(devices, signals)):
+        for e in tick:
+            if e[0] == 'device':
+                item = QtWidgets.QTreeWidgetItem(tree, [e[2]])
+                item.setText(1, str(e[1]))
+                item.setExpanded(True)
+            else:
+                for dev_item in tree.findItems(str(e[2]), QtCore.Qt.MatchFixedString, 1):
+                    QtWidgets.QTreeWidgetItem(dev_item, [e[3], str(e[1]), e[4], str(e[5]), e[6]])
+        app.processEvents()
+    add = time.perf_counter() - start
+    start = time.perf_counter()
+    for tick in ticks(removals(devices, signals)):
+        for e in tick:
+            if e[0] == 'signal':
+                for item in tree.findItems(str(e[1]), QtCore.Qt.MatchFixedString | QtCore.Qt.MatchRecursive, 1):
+                    parent = item.parent()
+                    parent.takeChild(parent.indexOfChild(item))
+            else:
+                for item in tree.findItems(str(e[1]), QtCore.Qt.MatchFixedString, 1):
+                    tree.takeTopLevelItem(tree.indexOfTopLevelItem(item))
+        app.processEvents()
+    return add, time.perf_counter() - start
+
+def signal_model(app, devices, signals):
+    model = SignalModel()
+    proxy = QtCore.QSortFilterProxyModel()
+    proxy.setSourceModel(model)
+    proxy.setSortRole(SORT_ROLE)
+    tree = QtWidgets.QTreeView()
+    tree.setModel(proxy)
+    tree.setUniformRowHeights(True)
+    tree.setSortingEnabled(True)
+    tree.show()
+    start = time.perf_counter()
+    for tick in ticks(events(devices, signals)):
+        for e in tick:
+            if e[0] == 'device':
+                model.add_device(e[1], e[2])
+            else:
+                model.add_signal(*e[1:])
+        model.flush()
+        app.processEvents()
+    add = time.perf_counter() - start
+    # open one device, as a user would to find a signal
+    tree.expand(proxy.index(0, 0))
+    app.processEvents()
+    shown = proxy.rowCount(proxy.index(0, 0))
+    start = time.perf_counter()
+    for tick in ticks(removals(devices, signals)):
+        for e in tick:
+            if e[0] == 'signal':
+                model.remove_signal(e[1])
+            else:
+                model.remove_device(e[1])
+        model.flush()
+        app.processEvents()
+    return add, time.perf_counter() - start, shown
+
+if __name__ == '__main__':
+    devices = int(sys.argv[1]) if len(sys.argv) > 1 else 50
+    signals = int(sys.argv[2]) if len(sys.argv) > 2 else 200
+    app = QtWidgets.QApplication(sys.argv)
+    print('%d devices x %d signals, %d events per tick' % (devices, signals, EVENTS_PER_TICK))
+    add, remove, shown = signal_model(app, devices, signals)
+    print('SignalModel: added in %.3f s, removed in %.3f s (%d rows on expanding a device)'
+          % (add, remove, shown))
+    add, remove = tree_widget(app, devices, signals)
+    print('QTreeWidget: added in %.3f s, removed in %.3f s' % (add, remove))
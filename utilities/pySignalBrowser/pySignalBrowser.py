@@ -1,31 +1,16 @@
 from PySide6 import QtGui, QtWidgets, QtCore
 import pyqtgraph as pg
 import sys, math, time
-from collections import deque
 import libmapper as mpr
+from signalmodel import SignalModel, SORT_ROLE
+
+AUTO_EXPAND_DEVICES = 8     # expand new devices while there are no more than this
 
 ''' TODO
 show network interfaces, allow setting
 show metadata
 '''
 
-class Tree(QtWidgets.QTreeWidget):
-    def __init__(self):
-        super(Tree, self).__init__()
-        self.setDragEnabled(True)
-
-    def mouseMoveEvent(self, e):
-        item = self.itemAt(e.position().toPoint())
-        if item == None or item.parent() == None:
-            return
-
-        mimeData = QtCore.QMimeData()
-        mimeData.setText('libmapper://signal ' + item.parent().text(0) + '/' + item.text(0) + ' @id ' + item.text(1))
-        drag = QtGui.QDrag(self)
-        drag.setMimeData(mimeData)
-
-        dropAction = drag.exec(QtCore.Qt.CopyAction)
-
 class MainWindow(QtWidgets.QMainWindow):
 
     def __init__(self):
@@ -38,14 +23,27 @@ class MainWindow(QtWidgets.QMainWindow):
 
         self.setGeometry(300, 300, 375, 300)
 
-        self.tree = Tree()
-        self.tree.setHeaderLabels(['name', 'id', 'type', 'length', 'direction'])
+        # graph events are queued in the model and applied once per timer tick
+        self.model = SignalModel(self)
+        self.proxy = QtCore.QSortFilterProxyModel(self)
+        self.proxy.setSourceModel(self.model)
+        self.proxy.setSortRole(SORT_ROLE)
+
+        self.tree = QtWidgets.QTreeView()
+        self.tree.setModel(self.proxy)
+        self.tree.setDragEnabled(True)
+        self.tree.setDragDropMode(QtWidgets.QAbstractItemView.DragOnly)
+        self.tree.setDefaultDropAction(QtCore.Qt.CopyAction)
+        self.tree.setUniformRowHeights(True)
         self.tree.setColumnHidden(1, True)
         self.tree.setColumnWidth(0, 200)
         self.tree.setColumnWidth(1, 60)
         self.tree.setColumnWidth(2, 50)
         self.tree.setColumnWidth(3, 50)
         self.tree.setSortingEnabled(True)
+        self.tree.sortByColumn(0, QtCore.Qt.AscendingOrder)
+        # a device expanded before its signals arrive must still show them
+        self.tree.expanded.connect(lambda index: self.model.open(self.proxy.mapToSource(index)))
         self.setCentralWidget(self.tree)
 
         self.timer = QtCore.QTimer()
@@ -54,31 +52,25 @@ class MainWindow(QtWidgets.QMainWindow):
         self.timer.start()
 
     def on_event(self, type, obj, event):
+        removed = event == mpr.Graph.Event.REMOVED or event == mpr.Graph.Event.EXPIRED
         if type == mpr.Type.DEVICE:
             if event == mpr.Graph.Event.NEW:
-                dev_item = QtWidgets.QTreeWidgetItem(self.tree, [obj[mpr.Property.NAME]])
-                dev_item.setText(1, str(obj[mpr.Property.ID]))
-                dev_item.setExpanded(True)
-            elif event == mpr.Graph.Event.REMOVED or event == mpr.Graph.Event.EXPIRED:
-                items = self.tree.findItems(str(obj[mpr.Property.ID]), QtCore.Qt.MatchFixedString, 1)
-                for item in items:
-                    item = self.tree.takeTopLevelItem(int(self.tree.indexOfTopLevelItem(item)))
-                    del item
+                self.model.add_device(obj[mpr.Property.ID], obj[mpr.Property.NAME])
+            elif removed:
+                self.model.remove_device(obj[mpr.Property.ID])
         elif type == mpr.Type.SIGNAL:
             if event == mpr.Graph.Event.NEW:
-                # find parent device
-                dev_items = self.tree.findItems(str(obj.device()[mpr.Property.ID]), QtCore.Qt.MatchFixedString, 1)
-                for dev_item in dev_items:
-                    sig_item = QtWidgets.QTreeWidgetItem(dev_item, [obj[mpr.Property.NAME], str(obj[mpr.Property.ID]), obj[mpr.Property.TYPE].name.lower(), "{}".format(obj[mpr.Property.LENGTH]), "out" if (obj[mpr.Property.DIRECTION] == mpr.Direction.OUTGOING) else "in"])
-            elif event == mpr.Graph.Event.REMOVED or event == mpr.Graph.Event.EXPIRED:
-                sig_items = self.tree.findItems(str(obj[mpr.Property.ID]), QtCore.Qt.MatchFixedString | QtCore.Qt.MatchRecursive, 1)
-                for sig_item in sig_items:
-                    parent = sig_item.parent()
-                    item = parent.takeChild(int(parent.indexOfChild(sig_item)))
-                    del item
+                self.model.add_signal(obj[mpr.Property.ID], obj.device()[mpr.Property.ID],
+                                      obj[mpr.Property.NAME], obj[mpr.Property.TYPE].name.lower(),
+                                      obj[mpr.Property.LENGTH],
+                                      "out" if (obj[mpr.Property.DIRECTION] == mpr.Direction.OUTGOING) else "in")
+            elif removed:
+                self.model.remove_signal(obj[mpr.Property.ID])
 
     def timer_event(self):
         self.graph.poll(10)
+        if self.model.flush() and self.model.rowCount() <= AUTO_EXPAND_DEVICES:
+            self.tree.expandAll()
 
     def remove_graph(self):
         self.graph.free()
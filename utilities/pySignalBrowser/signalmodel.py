@@ -0,0 +1,295 @@
+# Item model of the devices and signals in a libmapper graph, for
+# pySignalBrowser. Graph events are queued as they arrive and applied once
+# per timer tick by flush(), which coalesces them (a signal added and removed
+# within a tick never reaches the view) and resets the model outright when a
+# batch is large, as on startup with a big graph. Devices and signals are
+# found by id through dicts rather than by searching the tree, and a
+# device's signals become rows only when the view first expands it; connect
+# the view's expanded() signal to open() so that a device expanded before its
+# signals arrive still shows them.
+#
+# The model knows nothing of libmapper, so it can be driven synthetically:
+# see bench_signalmodel.py. Device ids must not be 0, which libmapper's
+# never are.
+
+from PySide6 import QtCore
+
+COLUMNS = ['name', 'id', 'type', 'length', 'direction']
+SORT_ROLE = QtCore.Qt.UserRole  # values that sort as numbers, for ids and lengths
+FETCH_BATCH = 256               # signal rows added to an expanded device at a time
+RESET_THRESHOLD = 200           # batches with more changes reset the model
+
+class Device:
+    __slots__ = ('id', 'name', 'signals', 'fetched', 'opened')
+
+    def __init__(self, id, name):
+        self.id = id
+        self.name = name
+        self.signals = []
+        self.fetched = 0        # signals[:fetched] are rows of the model
+        self.opened = False     # the view has expanded this device
+
+    def values(self):
+        return (self.name, self.id, None, None, None)
+
+class Signal:
+    __slots__ = ('id', 'name', 'type', 'length', 'direction', 'device', 'row')
+
+    def __init__(self, id, device, name, type, length, direction):
+        self.id = id
+        self.device = device
+        self.row = len(device.signals)  # in device.signals, renumbered after removals
+        self.name = name
+        self.type = type
+        self.length = length
+        self.direction = direction
+
+    def values(self):
+        return (self.name, self.id, self.type, self.length, self.direction)
+
+class SignalModel(QtCore.QAbstractItemModel):
+    def __init__(self, parent=None):
+        super(SignalModel, self).__init__(parent)
+        self.devices = []
+        self.device_rows = {}   # id -> row in devices
+        self.signals = {}       # id -> Signal, whether or not it is a row yet
+        self.pending = {}       # ('device' or 'signal', id) -> latest change
+
+    # queueing, from graph callbacks
+
+    def add_device(self, id, name):
+        self.pending[('device', id)] = ('add', (name,))
+
+    def remove_device(self, id):
+        self.remove(('device', id))
+
+    def add_signal(self, id, device_id, name, type, length, direction):
+        self.pending[('signal', id)] = ('add', (device_id, name, type, length, direction))
+
+    def remove_signal(self, id):
+        self.remove(('signal', id))
+
+    def remove(self, key):
+        change = self.pending.get(key)
+        exists = key[1] in (self.device_rows if key[0] == 'device' else self.signals)
+        if change and change[0] == 'add' and not exists:
+            del self.pending[key]
+        else:
+            self.pending[key] = ('remove', None)
+
+    def flush(self):
+        """Apply the queued changes; returns the number of devices added."""
+        changes, self.pending = self.pending, {}
+        if not changes:
+            return 0
+        notify = len(changes) <= RESET_THRESHOLD
+        if not notify:
+            self.beginResetModel()
+        # removals first, and devices before their signals
+        self.take_signals([id for (kind, id), (op, args) in changes.items()
+                           if op == 'remove' and kind == 'signal'], notify)
+        for (kind, id), (op, args) in changes.items():
+            if op == 'remove' and kind == 'device':
+                self.take_device(id, notify)
+        added = 0
+        for (kind, id), (op, args) in changes.items():
+            if op == 'add' and kind == 'device':
+                added += self.put_device(id, *args, notify=notify)
+        for (kind, id), (op, args) in changes.items():
+            if op == 'add' and kind == 'signal':
+                self.put_signal(id, *args, notify=notify)
+        if not notify:
+            # the view collapses everything on a reset, so devices are lazy again
+            for dev in self.devices:
+                dev.fetched = 0
+                dev.opened = False
+            self.endResetModel()
+        return added
+
+    def take_signals(self, ids, notify):
+        # by device, so that each device's list is rebuilt once per batch
+        rows = {}
+        for id in ids:
+            sig = self.signals.pop(id, None)
+            if sig != None:
+                rows.setdefault(sig.device, []).append(sig.row)
+        for dev, taken in rows.items():
+            taken.sort(reverse=True)
+            hidden = set(dev.signals[r] for r in taken if r >= dev.fetched)
+            # rows on view go in runs from the bottom up, so the rows above
+            # each run keep their numbers
+            visible = [r for r in taken if r < dev.fetched]
+            i = 0
+            while i < len(visible):
+                last = first = visible[i]
+                i += 1
+                while i < len(visible) and visible[i] == first - 1:
+                    first = visible[i]
+                    i += 1
+                if notify:
+                    self.beginRemoveRows(self.device_index(dev), first, last)
+                del dev.signals[first:last + 1]
+                dev.fetched -= last - first + 1
+                if notify:
+                    self.endRemoveRows()
+            if hidden:
+                dev.signals = [sig for sig in dev.signals if sig not in hidden]
+            for r, sig in enumerate(dev.signals):
+                sig.row = r
+
+    def take_device(self, id, notify):
+        row = self.device_rows.get(id)
+        if row == None:
+            return
+        if notify:
+            self.beginRemoveRows(QtCore.QModelIndex(), row, row)
+        dev = self.devices.pop(row)
+        for sig in dev.signals:
+            del self.signals[sig.id]
+        self.device_rows = {d.id: r for r, d in enumerate(self.devices)}
+        if notify:
+            self.endRemoveRows()
+
+    def put_device(self, id, name, notify):
+        row = self.device_rows.get(id)
+        if row != None:
+            self.devices[row].name = name
+            if notify:
+                self.dataChanged.emit(self.index(row, 0), self.index(row, 0))
+            return 0
+        row = len(self.devices)
+        if notify:
+            self.beginInsertRows(QtCore.QModelIndex(), row, row)
+        self.devices.append(Device(id, name))
+        self.device_rows[id] = row
+        if notify:
+            self.endInsertRows()
+        return 1
+
+    def put_signal(self, id, device_id, name, type, length, direction, notify):
+        row = self.device_rows.get(device_id)
+        if row == None:
+            return
+        dev = self.devices[row]
+        sig = self.signals.get(id)
+        if sig != None and sig.device != dev:
+            self.take_signals([id], notify)
+        elif sig != None:
+            sig.name, sig.type, sig.length, sig.direction = name, type, length, direction
+            r = sig.row
+            if notify and r < dev.fetched:
+                parent = self.device_index(dev)
+                self.dataChanged.emit(self.index(r, 0, parent), self.index(r, len(COLUMNS) - 1, parent))
+            return
+        sig = Signal(id, dev, name, type, length, direction)
+        self.signals[id] = sig
+        # an expanded device shows new signals at once; others wait for fetchMore
+        visible = dev.opened and dev.fetched == len(dev.signals)
+        if visible and notify:
+            self.beginInsertRows(self.device_index(dev), dev.fetched, dev.fetched)
+        dev.signals.append(sig)
+        if visible:
+            dev.fetched += 1
+            if notify:
+                self.endInsertRows()
+
+    def open(self, index):
+        """Note that the view expanded the device at index, so its signals
+        are inserted as rows from now on."""
+        if index.isValid() and not index.internalId():
+            self.devices[index.row()].opened = True
+
+    # QAbstractItemModel
+
+    # device rows have an internal id of 0 and signal rows their device's id,
+    # so indexes never point at objects that may be gone
+
+    def device_index(self, dev, column=0):
+        return self.createIndex(self.device_rows[dev.id], column, 0)
+
+    def node(self, index):
+        dev_id = index.internalId()
+        if not dev_id:
+            return self.devices[index.row()]
+        return self.devices[self.device_rows[dev_id]].signals[index.row()]
+
+    def index(self, row, column, parent=QtCore.QModelIndex()):
+        if not self.hasIndex(row, column, parent):
+            return QtCore.QModelIndex()
+        if not parent.isValid():
+            return self.createIndex(row, column, 0)
+        return self.createIndex(row, column, self.devices[parent.row()].id)
+
+    def parent(self, index):
+        if not index.isValid() or not index.internalId():
+            return QtCore.QModelIndex()
+        return self.createIndex(self.device_rows[index.internalId()], 0, 0)
+
+    def rowCount(self, parent=QtCore.QModelIndex()):
+        if not parent.isValid():
+            return len(self.devices)
+        if not parent.internalId() and parent.column() == 0:
+            return self.devices[parent.row()].fetched
+        return 0
+
+    def columnCount(self, parent=QtCore.QModelIndex()):
+        return len(COLUMNS)
+
+    def hasChildren(self, parent=QtCore.QModelIndex()):
+        if not parent.isValid():
+            return len(self.devices) > 0
+        # every device, so the view offers to expand one before its signals arrive
+        return not parent.internalId() and parent.column() == 0
+
+    def canFetchMore(self, parent):
+        if not parent.isValid() or parent.internalId():
+            return False
+        dev = self.devices[parent.row()]
+        return dev.fetched < len(dev.signals)
+
+    def fetchMore(self, parent):
+        if not self.canFetchMore(parent):
+            return
+        dev = self.devices[parent.row()]
+        dev.opened = True
+        count = min(FETCH_BATCH, len(dev.signals) - dev.fetched)
+        self.beginInsertRows(parent, dev.fetched, dev.fetched + count - 1)
+        dev.fetched += count
+        self.endInsertRows()
+
+    def data(self, index, role=QtCore.Qt.DisplayRole):
+        if not index.isValid():
+            return None
+        value = self.node(index).values()[index.column()]
+        if role == SORT_ROLE:
+            # ids are 64-bit unsigned, beyond what a sort role can hold as a
+            # number, but padded to the same width their text sorts the same
+            return '%020d' % value if index.column() == 1 else value
+        if role == QtCore.Qt.DisplayRole:
+            return None if value == None else str(value)
+        return None
+
+    def headerData(self, section, orientation, role=QtCore.Qt.DisplayRole):
+        if orientation == QtCore.Qt.Horizontal and role == QtCore.Qt.DisplayRole:
+            return COLUMNS[section]
+        return None
+
+    def flags(self, index):
+        if not index.isValid():
+            return QtCore.Qt.NoItemFlags
+        flags = QtCore.Qt.ItemIsEnabled | QtCore.Qt.ItemIsSelectable
+        if index.internalId():
+            flags |= QtCore.Qt.ItemIsDragEnabled
+        return flags
+
+    def mimeTypes(self):
+        return ['text/plain']
+
+    def mimeData(self, indexes):
+        for index in indexes:
+            if index.isValid() and index.internalId():
+                sig = self.node(index)
+                mimeData = QtCore.QMimeData()
+                mimeData.setText('libmapper://signal ' + sig.device.name + '/' + sig.name + ' @id ' + str(sig.id))
+                return mimeData
+        return None
@@ -0,0 +1,86 @@
+#ifndef ARMVALUES_H
+#define ARMVALUES_H
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+#include <atomic>
+#include <memory>
+
+// The latest value of each arm, written by the thread receiving them and
+// read by the GUI thread once per frame. Only the last value an arm takes
+// between two frames is drawn, so rather than queueing every update, a write
+// replaces the arm's value and sets its bit in a dirty mask. take() skips 32
+// untouched arms at a time and visits each changed arm once, however many
+// times it was written. Neither side blocks or allocates.
+class ArmValues
+{
+public:
+    explicit ArmValues(int count)
+        : mCount(count), mWords((count + 31) / 32),
+          mValues(new std::atomic<float>[count]), mDirty(new std::atomic<quint32>[mWords])
+    {
+        for (int i = 0; i < mCount; i++)
+            mValues[i].store(0.5f, std::memory_order_relaxed);
+        for (int w = 0; w < mWords; w++)
+            mDirty[w].store(0, std::memory_order_relaxed);
+        mWrites = 0;
+    }
+
+    int count() const { return mCount; }
+
+    // writer side
+    void set(int arm, float value)
+    {
+        if (arm < 0 || arm >= mCount)
+            return;
+        mValues[arm].store(value, std::memory_order_relaxed);
+        mDirty[arm >> 5].fetch_or(1u << (arm & 31), std::memory_order_release);
+        mWrites.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // the first len arms at once, as from a vector signal
+    void setAll(const float *values, int len)
+    {
+        len = qMin(len, mCount);
+        for (int i = 0; i < len; i++)
+            mValues[i].store(values[i], std::memory_order_relaxed);
+        for (int w = 0; w * 32 < len; w++) {
+            int bits = qMin(len - w * 32, 32);
+            mDirty[w].fetch_or(bits == 32 ? ~0u : (1u << bits) - 1, std::memory_order_release);
+        }
+        mWrites.fetch_add(len, std::memory_order_relaxed);
+    }
+
+    // reader side: calls f(arm, value) for every arm written since the last
+    // take() and returns how many there were
+    template <typename F>
+    int take(F f)
+    {
+        int taken = 0;
+        for (int w = 0; w < mWords; w++) {
+            if (!mDirty[w].load(std::memory_order_relaxed))
+                continue;
+            // a write landing after this exchange sets its bit again, so at
+            // worst an arm is drawn with its newest value one frame early
+            quint32 bits = mDirty[w].exchange(0, std::memory_order_acquire);
+            while (bits) {
+                int arm = w * 32 + int(qCountTrailingZeroBits(bits));
+                bits &= bits - 1;
+                f(arm, mValues[arm].load(std::memory_order_relaxed));
+                taken++;
+            }
+        }
+        return taken;
+    }
+
+    // updates written so far, counting each element of a vector
+    quint64 writes() const { return mWrites.load(std::memory_order_relaxed); }
+
+private:
+    const int mCount, mWords;
+    std::unique_ptr<std::atomic<float>[]> mValues;
+    std::unique_ptr<std::atomic<quint32>[]> mDirty;
+    std::atomic<quint64> mWrites;
+};
+
+#endif // ARMVALUES_H
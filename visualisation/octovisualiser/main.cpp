@@ -0,0 +1,49 @@
+#include "octovisualiser.h"
+#include <QApplication>
+#include <QCommandLineParser>
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("arms", QString("Number of arms (default %1).").arg(DEFAULT_ARMS));
+    QCommandLineOption vectorOption("vector",
+        "Receive one signal \"arms\" with an element per arm, instead of a signal \"arm.<n>\" per arm.");
+    parser.addOption(vectorOption);
+    QCommandLineOption fillOption("fill", "Fill the polygon as well as drawing its outline.");
+    parser.addOption(fillOption);
+    QCommandLineOption statsOption("stats", "Print frame statistics once a second.");
+    parser.addOption(statsOption);
+    QCommandLineOption simulateOption("simulate",
+        "Draw random walks updated this many times a second in all (whole vectors with --vector) "
+        "instead of creating a libmapper device.", "rate");
+    parser.addOption(simulateOption);
+    QCommandLineOption quitOption("quit-after", "Quit after this many seconds.", "seconds");
+    parser.addOption(quitOption);
+    parser.process(a);
+
+    int arms = DEFAULT_ARMS;
+    if (!parser.positionalArguments().isEmpty()) {
+        bool ok;
+        arms = parser.positionalArguments().first().toInt(&ok);
+        if (!ok || arms < 1 || arms > MAX_ARMS) {
+            qCritical("the number of arms must be from 1 to %d", MAX_ARMS);
+            return 1;
+        }
+    }
+
+    Octovisualiser w(arms);
+    w.setFilled(parser.isSet(fillOption));
+    w.setStatsEnabled(parser.isSet(statsOption));
+    if (parser.isSet(simulateOption))
+        w.startSimulator(parser.value(simulateOption).toDouble(), parser.isSet(vectorOption));
+    else
+        w.startMapper(parser.isSet(vectorOption));
+    if (parser.isSet(quitOption))
+        QTimer::singleShot(qRound(parser.value(quitOption).toDouble() * 1000), &a, &QApplication::quit);
+    w.show();
+
+    return a.exec();
+}
@@ -0,0 +1,230 @@
+#include "octovisualiser.h"
+#include <QGuiApplication>
+#include <QPainter>
+#include <QScreen>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+using namespace mapper;
+
+void armHandler(Signal&& sig, Signal::Event evt, Id inst, int len, Type type,
+                const void *value, Time&& time)
+{
+    Arm *arm = (Arm*)(void*)sig["arm"];
+    if (!arm || evt != Signal::Event::UPDATE || !value || type != Type::FLOAT)
+        return;
+
+    const float *v = (const float*)value;
+    if (arm->index < 0)
+        arm->values->setAll(v, len);
+    else
+        arm->values->set(arm->index, v[0]);
+}
+
+MapperThread::MapperThread(ArmValues *values, bool vector)
+    : values(values), vector(vector)
+{
+}
+
+void MapperThread::run()
+{
+    mapper::Device device("octovisualiser");
+    // libmapper reads a min and max per element, so as many as the longest signal
+    QVector<float> min(vector ? values->count() : 1, 0), max(min.size(), 1);
+
+    // sized before any property points into it
+    arms.resize(vector ? 1 : values->count());
+    for (int i = 0; i < arms.size(); i++) {
+        arms[i].values = values;
+        arms[i].index = vector ? -1 : i;
+        Signal sig = vector
+            ? device.add_signal(Direction::INCOMING, "arms", values->count(), Type::FLOAT,
+                                0, min.data(), max.data())
+            : device.add_signal(Direction::INCOMING, "arm." + std::to_string(i), 1, Type::FLOAT,
+                                0, min.data(), max.data());
+        sig.set_property("arm", (void*)&arms[i]);
+        sig.set_callback(armHandler, Signal::Event::UPDATE);
+    }
+
+    while (!isInterruptionRequested())
+        device.poll(POLL_MS);
+}
+
+SimulatorThread::SimulatorThread(ArmValues *values, double rate, bool vector)
+    : values(values), rate(rate), vector(vector)
+{
+}
+
+void SimulatorThread::run()
+{
+    std::minstd_rand random(1);
+    std::uniform_real_distribution<float> step(-0.05f, 0.05f);
+    QVector<float> walk(values->count(), 0.5f);
+    int next = 0;
+    quint64 sent = 0;
+    QElapsedTimer clock;
+    clock.start();
+
+    // catch up with the rate after each sleep, so that it holds whatever the
+    // sleep's granularity
+    while (!isInterruptionRequested()) {
+        quint64 due = quint64(clock.nsecsElapsed() * 1e-9 * rate);
+        for (; sent < due; sent++) {
+            if (vector) {
+                for (float &v : walk)
+                    v = qBound(0.0f, v + step(random), 1.0f);
+                values->setAll(walk.constData(), walk.size());
+            } else {
+                walk[next] = qBound(0.0f, walk[next] + step(random), 1.0f);
+                values->set(next, walk[next]);
+                next = (next + 1) % walk.size();
+            }
+        }
+        QThread::msleep(SIMULATE_SLEEP_MS);
+    }
+}
+
+Octovisualiser::Octovisualiser(int arms, QWidget *parent) :
+    QWidget(parent),
+    values(arms),
+    directions(arms),
+    shown(arms, 0.5f),
+    polygon(arms),
+    radius(0),
+    filled(false),
+    statsEnabled(false),
+    statsFrames(0),
+    statsPaintMs(0),
+    statsMoved(0),
+    statsWrites(0)
+{
+    setWindowTitle(QString("octovisualiser: %1 arms").arg(arms));
+    resize(400, 400);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
+    // clockwise from the right, as in octovisualiser.py
+    for (int i = 0; i < arms; i++) {
+        double angle = 2 * M_PI * i / arms;
+        directions[i] = QPointF(std::cos(angle), std::sin(angle));
+    }
+    layoutArms();
+
+    statsTimer.start();
+    statsCpu = std::clock();
+
+    // redraw at most once per display refresh, whatever the rate of updates
+    QScreen *screen = QGuiApplication::primaryScreen();
+    qreal refreshRate = screen ? screen->refreshRate() : 60;
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&frameTimer, SIGNAL(timeout()), this, SLOT(frameSlot()));
+    frameTimer.start(qMax(1, qRound(1000 / qMax(refreshRate, 1.0))));
+}
+
+Octovisualiser::~Octovisualiser()
+{
+    frameTimer.stop();
+    if (source) {
+        source->requestInterruption();
+        source->wait();
+    }
+}
+
+void Octovisualiser::startMapper(bool vector)
+{
+    source.reset(new MapperThread(&values, vector));
+    source->start();
+}
+
+void Octovisualiser::startSimulator(double rate, bool vector)
+{
+    source.reset(new SimulatorThread(&values, rate, vector));
+    source->start();
+}
+
+void Octovisualiser::frameSlot()
+{
+    int moved = values.take([this](int arm, float value) {
+        // also maps NaN to 1 rather than into the drawing
+        value = qBound(0.0f, value, 1.0f);
+        shown[arm] = value;
+        polygon[arm] = centre + directions[arm] * (radius * value);
+    });
+    if (moved) {
+        statsMoved += moved;
+        update();
+    }
+
+    if (statsEnabled && statsTimer.elapsed() >= STATS_INTERVAL_MS)
+        reportStats();
+}
+
+void Octovisualiser::reportStats()
+{
+    double wall = statsTimer.restart() * 1e-3;
+    std::clock_t cpu = std::clock();
+    double load = wall > 0 ? (double)(cpu - statsCpu) / CLOCKS_PER_SEC / wall * 100 : 0;
+    statsCpu = cpu;
+    quint64 writes = values.writes();
+
+    printf("%d arms: %.1f fps, %.2f ms/frame, CPU %.1f%%, %.0f updates/s, %.0f vertices moved/s\n",
+           values.count(), statsFrames / wall, statsFrames ? statsPaintMs / statsFrames : 0, load,
+           (writes - statsWrites) / wall, statsMoved / wall);
+    fflush(stdout);
+    statsFrames = 0;
+    statsPaintMs = 0;
+    statsMoved = 0;
+    statsWrites = writes;
+}
+
+void Octovisualiser::layoutArms()
+{
+    centre = QPointF(width() / 2.0, height() / 2.0);
+    radius = qMin(width(), height()) * RADIUS_FRACTION;
+    for (int i = 0; i < polygon.size(); i++)
+        polygon[i] = centre + directions[i] * (radius * shown[i]);
+
+    qreal ratio = devicePixelRatioF();
+    spokes = QPixmap(size() * ratio);
+    spokes.setDevicePixelRatio(ratio);
+    spokes.fill(Qt::white);
+    QPainter painter(&spokes);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(Qt::gray, 0));
+    int step = (directions.size() + MAX_SPOKES - 1) / MAX_SPOKES;
+    QVector<QLineF> lines;
+    for (int i = 0; i < directions.size(); i += step)
+        lines << QLineF(centre, centre + directions[i] * radius);
+    painter.drawLines(lines);
+}
+
+void Octovisualiser::resizeEvent(QResizeEvent *event)
+{
+    layoutArms();
+    QWidget::resizeEvent(event);
+}
+
+void Octovisualiser::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QElapsedTimer timer;
+    timer.start();
+
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, spokes);
+    if (filled) {
+        // an antialiased fill of a spiky polygon costs several times its
+        // outline, and the antialiased outline drawn over it hides the edge
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QColor(70, 130, 180, 160));
+        painter.drawPolygon(polygon);
+    }
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(Qt::black, 0));
+    painter.setBrush(Qt::NoBrush);
+    painter.drawPolygon(polygon);
+
+    statsFrames++;
+    statsPaintMs += timer.nsecsElapsed() * 1e-6;
+}
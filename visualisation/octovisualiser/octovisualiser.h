@@ -0,0 +1,129 @@
+#ifndef OCTOVISUALISER_H
+#define OCTOVISUALISER_H
+
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <QPolygonF>
+#include <QScopedPointer>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QWidget>
+
+#include <mapper/mapper_cpp.h>
+#include <ctime>
+
+#include "armvalues.h"
+
+#define DEFAULT_ARMS 8
+#define MAX_ARMS 4096           // arms are narrower than a pixel well before this
+#define MAX_SPOKES 128          // with more arms, only every nth spoke is drawn
+#define RADIUS_FRACTION 0.375   // of the smaller side, as octovisualiser.py's 150 of 400
+#define POLL_MS 10
+#define SIMULATE_SLEEP_MS 1     // between batches of generated values
+#define STATS_INTERVAL_MS 1000  // how often frame statistics are printed
+
+// function prototypes
+void armHandler(mapper::Signal&& sig, mapper::Signal::Event evt, mapper::Id inst, int len,
+                mapper::Type type, const void *value, mapper::Time&& time);
+
+// what a signal drives, kept as its "arm" property so that one handler
+// serves every signal
+struct Arm
+{
+    ArmValues *values;
+    int index; // -1 for a vector holding every arm
+};
+
+// owns the mapper::Device and polls it, writing each update straight into the
+// ArmValues; the GUI only ever reads them once per frame
+class MapperThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    // vector: one signal "arms" with an element per arm, rather than one
+    // scalar signal "arm.<n>" per arm
+    MapperThread(ArmValues *values, bool vector);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    ArmValues *values;
+    bool vector;
+    QVector<Arm> arms;
+};
+
+// stands in for the network: a random walk on every arm, written round robin
+// at a fixed aggregate rate, or as whole vectors at that rate
+class SimulatorThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    SimulatorThread(ArmValues *values, double rate, bool vector);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    ArmValues *values;
+    double rate;
+    bool vector;
+};
+
+// a polygon with a vertex on each of N spokes, at a distance from the centre
+// following that arm's value in [0, 1]. The spokes are drawn once per resize
+// into a cached pixmap, and the polygon is kept from frame to frame, with only
+// the vertices of arms that changed moved. Nothing is drawn in a frame where no
+// arm changed.
+class Octovisualiser : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit Octovisualiser(int arms, QWidget *parent = 0);
+    ~Octovisualiser();
+
+    // start receiving values, once, from libmapper or generated at rate updates a second
+    void startMapper(bool vector);
+    void startSimulator(double rate, bool vector);
+
+    // filling costs more than the outline as arms grow
+    void setFilled(bool enabled) { filled = enabled; update(); }
+    // print frame statistics to stdout every STATS_INTERVAL_MS
+    void setStatsEnabled(bool enabled) { statsEnabled = enabled; }
+
+protected:
+    void paintEvent(QPaintEvent *event) Q_DECL_OVERRIDE;
+    void resizeEvent(QResizeEvent *event) Q_DECL_OVERRIDE;
+
+private Q_SLOTS:
+    void frameSlot();
+
+private:
+    void layoutArms();
+    void reportStats();
+
+    ArmValues values;
+    QScopedPointer<QThread> source;
+    QVector<QPointF> directions; // unit vector along each spoke
+    QVector<float> shown;        // the value each vertex was placed for
+    QPolygonF polygon;
+    QPixmap spokes;
+    QPointF centre;
+    qreal radius;
+    bool filled;
+
+    bool statsEnabled;
+    QElapsedTimer statsTimer;
+    std::clock_t statsCpu;
+    int statsFrames;
+    double statsPaintMs;
+    quint64 statsMoved;
+    quint64 statsWrites;
+    QTimer frameTimer;
+};
+
+#endif // OCTOVISUALISER_H
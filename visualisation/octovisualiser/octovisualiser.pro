@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# Native replacement for octovisualiser.py
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = octovisualiser
+TEMPLATE = app
+
+CONFIG += no_keywords #signals
+
+CONFIG += c++11
+
+SOURCES += main.cpp \
+        octovisualiser.cpp
+
+HEADERS  += octovisualiser.h \
+            armvalues.h
+
+INCLUDEPATH += /usr/local/include
+DEPENDPATH += /usr/local/include
+
+win32:CONFIG(release, debug|release): LIBS += -L/usr/local/lib/release/ -lmapper
+else:win32:CONFIG(debug, debug|release): LIBS += -L/usr/local/lib/debug/ -lmapper
+else:unix: LIBS += -L/usr/local/lib/ -lmapper
+
+INCLUDEPATH += /usr/local/include/mapper
+DEPENDPATH += /usr/local/include/mapper
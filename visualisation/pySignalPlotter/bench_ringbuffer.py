@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+# Per-frame cost of keeping and drawing a 10 s window of a 3-element signal,
+# with the deques pySignalPlotter used to keep against the ringbuffer
+# extension. Each frame appends 25 ms of samples, expires the old ones and
+# produces the arrays handed to setData; pyqtgraph itself is left out.
+#
+#   python3 bench_ringbuffer.py [pixels]
+
+import math, sys, time
+from collections import deque
+import numpy as np
+import ringbuffer
+
+WINDOW_SEC = 10
+FRAME_SEC = 0.025
+FRAMES = 200
+VEC_LEN = 3
+
+def deques(rate, frames):
+    tts, vals = deque(), [deque() for el in range(VEC_LEN)]
+    t, elapsed = 0.0, 0.0
+    for frame in range(frames):
+        for i in range(int(rate * FRAME_SEC)):
+            t += 1.0 / rate
+            tts.append(t)
+            for el in range(VEC_LEN):
+                vals[el].append(math.sin(t * (el + 1)))
+        start = time.perf_counter()
+        to_pop = 0
+        for tt in tts:
+            if tt > t - WINDOW_SEC:
+                break
+            to_pop += 1
+        for el in range(VEC_LEN):
+            for j in range(to_pop):
+                vals[el].popleft()
+        for j in range(to_pop):
+            tts.popleft()
+        # what setData does with a deque
+        x = np.array(tts)
+        ys = [np.array(vals[el]) for el in range(VEC_LEN)]
+        if frame >= frames // 2:
+            elapsed += time.perf_counter() - start
+    return elapsed / (frames - frames // 2), len(x)
+
+def rings(rate, frames, pixels):
+    ring = ringbuffer.Ring(VEC_LEN)
+    t, elapsed = 0.0, 0.0
+    for frame in range(frames):
+        for i in range(int(rate * FRAME_SEC)):
+            t += 1.0 / rate
+            ring.append(t, [math.sin(t * (el + 1)) for el in range(VEC_LEN)])
+        start = time.perf_counter()
+        ring.expire(t - WINDOW_SEC)
+        points = 0
+        for el in range(VEC_LEN):
+            x, y = ring.decimate(t - WINDOW_SEC, t, pixels, el)
+            x, y = np.frombuffer(x), np.frombuffer(y)
+            points = len(x)
+        if frame >= frames // 2:
+            elapsed += time.perf_counter() - start
+    return elapsed / (frames - frames // 2), points
+
+if __name__ == '__main__':
+    pixels = int(sys.argv[1]) if len(sys.argv) > 1 else 1000
+    # enough frames to fill the window before timing the second half
+    frames = max(FRAMES, int(2 * WINDOW_SEC / FRAME_SEC) + 20)
+    for rate in (100, 1000, 10000):
+        old, old_points = deques(rate, frames)
+        new, new_points = rings(rate, frames, pixels)
+        print('%5d Hz: deques %8.3f ms/frame (%d points), ring %6.3f ms/frame (%d points)'
+              % (rate, old * 1e3, old_points, new * 1e3, new_points))
@@ -1,10 +1,16 @@
 from PySide6 import QtGui, QtWidgets, QtCore
 import pyqtgraph as pg
 import sys, math, time
-from collections import deque
+import numpy as np
 import libmapper as mpr
 import os
 
+try:
+    import ringbuffer
+except ImportError:
+    print('the ringbuffer extension is missing, build it with: python3 setup.py build_ext --inplace')
+    sys.exit(1)
+
 signals = {}
 sigs_to_free = []
 
@@ -38,27 +44,15 @@ def sig_handler(sig, event, id, val, tt):
         print('signal not found')
         return
 
-    vec_len = match['vec_len']
-
-    if id not in match['vals']:
+    if id not in match['rings']:
         # don't bother recording an instance release
-        if event != mpr.Signal.Event.REL_UPSTRM:
-            if isinstance(val, list):
-                match['vals'][id] = [deque([val[el]]) for el in range(vec_len)]
-            else:
-                match['vals'][id] = [deque([val])]
-            match['tts'][id] = deque([now])
-            match['curves'][id] = None
-        return
-    elif event == mpr.Signal.Event.REL_UPSTRM:
-        for el in range(vec_len):
-            match['vals'][id][el].append(float('nan'))
-    elif isinstance(val, list):
-        for el in range(vec_len):
-            match['vals'][id][el].append(val[el])
-    else:
-        match['vals'][id][0].append(val)
-    match['tts'][id].append(now)
+        if event == mpr.Signal.Event.REL_UPSTRM:
+            return
+        match['rings'][id] = ringbuffer.Ring(match['vec_len'])
+        match['curves'][id] = None
+
+    # a release is recorded as a gap in the line
+    match['rings'][id].append(now, None if event == mpr.Signal.Event.REL_UPSTRM else val)
 
 # TODO: handle convergent maps or explicitly disallow them
 def on_map(type, map, event):
@@ -98,8 +92,7 @@ def on_map(type, map, event):
 
         signals[srcname] = {'sig'       : newsig,
                             'vec_len'   : vec_len,
-                            'vals'      : {},
-                            'tts'       : {},
+                            'rings'     : {},
                             'pens'      : [pg.mkPen(color=i, width=3) for i in range(vec_len)],
                             'curves'    : {},
                             'label'     : 0 }
@@ -276,7 +269,7 @@ class MainWindow(QtWidgets.QMainWindow):
 #            data = signals[s]
 #            if data['vec_len'] == 2 and data['plot']:
 #                data['plot'].clear()
-#                for inst in data['vals']:
+#                for inst in data['rings']:
 #                    del data['curves'][inst]
 #                    data['curves'][inst] = None
 
@@ -302,43 +295,42 @@ class MainWindow(QtWidgets.QMainWindow):
                 plot.closeButton.clicked.connect(lambda: self.closePlot(s))
                 data['plot'] = plot
 
-            if not len (data['vals']):
+            if not len (data['rings']):
                 # no active instances? remove this?
                 continue
 
+            # each curve gets at most two points per pixel column, and a NaN where one holds a
+            # gap, whatever the sample rate
+            pixels = max(1, int(plot.getViewBox().width()))
             updated = False
-            for inst in data['vals']:
-                tts = data['tts'][inst]
-                vals = data['vals'][inst]
+            for inst in data['rings']:
+                ring = data['rings'][inst]
                 vec_len = data['vec_len']
 
-                # pop samples older than window
-                # TODO: use numpy to handle instances, vectors?
-                to_pop = 0
-                for tt in tts:
-                    if tt > (then - 1):
-                        break
-                    to_pop += 1
-                for el in range(vec_len):
-                    for j in range(to_pop):
-                        vals[el].popleft()
-                for j in range(to_pop):
-                    tts.popleft()
-
-                if not len(tts):
+                # drop samples older than window
+                ring.expire(then - 1)
+                if not len(ring):
                     continue
 
+                if vec_len == 2 and use_2d == True:
+                    # a trajectory cannot be decimated by time; copy the window out of
+                    # the ring so the curve holds no view of it
+                    rows = np.array(ring)
+                    lines = [(rows[:, 1], rows[:, 2])]
+                else:
+                    lines = []
+                    for el in range(vec_len):
+                        x, y = ring.decimate(then, now, pixels, el)
+                        lines.append((np.frombuffer(x), np.frombuffer(y)))
+
                 if signals[s]['curves'][inst] == None:
                     if vec_len == 2 and use_2d == True:
-                        signals[s]['curves'][inst] = [plot.plot(vals[0], vals[1], pen=pg.mkPen(color=inst, width=3), connect='finite')]
+                        signals[s]['curves'][inst] = [plot.plot(*lines[0], pen=pg.mkPen(color=inst, width=3), connect='finite')]
                     else:
-                        signals[s]['curves'][inst] = [plot.plot(tts, vals[el], pen=pg.mkPen(color=inst*vec_len+el, width=3), connect='finite') for el in range(vec_len)]
+                        signals[s]['curves'][inst] = [plot.plot(*lines[el], pen=pg.mkPen(color=inst*vec_len+el, width=3), connect='finite') for el in range(vec_len)]
                 else:
-                    if vec_len == 2 and use_2d == True:
-                        signals[s]['curves'][inst][0].setData(vals[0], vals[1], connect='finite')
-                    else:
-                        for el in range(vec_len):
-                            signals[s]['curves'][inst][el].setData(tts, vals[el], connect='finite')
+                    for curve, line in zip(signals[s]['curves'][inst], lines):
+                        curve.setData(*line, connect='finite')
                 updated = True
 
             if vec_len != 2 or use_2d == False:
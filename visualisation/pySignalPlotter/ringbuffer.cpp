@@ -0,0 +1,506 @@
+/* Sample storage for pySignalPlotter: a typed buffer of [time, values...]  *
+ * rows with O(1) append and expiry, exported to numpy through the buffer   *
+ * protocol without copying, and a min/max summary pyramid so decimating a  *
+ * window to the plot's pixel width costs about the same for any sample     *
+ * rate.                                                                    *
+ *                                                                          *
+ *     ring = ringbuffer.Ring(3)                                            *
+ *     ring.append(t, (x, y, z))        # None appends a gap                *
+ *     ring.expire(t - 10)                                                  *
+ *     rows = numpy.asarray(ring)       # shape (len(ring), 4), a view      *
+ *     x, y = ring.decimate(t - 10, t, 800, element=0)                      *
+ *                                                                          *
+ * Build with "python3 setup.py build_ext --inplace".                       */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#define INITIAL_ROWS 1024
+#define PYRAMID_SHIFT 3     // each level summarises blocks of 8 entries of the one below
+#define PYRAMID_LEVELS 8    // enough for windows of millions of samples
+
+namespace {
+
+// NaN marks gaps and never becomes an extreme unless a block holds only gaps
+inline void take(double v, double &min, double &max)
+{
+    if (v < min || min != min)
+        min = v;
+    if (v > max || max != max)
+        max = v;
+}
+
+/* Extrema of consecutive blocks of 8^L samples per level L and element,
+ * with whether the block holds a gap, addressed by absolute sample index so
+ * expiry costs nothing; as in qtSignalPlotter's MinMaxPyramid, a query
+ * touches at most 2 * 7 entries per level. */
+class Pyramid
+{
+public:
+    explicit Pyramid(int width) : _width(width), _levels(PYRAMID_LEVELS) {}
+
+    // index increases by one per call; first is the oldest live index
+    void append(int64_t index, const double *values, int64_t first)
+    {
+        for (size_t l = 0; l < _levels.size(); l++) {
+            Level &level = _levels[l];
+            int shift = PYRAMID_SHIFT * (int)(l + 1);
+            int64_t block = index >> shift;
+            if (block != level.last) {
+                int64_t needed = block - (first >> shift) + 1;
+                if (needed > level.blocks)
+                    grow(level, first >> shift, std::max(needed, level.blocks * 2));
+                double *b = entry(level, block);
+                for (int e = 0; e < _width; e++) {
+                    b[ENTRY * e] = b[ENTRY * e + 1] = values[e];
+                    b[ENTRY * e + 2] = values[e] != values[e];
+                }
+                level.last = block;
+                continue;
+            }
+            double *b = entry(level, block);
+            for (int e = 0; e < _width; e++) {
+                take(values[e], b[ENTRY * e], b[ENTRY * e + 1]);
+                if (values[e] != values[e])
+                    b[ENTRY * e + 2] = 1;
+            }
+        }
+    }
+
+    /* extrema of element over absolute indices [begin, end), and whether a
+     * gap lies among them; raw(i) is sample i */
+    template <class Raw>
+    void min_max(int64_t begin, int64_t end, int element, Raw raw,
+                 double &min, double &max, bool &gap) const
+    {
+        min = max = NAN;
+        gap = false;
+        size_t level = 0;
+        while (begin < end) {
+            if (level == _levels.size()) {
+                for (; begin < end; begin++)
+                    fold(level, begin, element, raw, min, max, gap);
+                break;
+            }
+            const int64_t mask = (1 << PYRAMID_SHIFT) - 1;
+            for (; begin < end && (begin & mask); begin++)
+                fold(level, begin, element, raw, min, max, gap);
+            for (; begin < end && (end & mask); end--)
+                fold(level, end - 1, element, raw, min, max, gap);
+            begin >>= PYRAMID_SHIFT;
+            end >>= PYRAMID_SHIFT;
+            ++level;
+        }
+    }
+
+private:
+    enum { ENTRY = 3 };     // min, max and 1 if there is a gap, per element
+
+    struct Level
+    {
+        Level() : blocks(0), last(-1) {}
+        std::vector<double> extrema;    // ENTRY per element, circular by block
+        int64_t blocks, last;
+    };
+
+    double *entry(Level &level, int64_t block)
+    {
+        return &level.extrema[(size_t)(block % level.blocks) * _width * ENTRY];
+    }
+
+    template <class Raw>
+    void fold(size_t level, int64_t i, int element, Raw &raw,
+              double &min, double &max, bool &gap) const
+    {
+        if (!level) {
+            double v = raw(i);
+            take(v, min, max);
+            gap |= v != v;
+            return;
+        }
+        const Level &l = _levels[level - 1];
+        const double *b = &l.extrema[(size_t)(i % l.blocks) * _width * ENTRY + ENTRY * element];
+        gap |= b[2] != 0;
+        // a block's min is NaN only if all of it is
+        if (b[0] == b[0]) {
+            take(b[0], min, max);
+            take(b[1], min, max);
+        }
+    }
+
+    // re-lay the live blocks [first, last] out for the new modulus
+    void grow(Level &level, int64_t first, int64_t blocks)
+    {
+        std::vector<double> extrema((size_t)blocks * _width * ENTRY);
+        for (int64_t b = std::max(first, level.last - level.blocks + 1); b <= level.last; b++)
+            memcpy(&extrema[(size_t)(b % blocks) * _width * ENTRY], entry(level, b),
+                   _width * ENTRY * sizeof(double));
+        level.extrema.swap(extrema);
+        level.blocks = blocks;
+    }
+
+    int _width;
+    std::vector<Level> _levels;
+};
+
+/* Rows live contiguously in [_begin, _end) of one allocation, so the window
+ * is always a single strided array. When the end is reached the live rows
+ * move to the front, and the allocation doubles if they fill over half of
+ * it, which keeps appending amortised O(1). */
+class RingBuffer
+{
+public:
+    explicit RingBuffer(int width)
+    : _width(width), _stride(width + 1), _rows((size_t)INITIAL_ROWS * (width + 1)),
+      _begin(0), _end(0), _first(0), _pyramid(width) {}
+
+    int width() const { return _width; }
+    size_t size() const { return _end - _begin; }
+    const double *data() const { return &_rows[_begin * _stride]; }
+    double time(size_t i) const { return _rows[(_begin + i) * _stride]; }
+    double value(size_t i, int element) const { return _rows[(_begin + i) * _stride + 1 + element]; }
+    // the next append moves the rows, which exported views must not see
+    bool full() const { return _end * _stride == _rows.size(); }
+
+    // values null appends a gap
+    void append(double t, const double *values)
+    {
+        if (full())
+            relocate();
+        double *row = &_rows[_end * _stride];
+        row[0] = t;
+        for (int e = 0; e < _width; e++)
+            row[1 + e] = values ? values[e] : NAN;
+        _pyramid.append(_first + (int64_t)size(), row + 1, _first);
+        ++_end;
+    }
+
+    // drops rows before time t, assuming times only increase
+    void expire(double t)
+    {
+        size_t n = lower_bound(0, size(), t);
+        _begin += n;
+        _first += n;
+        if (_begin == _end)
+            _begin = _end = 0;
+    }
+
+    // first row in [lo, hi) at or after t
+    size_t lower_bound(size_t lo, size_t hi, double t) const
+    {
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (time(mid) < t)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    /* at most 3 * pixels + 2 points of element over [start, end]: the rows
+     * themselves if there are few enough, otherwise the extrema of each
+     * pixel's rows at its first and last times, with a NaN between them if
+     * the pixel holds a gap so that the line still breaks there. One row
+     * either side is kept so the line reaches the edges. */
+    size_t decimate(double start, double end, int pixels, int element, double *x, double *y) const
+    {
+        // rows in [start, end] are [first, last), and lo and hi add the edges
+        size_t first = lower_bound(0, size(), start);
+        size_t last = lower_bound(first, size(), std::nextafter(end, INFINITY));
+        size_t lo = first ? first - 1 : first, hi = last < size() ? last + 1 : last;
+        size_t n = 0;
+        if (hi - lo <= (size_t)pixels * 2) {
+            for (size_t i = lo; i < hi; i++, n++) {
+                x[n] = time(i);
+                y[n] = value(i, element);
+            }
+            return n;
+        }
+
+        auto raw = [&](int64_t index) { return value((size_t)(index - _first), element); };
+        double step = (end - start) / pixels;
+        if (lo < first) {
+            x[n] = time(lo);
+            y[n++] = value(lo, element);
+        }
+        size_t i = first;
+        for (int p = 0; p < pixels && i < last; p++) {
+            size_t next = p + 1 == pixels ? last : lower_bound(i, last, start + (p + 1) * step);
+            if (next == i)
+                continue;
+            double min, max;
+            bool gap;
+            _pyramid.min_max(_first + (int64_t)i, _first + (int64_t)next, element, raw, min, max, gap);
+            x[n] = time(i);
+            y[n++] = min;
+            if (gap) {
+                x[n] = (time(i) + time(next - 1)) / 2;
+                y[n++] = NAN;
+            }
+            x[n] = time(next - 1);
+            y[n++] = max;
+            i = next;
+        }
+        if (last < hi) {
+            x[n] = time(last);
+            y[n++] = value(last, element);
+        }
+        return n;
+    }
+
+private:
+    void relocate()
+    {
+        size_t live = size();
+        if (live * 2 > _rows.size() / _stride)
+            _rows.resize(_rows.size() * 2);
+        memmove(&_rows[0], &_rows[_begin * _stride], live * _stride * sizeof(double));
+        _begin = 0;
+        _end = live;
+    }
+
+    int _width, _stride;
+    std::vector<double> _rows;
+    size_t _begin, _end;
+    int64_t _first;     // absolute index of row _begin, for the pyramid
+    Pyramid _pyramid;
+};
+
+struct RingObject
+{
+    PyObject_HEAD
+    RingBuffer *ring;
+    Py_ssize_t exports;
+    Py_ssize_t shape[2], strides[2];
+};
+
+PyObject *Ring_new(PyTypeObject *type, PyObject *, PyObject *)
+{
+    RingObject *self = (RingObject*)type->tp_alloc(type, 0);
+    if (self)
+        self->ring = new RingBuffer(1);
+    return (PyObject*)self;
+}
+
+int Ring_init(RingObject *self, PyObject *args, PyObject *kwds)
+{
+    static const char *kwlist[] = {"width", NULL};
+    int width = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", (char**)kwlist, &width))
+        return -1;
+    if (width < 1) {
+        PyErr_SetString(PyExc_ValueError, "width must be at least 1");
+        return -1;
+    }
+    if (self->exports) {
+        PyErr_SetString(PyExc_BufferError, "ring is exported");
+        return -1;
+    }
+    delete self->ring;
+    self->ring = new RingBuffer(width);
+    return 0;
+}
+
+void Ring_dealloc(RingObject *self)
+{
+    delete self->ring;
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+Py_ssize_t Ring_len(RingObject *self)
+{
+    return (Py_ssize_t)self->ring->size();
+}
+
+PyObject *Ring_append(RingObject *self, PyObject *args)
+{
+    double t;
+    PyObject *value;
+    if (!PyArg_ParseTuple(args, "dO", &t, &value))
+        return NULL;
+    RingBuffer *ring = self->ring;
+    if (self->exports && ring->full()) {
+        PyErr_SetString(PyExc_BufferError, "cannot grow a ring while a view of it exists");
+        return NULL;
+    }
+    if (value == Py_None) {
+        ring->append(t, NULL);
+        Py_RETURN_NONE;
+    }
+    double values[64];
+    std::vector<double> wide;
+    double *v = ring->width() <= 64 ? values : (wide.resize(ring->width()), wide.data());
+    if (PyNumber_Check(value) && !PySequence_Check(value)) {
+        v[0] = PyFloat_AsDouble(value);
+        if (v[0] == -1 && PyErr_Occurred())
+            return NULL;
+        for (int e = 1; e < ring->width(); e++)
+            v[e] = v[0];
+    } else {
+        PyObject *seq = PySequence_Fast(value, "value must be a number, a sequence or None");
+        if (!seq)
+            return NULL;
+        if (PySequence_Fast_GET_SIZE(seq) != ring->width()) {
+            Py_DECREF(seq);
+            return PyErr_Format(PyExc_ValueError, "expected %d values", ring->width());
+        }
+        PyObject **items = PySequence_Fast_ITEMS(seq);
+        for (int e = 0; e < ring->width(); e++) {
+            v[e] = items[e] == Py_None ? NAN : PyFloat_AsDouble(items[e]);
+            if (v[e] == -1 && PyErr_Occurred()) {
+                Py_DECREF(seq);
+                return NULL;
+            }
+        }
+        Py_DECREF(seq);
+    }
+    ring->append(t, v);
+    Py_RETURN_NONE;
+}
+
+PyObject *Ring_expire(RingObject *self, PyObject *arg)
+{
+    double t = PyFloat_AsDouble(arg);
+    if (t == -1 && PyErr_Occurred())
+        return NULL;
+    if (self->exports) {
+        PyErr_SetString(PyExc_BufferError, "cannot expire rows while a view of the ring exists");
+        return NULL;
+    }
+    self->ring->expire(t);
+    Py_RETURN_NONE;
+}
+
+PyObject *Ring_decimate(RingObject *self, PyObject *args, PyObject *kwds)
+{
+    static const char *kwlist[] = {"start", "end", "pixels", "element", NULL};
+    double start, end;
+    int pixels, element = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ddi|i", (char**)kwlist,
+                                     &start, &end, &pixels, &element))
+        return NULL;
+    if (element < 0 || element >= self->ring->width())
+        return PyErr_Format(PyExc_IndexError, "element %d out of range", element);
+    if (pixels < 1 || !(end > start))
+        pixels = 1;
+    Py_ssize_t capacity = (Py_ssize_t)(3 * pixels + 2) * sizeof(double);
+    PyObject *x = PyBytes_FromStringAndSize(NULL, capacity);
+    PyObject *y = PyBytes_FromStringAndSize(NULL, capacity);
+    if (!x || !y) {
+        Py_XDECREF(x);
+        Py_XDECREF(y);
+        return NULL;
+    }
+    size_t n = self->ring->decimate(start, end, pixels, element,
+                                    (double*)PyBytes_AS_STRING(x), (double*)PyBytes_AS_STRING(y));
+    if (_PyBytes_Resize(&x, n * sizeof(double)) || _PyBytes_Resize(&y, n * sizeof(double))) {
+        Py_XDECREF(x);
+        Py_XDECREF(y);
+        return NULL;
+    }
+    return Py_BuildValue("(NN)", x, y);
+}
+
+PyObject *Ring_get_width(RingObject *self, void *)
+{
+    return PyLong_FromLong(self->ring->width());
+}
+
+// the live rows as a read-only (rows, width + 1) array of doubles
+int Ring_getbuffer(RingObject *self, Py_buffer *view, int flags)
+{
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "ring views are read-only");
+        return -1;
+    }
+    RingBuffer *ring = self->ring;
+    if (!self->exports) {
+        self->shape[0] = (Py_ssize_t)ring->size();
+        self->shape[1] = ring->width() + 1;
+        self->strides[0] = self->shape[1] * sizeof(double);
+        self->strides[1] = sizeof(double);
+    }
+    view->buf = (void*)ring->data();
+    view->obj = (PyObject*)self;
+    Py_INCREF(self);
+    view->len = self->shape[0] * self->strides[0];
+    view->readonly = 1;
+    view->itemsize = sizeof(double);
+    view->format = (flags & PyBUF_FORMAT) ? (char*)"d" : NULL;
+    view->ndim = 2;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    ++self->exports;
+    return 0;
+}
+
+void Ring_releasebuffer(RingObject *self, Py_buffer *)
+{
+    --self->exports;
+}
+
+PyMethodDef Ring_methods[] = {
+    {"append", (PyCFunction)Ring_append, METH_VARARGS,
+     "append(time, value): add a row; value is a number, a sequence of width numbers, "
+     "or None for a gap. Times must not decrease."},
+    {"expire", (PyCFunction)Ring_expire, METH_O,
+     "expire(time): drop the rows before time."},
+    {"decimate", (PyCFunction)(void(*)(void))Ring_decimate, METH_VARARGS | METH_KEYWORDS,
+     "decimate(start, end, pixels, element=0) -> (x, y): at most 3 * pixels + 2 points "
+     "of one element over [start, end], as bytes of doubles for numpy.frombuffer."},
+    {NULL}
+};
+
+PyGetSetDef Ring_getset[] = {
+    {"width", (getter)Ring_get_width, NULL, "values per row", NULL},
+    {NULL}
+};
+
+PySequenceMethods Ring_as_sequence = {(lenfunc)Ring_len};
+
+PyBufferProcs Ring_as_buffer = {(getbufferproc)Ring_getbuffer, (releasebufferproc)Ring_releasebuffer};
+
+PyTypeObject RingType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
+PyModuleDef module = {
+    PyModuleDef_HEAD_INIT, "ringbuffer",
+    "Sample buffers with zero-copy numpy views and min/max decimation.", -1, NULL
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_ringbuffer(void)
+{
+    RingType.tp_name = "ringbuffer.Ring";
+    RingType.tp_doc = "Ring(width=1): rows of a time and width values, oldest first.";
+    RingType.tp_basicsize = sizeof(RingObject);
+    RingType.tp_flags = Py_TPFLAGS_DEFAULT;
+    RingType.tp_new = Ring_new;
+    RingType.tp_init = (initproc)Ring_init;
+    RingType.tp_dealloc = (destructor)Ring_dealloc;
+    RingType.tp_methods = Ring_methods;
+    RingType.tp_getset = Ring_getset;
+    RingType.tp_as_sequence = &Ring_as_sequence;
+    RingType.tp_as_buffer = &Ring_as_buffer;
+    if (PyType_Ready(&RingType) < 0)
+        return NULL;
+
+    PyObject *m = PyModule_Create(&module);
+    if (!m)
+        return NULL;
+    Py_INCREF(&RingType);
+    if (PyModule_AddObject(m, "Ring", (PyObject*)&RingType) < 0) {
+        Py_DECREF(&RingType);
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
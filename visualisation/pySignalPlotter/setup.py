@@ -0,0 +1,9 @@
+# Builds the ringbuffer extension next to pySignalPlotter.py:
+#
+#   python3 setup.py build_ext --inplace
+
+from setuptools import setup, Extension
+
+setup(name='ringbuffer',
+      ext_modules=[Extension('ringbuffer', ['ringbuffer.cpp'],
+                             extra_compile_args=['-std=c++11', '-O2'])])
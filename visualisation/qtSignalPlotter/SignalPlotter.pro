@@ -15,11 +15,31 @@ CONFIG += no_keywords #signals
 
 CONFIG += c++11
 
+# lets --opengl render through QCPPaintBufferGlFbo instead of QPixmap buffers
+DEFINES += QCUSTOMPLOT_USE_OPENGL
+greaterThan(QT_MAJOR_VERSION, 5): QT += opengl
+win32: LIBS += -lopengl32
+
 SOURCES += main.cpp \
         signalplotter.cpp \
+        ringdatacontainer.cpp \
+        minmaxpyramid.cpp \
+        decimatedgraph.cpp \
+        signalstats.cpp \
+        fft.cpp \
+        spectrogram.cpp \
+        capturefile.cpp \
         qcustomplot.cpp
 
 HEADERS  += signalplotter.h \
+            ringdatacontainer.h \
+            minmaxpyramid.h \
+            decimatedgraph.h \
+            samplequeue.h \
+            signalstats.h \
+            fft.h \
+            spectrogram.h \
+            capturefile.h \
             qcustomplot.h
 
 FORMS    += signalplotter.ui
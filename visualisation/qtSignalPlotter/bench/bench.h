@@ -0,0 +1,13 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <QElapsedTimer>
+
+// each benchmark returns 0 on success and prints its own report
+int benchRingData(int argc, char *argv[]);
+int benchDecimation(int argc, char *argv[]);
+int benchTraces(int argc, char *argv[]);
+int benchReplot(int argc, char *argv[]);
+int benchSpectrogram(int argc, char *argv[]);
+
+#endif // BENCH_H
@@ -0,0 +1,44 @@
+#-------------------------------------------------
+#
+# Benchmarks for SignalPlotter's data path and rendering.
+# Run headless with QT_QPA_PLATFORM=offscreen ./SignalPlotterBench <name>
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport
+
+TARGET = SignalPlotterBench
+TEMPLATE = app
+
+CONFIG += no_keywords c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QCUSTOMPLOT_USE_OPENGL
+greaterThan(QT_MAJOR_VERSION, 5): QT += opengl
+win32: LIBS += -lopengl32
+
+INCLUDEPATH += ..
+
+SOURCES += main.cpp \
+        bench_ringdata.cpp \
+        bench_decimation.cpp \
+        bench_traces.cpp \
+        bench_replot.cpp \
+        bench_spectrogram.cpp \
+        ../fft.cpp \
+        ../spectrogram.cpp \
+        ../ringdatacontainer.cpp \
+        ../minmaxpyramid.cpp \
+        ../decimatedgraph.cpp \
+        ../qcustomplot.cpp
+
+HEADERS  += bench.h \
+            ../ringdatacontainer.h \
+            ../minmaxpyramid.h \
+            ../decimatedgraph.h \
+            ../samplequeue.h \
+            ../fft.h \
+            ../spectrogram.h \
+            ../qcustomplot.h
@@ -0,0 +1,52 @@
+#include "bench.h"
+#include "decimatedgraph.h"
+#include "ringdatacontainer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#define RATE_HZ 10000
+#define PLOT_WIDTH 1200
+#define PLOT_HEIGHT 400
+
+// milliseconds per replot of one graph holding `seconds` of a noisy sine
+static double timeReplot(bool decimated, double seconds, int frames)
+{
+    QCustomPlot plot;
+    plot.resize(PLOT_WIDTH, PLOT_HEIGHT);
+    int count = int(seconds * RATE_HZ);
+    QSharedPointer<RingDataContainer> data(new RingDataContainer(count));
+    for (int i = 0; i < count; i++) {
+        double t = (double)i / RATE_HZ;
+        data->append(t, sin(t * 7) + (rand() % 1000) * 0.0005);
+    }
+    if (decimated)
+        (new DecimatedGraph(plot.xAxis, plot.yAxis))->setRingData(data);
+    else
+        (new QCPGraph(plot.xAxis, plot.yAxis))->setData(data);
+    plot.xAxis->setRange(0, seconds);
+    plot.yAxis->setRange(-1.5, 1.5);
+    plot.replot();
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < frames; i++)
+        plot.replot();
+    return timer.nsecsElapsed() * 1e-6 / frames;
+}
+
+int benchDecimation(int argc, char *argv[])
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 50;
+    const double windows[] = {1, 8, 60};
+
+    printf("%d Hz, %d px wide, mean of %d replots\n", RATE_HZ, PLOT_WIDTH, frames);
+    printf("  window   samples     QCPGraph   DecimatedGraph\n");
+    for (double seconds : windows) {
+        double stock = timeReplot(false, seconds, frames);
+        double pyramid = timeReplot(true, seconds, frames);
+        printf("  %4.0f s  %8d  %8.2f ms  %8.2f ms\n", seconds, int(seconds * RATE_HZ),
+               stock, pyramid);
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "bench.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Frame times for N graphs x M points, as a full replot (axes moved) and as a
+// replot of the buffered graph layer alone (the common SignalPlotter frame).
+// Headless: QT_QPA_PLATFORM=offscreen for raster; for GL under Mesa llvmpipe
+// use e.g. xvfb-run with LIBGL_ALWAYS_SOFTWARE=1 and pass "gl".
+static void report(const char *name, QVector<double> &ms)
+{
+    std::sort(ms.begin(), ms.end());
+    double sum = 0;
+    for (double m : ms)
+        sum += m;
+    printf("  %-12s mean %7.2f ms  p50 %7.2f ms  p99 %7.2f ms\n", name, sum / ms.size(),
+           ms[ms.size() / 2], ms[qMin(ms.size() - 1, int(ms.size() * 0.99))]);
+}
+
+int benchReplot(int argc, char *argv[])
+{
+    int graphs = argc > 1 ? atoi(argv[1]) : 16;
+    int points = argc > 2 ? atoi(argv[2]) : 10000;
+    bool gl = argc > 3 && strcmp(argv[3], "gl") == 0;
+    int frames = 100;
+
+    QCustomPlot plot;
+    plot.resize(1200, 400);
+    if (gl) {
+        plot.setOpenGl(true);
+        if (!plot.openGl())
+            printf("OpenGL unavailable, using raster\n");
+    }
+    plot.addLayer("traces", plot.layer("main"), QCustomPlot::limAbove);
+    QCPLayer *layer = plot.layer("traces");
+    layer->setMode(QCPLayer::lmBuffered);
+    plot.setCurrentLayer(layer);
+
+    for (int g = 0; g < graphs; g++) {
+        QVector<double> keys(points), values(points);
+        for (int i = 0; i < points; i++) {
+            keys[i] = i;
+            values[i] = sin(i * 0.01 + g) + g * 0.1;
+        }
+        QCPGraph *graph = plot.addGraph();
+        graph->setData(keys, values, true);
+        graph->setPen(QPen(QColor::fromHsvF(fmod(g * 0.1, 1.0), 1.0, 1.0)));
+    }
+    plot.xAxis->setRange(0, points);
+    plot.yAxis->setRange(-1.5, 1.5 + graphs * 0.1);
+    plot.replot();
+
+    printf("%d graphs x %d points, %s\n", graphs, points, plot.openGl() ? "OpenGL" : "raster");
+    QVector<double> full, layerOnly;
+    QElapsedTimer timer;
+    for (int f = 0; f < frames; f++) {
+        plot.xAxis->setRange(f % 2, points + f % 2);
+        timer.start();
+        plot.replot();
+        full << timer.nsecsElapsed() * 1e-6;
+    }
+    for (int f = 0; f < frames; f++) {
+        timer.start();
+        layer->replot();
+        layerOnly << timer.nsecsElapsed() * 1e-6;
+    }
+    report("full", full);
+    report("graph layer", layerOnly);
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "bench.h"
+#include "ringdatacontainer.h"
+#include <cstdio>
+#include <cstdlib>
+
+#define NUM_SIGNALS 64
+#define RATE_HZ 1000
+#define WINDOW_SEC 8
+#define FRAME_SEC (1.0 / 60)
+
+// interleave NUM_SIGNALS streams at RATE_HZ and look up the visible range once
+// per display frame, as the plotter does
+template <class Container, class Append>
+static double run(QVector<Container*> &graphs, double seconds, Append append)
+{
+    long samples = 0;
+    double nextFrame = 0, sink = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (long i = 0; i < (long)(seconds * RATE_HZ); i++) {
+        double t = (double)i / RATE_HZ;
+        for (int s = 0; s < NUM_SIGNALS; s++)
+            append(graphs[s], t, s + (i & 0xFF));
+        samples += NUM_SIGNALS;
+        if (t >= nextFrame) {
+            for (int s = 0; s < NUM_SIGNALS; s++)
+                sink += graphs[s]->findEnd(t) - graphs[s]->findBegin(t - WINDOW_SEC);
+            nextFrame += FRAME_SEC;
+        }
+    }
+    double ns = timer.nsecsElapsed();
+    if (sink < 0)
+        printf("unexpected range\n");
+    return ns / samples;
+}
+
+int benchRingData(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 60;
+    QVector<QCPGraphDataContainer*> vec;
+    QVector<RingDataContainer*> ring;
+    for (int s = 0; s < NUM_SIGNALS; s++) {
+        vec << new QCPGraphDataContainer;
+        ring << new RingDataContainer(RATE_HZ * WINDOW_SEC * 2);
+    }
+
+    double vecNs = run(vec, seconds, [](QCPGraphDataContainer *c, double t, double v) {
+        c->add(QCPGraphData(t, v));
+        c->removeBefore(t - WINDOW_SEC);
+    });
+    double ringNs = run(ring, seconds, [](RingDataContainer *c, double t, double v) {
+        c->append(t, v);
+        c->expireBefore(t - WINDOW_SEC);
+    });
+
+    printf("%d signals x %d Hz, %g s simulated, %d s window\n", NUM_SIGNALS, RATE_HZ,
+           seconds, WINDOW_SEC);
+    printf("  QCPGraphDataContainer add + removeBefore: %7.1f ns/sample (%5.1f%% of one core)\n",
+           vecNs, vecNs * NUM_SIGNALS * RATE_HZ * 1e-7);
+    printf("  RingDataContainer append + expireBefore:  %7.1f ns/sample (%5.1f%% of one core)\n",
+           ringNs, ringNs * NUM_SIGNALS * RATE_HZ * 1e-7);
+
+    qDeleteAll(vec);
+    qDeleteAll(ring);
+    return 0;
+}
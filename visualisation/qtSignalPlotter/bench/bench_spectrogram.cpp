@@ -0,0 +1,60 @@
+#include "bench.h"
+#include "spectrogram.h"
+#include <qcustomplot.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#define NUM_SIGNALS 16
+#define RATE_HZ 1000
+#define FFT_SIZE 1024
+#define HOP 256
+#define COLUMNS 256
+
+// 16 signals at 1 kHz through 1024-point spectrograms, reporting the share
+// of one core spent computing columns and copying them into QCPColorMaps
+int benchSpectrogram(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 60;
+    QVector<Spectrogram*> spectrograms;
+    QCustomPlot plot;
+    QVector<QCPColorMap*> maps;
+    for (int s = 0; s < NUM_SIGNALS; s++) {
+        spectrograms << new Spectrogram(FFT_SIZE, HOP, COLUMNS);
+        QCPColorMap *map = new QCPColorMap(plot.xAxis, plot.yAxis);
+        map->data()->setSize(COLUMNS, FFT_SIZE / 2 + 1);
+        maps << map;
+    }
+
+    QElapsedTimer timer;
+    qint64 pushNs = 0, copyNs = 0;
+    long columns = 0;
+    for (long i = 0; i < (long)(seconds * RATE_HZ); i++) {
+        double t = (double)i / RATE_HZ;
+        for (int s = 0; s < NUM_SIGNALS; s++) {
+            // tremor-like 4-12 Hz component plus broadband noise
+            double v = sin(2 * M_PI * (4 + s * 0.5) * t) + (rand() % 1000) * 0.001;
+            timer.start();
+            bool column = spectrograms[s]->push(t, v);
+            pushNs += timer.nsecsElapsed();
+            if (!column)
+                continue;
+            ++columns;
+            timer.start();
+            QCPColorMapData *data = maps[s]->data();
+            for (int x = 0; x < COLUMNS; x++) {
+                const float *c = spectrograms[s]->column(x);
+                for (int y = 0; y < FFT_SIZE / 2 + 1; y++)
+                    data->setCell(x, y, c[y]);
+            }
+            copyNs += timer.nsecsElapsed();
+        }
+    }
+
+    printf("%d signals x %d Hz, %d-point FFT, hop %d, %g s simulated, %ld columns\n",
+           NUM_SIGNALS, RATE_HZ, FFT_SIZE, HOP, seconds, columns);
+    printf("  window + FFT:         %6.3f%% of one core\n", pushNs * 1e-7 / seconds);
+    printf("  color map copy:       %6.3f%% of one core\n", copyNs * 1e-7 / seconds);
+    qDeleteAll(spectrograms);
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "bench.h"
+#include "decimatedgraph.h"
+#include "ringdatacontainer.h"
+#include "samplequeue.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#define NUM_SIGNALS 256
+#define NUM_INSTANCES 16
+#define NUM_ELEMENTS 3
+#define FRAME_HZ 60
+#define WINDOW_SEC 8
+#define CAPACITY 16384
+
+// the SignalPlotter frame loop for a full house of vector, multi-instance
+// signals: drain one queue per signal into per-trace containers, then replot
+int benchTraces(int argc, char *argv[])
+{
+    double rate = argc > 1 ? atof(argv[1]) : 100;
+    int frames = argc > 2 ? atoi(argv[2]) : 120;
+    int traces = NUM_SIGNALS * NUM_INSTANCES * NUM_ELEMENTS;
+
+    QCustomPlot plot;
+    plot.resize(1200, 400);
+    plot.yAxis->setRange(-1.5, 1.5);
+    QVector<SampleQueue*> queues;
+    QVector<RingDataContainer*> data;
+    for (int s = 0; s < NUM_SIGNALS; s++)
+        queues << new SampleQueue(8192);
+    for (int t = 0; t < traces; t++) {
+        DecimatedGraph *graph = new DecimatedGraph(plot.xAxis, plot.yAxis);
+        QSharedPointer<RingDataContainer> container(new RingDataContainer(CAPACITY));
+        graph->setRingData(container);
+        data << container.data();
+    }
+
+    double time = 0, step = 1.0 / rate, drainNs = 0, replotNs = 0;
+    QElapsedTimer timer;
+    for (int f = 0; f < frames; f++) {
+        // producer side, not timed: one frame's worth of updates per instance
+        double end = time + 1.0 / FRAME_HZ;
+        for (; time < end; time += step) {
+            for (int s = 0; s < NUM_SIGNALS; s++) {
+                for (int i = 0; i < NUM_INSTANCES * NUM_ELEMENTS; i++)
+                    queues[s]->push(time, sin(time * (i + 1)), i);
+            }
+        }
+
+        timer.start();
+        for (int s = 0; s < NUM_SIGNALS; s++) {
+            RingDataContainer **first = data.data() + s * NUM_INSTANCES * NUM_ELEMENTS;
+            queues[s]->drain([first](double key, double value, int index) {
+                first[index]->append(key, value);
+            });
+        }
+        for (RingDataContainer *d : data) {
+            if (!d->isEmpty())
+                d->expireBefore((d->constEnd() - 1)->key - WINDOW_SEC);
+        }
+        drainNs += timer.nsecsElapsed();
+
+        timer.start();
+        plot.xAxis->setRange(time, WINDOW_SEC, Qt::AlignRight);
+        plot.replot();
+        replotNs += timer.nsecsElapsed();
+    }
+
+    printf("%d signals x %d instances x %d elements = %d traces at %g Hz\n",
+           NUM_SIGNALS, NUM_INSTANCES, NUM_ELEMENTS, traces, rate);
+    printf("  drain + expire: %7.2f ms/frame\n", drainNs * 1e-6 / frames);
+    printf("  replot:         %7.2f ms/frame (budget %.1f ms)\n", replotNs * 1e-6 / frames,
+           1000.0 / FRAME_HZ);
+
+    qDeleteAll(queues);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include "bench.h"
+#include <QApplication>
+#include <cstdio>
+#include <cstring>
+
+struct Benchmark {
+    const char *name;
+    const char *description;
+    int (*run)(int argc, char *argv[]);
+};
+
+static const Benchmark benchmarks[] = {
+    {"ringdata", "graph data append + expiry, 64 signals at 1 kHz", benchRingData},
+    {"decimation", "replot cost against window length at 10 kHz", benchDecimation},
+    {"traces", "frame cost of 256 signals x 16 instances x 3 elements", benchTraces},
+    {"replot", "full vs buffered-layer replot of N graphs x M points [gl]", benchReplot},
+    {"spectrogram", "16 signals at 1 kHz through 1024-point spectrograms", benchSpectrogram},
+};
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+    int num = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    if (argc < 2) {
+        printf("usage: %s <benchmark> [args]\n", argv[0]);
+        for (int i = 0; i < num; i++)
+            printf("  %-12s %s\n", benchmarks[i].name, benchmarks[i].description);
+        return 1;
+    }
+    for (int i = 0; i < num; i++) {
+        if (strcmp(argv[1], benchmarks[i].name) == 0)
+            return benchmarks[i].run(argc - 1, argv + 1);
+    }
+    printf("unknown benchmark '%s'\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,160 @@
+#include "capturefile.h"
+#include <cstring>
+
+Q_STATIC_ASSERT(sizeof(CaptureHeader) == 64);
+Q_STATIC_ASSERT(sizeof(CaptureChunk) == 64);
+
+/********************************* CaptureWriter ************************************/
+
+CaptureWriter::CaptureWriter() :
+    mBase(0), mHeader(0), mChunk(0), mChunkHeader(0), mNextSignal(0)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+bool CaptureWriter::open(const QString &path)
+{
+    close();
+    mFile.setFileName(path);
+    if (!mFile.open(QIODevice::ReadWrite | QIODevice::Truncate))
+        return false;
+    if (!mFile.resize(CAPTURE_HEADER_BYTES) || !(mBase = mFile.map(0, CAPTURE_HEADER_BYTES))) {
+        mFile.close();
+        return false;
+    }
+    memset(mBase, 0, CAPTURE_HEADER_BYTES);
+    mHeader = (CaptureHeader*)mBase;
+    memcpy(mHeader->magic, CAPTURE_MAGIC, sizeof(mHeader->magic));
+    mHeader->version = CAPTURE_VERSION;
+    mHeader->chunkRows = CAPTURE_CHUNK_ROWS;
+    mHeader->chunkBytes = captureChunkBytes(CAPTURE_CHUNK_ROWS);
+    mNextSignal = 0;
+    return nextChunk();
+}
+
+void CaptureWriter::close()
+{
+    if (mChunk)
+        mFile.unmap(mChunk);
+    if (mBase)
+        mFile.unmap(mBase);
+    mChunk = mBase = 0;
+    mHeader = 0;
+    mChunkHeader = 0;
+    mFile.close();
+}
+
+int CaptureWriter::addSignal(const QString &name)
+{
+    if (!mHeader)
+        return -1;
+    QByteArray line = QByteArray::number(mNextSignal) + '\t' + name.toUtf8() + '\n';
+    qint64 offset = sizeof(CaptureHeader) + mHeader->signalBytes;
+    if (offset + line.size() > CAPTURE_HEADER_BYTES)
+        return -1;
+    memcpy(mBase + offset, line.constData(), line.size());
+    mHeader->signalBytes += line.size();
+    return mNextSignal++;
+}
+
+// grows the file by one chunk and moves the mapping there
+bool CaptureWriter::nextChunk()
+{
+    if (mChunk)
+        mFile.unmap(mChunk);
+    mChunk = 0;
+    qint64 bytes = mHeader->chunkBytes;
+    qint64 offset = CAPTURE_HEADER_BYTES + qint64(mHeader->chunks) * bytes;
+    if (!mFile.resize(offset + bytes) || !(mChunk = mFile.map(offset, bytes))) {
+        qInfo("capture stopped: could not grow %s", qPrintable(mFile.fileName()));
+        close();
+        return false;
+    }
+    int rows = mHeader->chunkRows;
+    mChunkHeader = (CaptureChunk*)mChunk;
+    memset(mChunkHeader, 0, sizeof(CaptureChunk));
+    mTimes = (double*)(mChunk + sizeof(CaptureChunk));
+    mValues = mTimes + rows;
+    mInstances = (quint64*)(mValues + rows);
+    mSignals = (quint32*)(mInstances + rows);
+    mElements = (quint16*)(mSignals + rows);
+    mHeader->chunks += 1;
+    return true;
+}
+
+void CaptureWriter::append(double time, int signal, quint64 instance, int element, double value)
+{
+    if (!mChunk || (mChunkHeader->rows == mHeader->chunkRows && !nextChunk()))
+        return;
+    quint32 row = mChunkHeader->rows;
+    mTimes[row] = time;
+    mValues[row] = value;
+    mInstances[row] = instance;
+    mSignals[row] = quint32(signal);
+    mElements[row] = quint16(element);
+    if (!row || time < mChunkHeader->minTime)
+        mChunkHeader->minTime = time;
+    if (!row || time > mChunkHeader->maxTime)
+        mChunkHeader->maxTime = time;
+    // publish the row last, so a reader never sees it half written
+    captureRows(mChunkHeader)->store(row + 1, std::memory_order_release);
+}
+
+/********************************* CaptureReader ************************************/
+
+CaptureReader::CaptureReader() :
+    mBase(0), mHeader(0), mChunks(0)
+{
+}
+
+CaptureReader::~CaptureReader()
+{
+    close();
+}
+
+bool CaptureReader::open(const QString &path)
+{
+    close();
+    mFile.setFileName(path);
+    if (!mFile.open(QIODevice::ReadOnly) || mFile.size() < CAPTURE_HEADER_BYTES)
+        return false;
+    uchar *base = mFile.map(0, mFile.size());
+    const CaptureHeader *header = (const CaptureHeader*)base;
+    if (!base || memcmp(header->magic, CAPTURE_MAGIC, sizeof(header->magic)) != 0
+        || header->version != CAPTURE_VERSION
+        || header->chunkBytes != quint64(captureChunkBytes(header->chunkRows))) {
+        if (base)
+            mFile.unmap(base);
+        mFile.close();
+        return false;
+    }
+    mBase = base;
+    mHeader = header;
+    // only chunks that are entirely inside the mapping
+    mChunks = qMin(qint64(header->chunks),
+                   (mFile.size() - CAPTURE_HEADER_BYTES) / qint64(header->chunkBytes));
+
+    QByteArray table((const char*)mBase + sizeof(CaptureHeader),
+                     int(qMin(header->signalBytes, quint64(CAPTURE_HEADER_BYTES - sizeof(CaptureHeader)))));
+    for (const QByteArray &line : table.split('\n')) {
+        int tab = line.indexOf('\t');
+        if (tab > 0)
+            mNames << QString::fromUtf8(line.mid(tab + 1));
+    }
+    return true;
+}
+
+void CaptureReader::close()
+{
+    if (mBase)
+        mFile.unmap((uchar*)mBase);
+    mBase = 0;
+    mHeader = 0;
+    mChunks = 0;
+    mNames.clear();
+    mFile.close();
+}
@@ -0,0 +1,142 @@
+#ifndef CAPTUREFILE_H
+#define CAPTUREFILE_H
+
+#include <QFile>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+
+// Memory-mapped capture of every sample SignalPlotter receives.
+//
+// Layout (little endian):
+//   [0, HEADER_BYTES)  CaptureHeader, then the signal table: one
+//                      "<id>\t<name>\n" line per signal, zero padded
+//   then fixed-size chunks of chunkBytes, each a CaptureChunk header
+//   followed by the columns of up to chunkRows rows, one row per element:
+//     time     f64[chunkRows]
+//     value    f64[chunkRows]
+//     instance u64[chunkRows]   libmapper instance id
+//     signal   u32[chunkRows]
+//     element  u16[chunkRows]
+// Chunk i starts at HEADER_BYTES + i * chunkBytes, and its header holds its
+// row count and time span, so the chunk headers double as the time index.
+// Everything is written in place through the mapping, so a capture cut off
+// by a crash is still readable up to its last row. The row count is stored
+// with release ordering after the row, so a reader that loads it with
+// acquire ordering never sees a row before its columns. See read_capture.py.
+
+#define CAPTURE_MAGIC "SPCAP001"
+#define CAPTURE_VERSION 2
+#define CAPTURE_HEADER_BYTES 65536
+#define CAPTURE_CHUNK_ROWS 65536
+
+struct CaptureHeader {
+    char magic[8];
+    quint32 version;
+    quint32 chunkRows;
+    quint64 chunkBytes;
+    quint64 chunks;       // chunks allocated so far
+    quint64 signalBytes;  // length of the signal table
+    char reserved[24];
+};
+
+struct CaptureChunk {
+    quint32 rows;
+    quint32 reserved0;
+    double minTime, maxTime;
+    char reserved[40];
+};
+
+class CaptureWriter
+{
+public:
+    CaptureWriter();
+    ~CaptureWriter();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return mHeader != 0; }
+
+    // returns the id to pass to append(), or -1 if the table is full
+    int addSignal(const QString &name);
+    void append(double time, int signal, quint64 instance, int element, double value);
+
+private:
+    bool nextChunk();
+
+    QFile mFile;
+    uchar *mBase;          // mapped header and signal table
+    CaptureHeader *mHeader;
+    uchar *mChunk;         // mapped current chunk
+    CaptureChunk *mChunkHeader;
+    double *mTimes, *mValues;
+    quint64 *mInstances;
+    quint32 *mSignals;
+    quint16 *mElements;
+    int mNextSignal;
+};
+
+class CaptureReader
+{
+public:
+    CaptureReader();
+    ~CaptureReader();
+
+    // maps the file as it is now; rows written later need a reopen
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return mHeader != 0; }
+
+    QStringList signalNames() const { return mNames; }
+
+    // f(signal, instance, element, time, value) for every row with a time in
+    // [from, to], in file order, until f returns false; chunks outside the
+    // range are skipped on their headers alone, so they are never paged in
+    template <class F>
+    void scan(double from, double to, F f) const;
+
+private:
+    QFile mFile;
+    const uchar *mBase;
+    const CaptureHeader *mHeader;
+    qint64 mChunks;
+    QStringList mNames;
+};
+
+// the row count of a chunk, shared with the thread or process writing it
+static inline std::atomic<quint32> *captureRows(const CaptureChunk *chunk)
+{
+    Q_STATIC_ASSERT(sizeof(std::atomic<quint32>) == sizeof(quint32));
+    return reinterpret_cast<std::atomic<quint32>*>(const_cast<quint32*>(&chunk->rows));
+}
+
+static inline qint64 captureChunkBytes(int rows)
+{
+    qint64 bytes = sizeof(CaptureChunk) + qint64(rows) * 30;
+    return (bytes + CAPTURE_HEADER_BYTES - 1) / CAPTURE_HEADER_BYTES * CAPTURE_HEADER_BYTES;
+}
+
+template <class F>
+void CaptureReader::scan(double from, double to, F f) const
+{
+    int rows = mHeader->chunkRows;
+    for (qint64 c = 0; c < mChunks; c++) {
+        const uchar *chunk = mBase + CAPTURE_HEADER_BYTES + c * mHeader->chunkBytes;
+        const CaptureChunk *header = (const CaptureChunk*)chunk;
+        quint32 used = captureRows(header)->load(std::memory_order_acquire);
+        if (!used || header->maxTime < from || header->minTime > to)
+            continue;
+        const double *times = (const double*)(chunk + sizeof(CaptureChunk));
+        const double *values = times + rows;
+        const quint64 *instances = (const quint64*)(values + rows);
+        const quint32 *sigs = (const quint32*)(instances + rows);
+        const quint16 *elements = (const quint16*)(sigs + rows);
+        for (quint32 i = 0; i < used; i++) {
+            if (times[i] >= from && times[i] <= to
+                && !f(int(sigs[i]), instances[i], int(elements[i]), times[i], values[i]))
+                return;
+        }
+    }
+}
+
+#endif // CAPTUREFILE_H
@@ -0,0 +1,68 @@
+#include "decimatedgraph.h"
+#include "ringdatacontainer.h"
+
+DecimatedGraph::DecimatedGraph(QCPAxis *keyAxis, QCPAxis *valueAxis) :
+    QCPGraph(keyAxis, valueAxis),
+    mRing(0)
+{
+}
+
+void DecimatedGraph::setRingData(const QSharedPointer<RingDataContainer> &data)
+{
+    setData(data);
+    mRing = data.data();
+}
+
+static bool keyLessThan(const QCPGraphData &data, double key)
+{
+    return data.key < key;
+}
+
+void DecimatedGraph::getOptimizedLineData(QVector<QCPGraphData> *lineData,
+                                          const QCPGraphDataContainer::const_iterator &begin,
+                                          const QCPGraphDataContainer::const_iterator &end) const
+{
+    const RingDataContainer *ring = mRing && mDataContainer.data() == mRing ? mRing : 0;
+    QCPAxis *keyAxis = mKeyAxis.data();
+    if (!lineData || !ring || !keyAxis || !mAdaptiveSampling || begin == end) {
+        QCPGraph::getOptimizedLineData(lineData, begin, end);
+        return;
+    }
+
+    // below two points per pixel the one-to-one copy is already cheap
+    double keyPixelSpan = qAbs(keyAxis->coordToPixel(begin->key) - keyAxis->coordToPixel((end - 1)->key));
+    if (end - begin < 2 * keyPixelSpan + 2) {
+        QCPGraph::getOptimizedLineData(lineData, begin, end);
+        return;
+    }
+
+    int reversedFactor = keyAxis->pixelOrientation();
+    int reversedRound = reversedFactor == -1 ? 1 : 0;
+    lineData->reserve(int(4 * keyPixelSpan) + 4);
+
+    // one step per occupied pixel column: binary search for its last sample,
+    // then ask the pyramid for the extrema in between
+    QCPGraphDataContainer::const_iterator it = begin;
+    int offset = int(begin - ring->constBegin());
+    while (it != end) {
+        double intervalStartKey = keyAxis->pixelToCoord(int(keyAxis->coordToPixel(it->key) + reversedRound));
+        double keyEpsilon = qAbs(intervalStartKey - keyAxis->pixelToCoord(keyAxis->coordToPixel(intervalStartKey) + 1.0 * reversedFactor));
+        QCPGraphDataContainer::const_iterator next = std::lower_bound(it + 1, end, intervalStartKey + keyEpsilon, keyLessThan);
+        int count = int(next - it);
+
+        if (count == 1) {
+            lineData->append(*it);
+        } else {
+            double minValue, maxValue;
+            ring->minMax(offset, offset + count, minValue, maxValue);
+            // same layout as QCPGraph: entry, extrema, exit, so the trace
+            // connects to the neighbouring columns at real sample values
+            lineData->append(QCPGraphData(intervalStartKey + keyEpsilon * 0.2, it->value));
+            lineData->append(QCPGraphData(intervalStartKey + keyEpsilon * 0.25, minValue));
+            lineData->append(QCPGraphData(intervalStartKey + keyEpsilon * 0.75, maxValue));
+            lineData->append(QCPGraphData(intervalStartKey + keyEpsilon * 0.8, (next - 1)->value));
+        }
+        offset += count;
+        it = next;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef DECIMATEDGRAPH_H
+#define DECIMATEDGRAPH_H
+
+#include <qcustomplot.h>
+
+class RingDataContainer;
+
+// QCPGraph whose adaptive sampling reads per-pixel extrema from the min/max
+// pyramid of a RingDataContainer instead of scanning every visible sample,
+// so the cost of a replot follows the plot width rather than the sample rate.
+// Falls back to the stock algorithm for any other data container.
+class DecimatedGraph : public QCPGraph
+{
+    Q_OBJECT
+
+public:
+    explicit DecimatedGraph(QCPAxis *keyAxis, QCPAxis *valueAxis);
+
+    // plots data through its pyramid; a container given to QCPGraph::setData()
+    // instead is plotted by the stock algorithm until this is called again
+    void setRingData(const QSharedPointer<RingDataContainer> &data);
+
+protected:
+    virtual void getOptimizedLineData(QVector<QCPGraphData> *lineData,
+                                      const QCPGraphDataContainer::const_iterator &begin,
+                                      const QCPGraphDataContainer::const_iterator &end) const Q_DECL_OVERRIDE;
+
+private:
+    // QCPGraphDataContainer has no virtual functions to dynamic_cast through,
+    // so the ring is remembered here and matched against mDataContainer
+    const RingDataContainer *mRing;
+};
+
+#endif // DECIMATEDGRAPH_H
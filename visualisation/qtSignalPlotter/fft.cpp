@@ -0,0 +1,68 @@
+#include "fft.h"
+#include <cmath>
+
+FftPlan::FftPlan(int size)
+{
+    mSize = 4;
+    while (mSize < size)
+        mSize <<= 1;
+    int half = mSize / 2;
+
+    mTwiddle.resize(half);
+    for (int k = 0; k < half; k++)
+        mTwiddle[k] = std::polar(1.f, float(-2 * M_PI * k / mSize));
+
+    int bits = 0;
+    while ((1 << bits) < half)
+        ++bits;
+    mReverse.resize(half);
+    for (int i = 0; i < half; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        mReverse[i] = r;
+    }
+    mWork.resize(half);
+}
+
+// in-place iterative transform of length size() / 2; the twiddles of the
+// full-size table are reused with a stride
+void FftPlan::transform(std::complex<float> *data) const
+{
+    int n = mSize / 2;
+    for (int i = 0; i < n; i++) {
+        int r = mReverse[i];
+        if (r > i)
+            std::swap(data[i], data[r]);
+    }
+    const std::complex<float> *twiddle = mTwiddle.constData();
+    for (int len = 2; len <= n; len <<= 1) {
+        int half = len / 2, stride = mSize / len;
+        for (int start = 0; start < n; start += len) {
+            for (int k = 0; k < half; k++) {
+                std::complex<float> t = twiddle[k * stride] * data[start + k + half];
+                data[start + k + half] = data[start + k] - t;
+                data[start + k] += t;
+            }
+        }
+    }
+}
+
+void FftPlan::forward(const float *in, std::complex<float> *out)
+{
+    int half = mSize / 2;
+    std::complex<float> *z = mWork.data();
+    // pack even samples as real and odd samples as imaginary parts
+    for (int k = 0; k < half; k++)
+        z[k] = std::complex<float>(in[2 * k], in[2 * k + 1]);
+    transform(z);
+
+    // split into the spectra of the even and odd samples and recombine
+    const std::complex<float> i(0, 1);
+    for (int k = 0; k <= half; k++) {
+        std::complex<float> a = z[k % half], b = std::conj(z[(half - k) % half]);
+        std::complex<float> even = (a + b) * 0.5f, odd = (a - b) * (-0.5f * i);
+        std::complex<float> w = k < half ? mTwiddle[k] : std::complex<float>(-1, 0);
+        out[k] = even + w * odd;
+    }
+}
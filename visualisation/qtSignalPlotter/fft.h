@@ -0,0 +1,30 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <QVector>
+#include <complex>
+
+// Radix-2 FFT of real input, computed as a half-length complex transform.
+// The twiddle factors and bit-reversal table are built once per size, so a
+// plan can be reused for every frame without allocating.
+class FftPlan
+{
+public:
+    explicit FftPlan(int size);
+
+    int size() const { return mSize; }
+    int bins() const { return mSize / 2 + 1; }
+
+    // in: size() real samples; out: bins() complex coefficients
+    void forward(const float *in, std::complex<float> *out);
+
+private:
+    void transform(std::complex<float> *data) const;
+
+    int mSize;
+    QVector<int> mReverse;                   // bit reversal of the half-size transform
+    QVector<std::complex<float> > mTwiddle;  // e^(-2 pi i k / size), k < size / 2
+    QVector<std::complex<float> > mWork;
+};
+
+#endif // FFT_H
@@ -1,10 +1,49 @@
 #include "signalplotter.h"
 #include <QApplication>
+#include <QCommandLineParser>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption hysteresisOption("hysteresis",
+        "Relative shrink of the data range needed before the value axis follows (0 to disable).",
+        "fraction", QString::number(AUTOSCALE_HYSTERESIS));
+    parser.addOption(hysteresisOption);
+    QCommandLineOption scrollStepOption("scroll-step",
+        "Time axis scroll increment in seconds (0 for smooth scrolling, which redraws the axes every frame).",
+        "seconds", QString::number(SCROLL_STEP_SEC));
+    parser.addOption(scrollStepOption);
+    QCommandLineOption openGlOption("opengl",
+        "Render with OpenGL, falling back to raster if it is unavailable.");
+    parser.addOption(openGlOption);
+    QCommandLineOption statsOption("stats", "Show the per-signal statistics overlay.");
+    parser.addOption(statsOption);
+    QCommandLineOption statsLogOption("stats-log",
+        "Append per-signal statistics to a CSV file once a second.", "file");
+    parser.addOption(statsLogOption);
+    QCommandLineOption spectrogramOption("spectrogram", "Show the spectrogram panels.");
+    parser.addOption(spectrogramOption);
+    QCommandLineOption captureOption("capture",
+        "Record every received sample to a memory-mapped capture file, browsable while paused.", "file");
+    parser.addOption(captureOption);
+    parser.process(a);
+
     SignalPlotter w;
+    w.setAutoscaleHysteresis(parser.value(hysteresisOption).toDouble());
+    w.setScrollStep(parser.value(scrollStepOption).toDouble());
+    if (parser.isSet(openGlOption))
+        w.setOpenGl(true);
+    if (parser.isSet(statsOption))
+        w.setStatsVisible(true);
+    if (parser.isSet(spectrogramOption))
+        w.setSpectrogramsVisible(true);
+    if (parser.isSet(statsLogOption))
+        w.setStatsLog(parser.value(statsLogOption));
+    if (parser.isSet(captureOption))
+        w.setCapture(parser.value(captureOption));
     w.show();
 
     return a.exec();
@@ -0,0 +1,53 @@
+#include "minmaxpyramid.h"
+
+#define INITIAL_BLOCKS 4
+
+MinMaxPyramid::MinMaxPyramid(int capacity)
+{
+    // the top level spans at most a handful of blocks of a full window
+    for (qint64 size = Factor; size <= capacity; size <<= Shift) {
+        Level level;
+        level.blocks.resize(INITIAL_BLOCKS);
+        level.last = -1;
+        mLevels << level;
+    }
+}
+
+void MinMaxPyramid::append(qint64 index, double value, qint64 first)
+{
+    for (int i = 0; i < mLevels.size(); i++) {
+        Level &level = mLevels[i];
+        int shift = Shift * (i + 1);
+        qint64 block = index >> shift;
+        if (block != level.last) {
+            // make room for every block from the oldest live one to this one
+            qint64 needed = block - (first >> shift) + 1;
+            if (needed > level.blocks.size())
+                grow(level, first >> shift, int(qMax(needed, qint64(level.blocks.size()) * 2)));
+            Block &b = level.blocks[int(block % level.blocks.size())];
+            b.min = b.max = value;
+            level.last = block;
+            continue;
+        }
+        Block &b = level.blocks[int(block % level.blocks.size())];
+        if (value < b.min)
+            b.min = value;
+        else if (value > b.max)
+            b.max = value;
+    }
+}
+
+void MinMaxPyramid::reset()
+{
+    for (int i = 0; i < mLevels.size(); i++)
+        mLevels[i].last = -1;
+}
+
+// re-lay the live blocks [first, last] out for the new modulus
+void MinMaxPyramid::grow(Level &level, qint64 first, int size)
+{
+    QVector<Block> blocks(size);
+    for (qint64 b = first; b <= level.last; b++)
+        blocks[int(b % size)] = level.blocks[int(b % level.blocks.size())];
+    level.blocks.swap(blocks);
+}
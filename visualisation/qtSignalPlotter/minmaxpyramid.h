@@ -0,0 +1,83 @@
+#ifndef MINMAXPYRAMID_H
+#define MINMAXPYRAMID_H
+
+#include <QVector>
+
+// Multi-resolution min/max summary of a stream of samples.
+// Level L holds the extrema of consecutive blocks of 8^L samples, addressed
+// by absolute sample index so expiring old samples costs nothing, and grows
+// with the number of live samples. Appending is amortized O(levels); a range
+// query touches at most 2*7 entries per level plus the
+// top level, independent of how many samples the range covers.
+class MinMaxPyramid
+{
+public:
+    explicit MinMaxPyramid(int capacity);
+
+    // index must increase by one per call, except after reset(); first is
+    // the oldest index that will still be queried
+    void append(qint64 index, double value, qint64 first);
+    void reset();
+
+    // extrema over absolute indices [begin, end); raw(i) returns sample i
+    // and is only called for the unaligned ends of the range
+    template <class Raw>
+    void minMax(qint64 begin, qint64 end, Raw raw, double &min, double &max) const;
+
+private:
+    enum { Shift = 3, Factor = 1 << Shift };
+
+    struct Block {
+        double min, max;
+    };
+    struct Level {
+        QVector<Block> blocks; // circular, indexed by absolute block number
+        qint64 last;           // most recent block written
+    };
+
+    void grow(Level &level, qint64 first, int size);
+
+    // fold sample or block i of the given level into min/max
+    template <class Raw>
+    void take(double &min, double &max, int level, qint64 i, Raw &raw) const
+    {
+        if (!level) {
+            double v = raw(i);
+            min = v < min ? v : min;
+            max = v > max ? v : max;
+            return;
+        }
+        const QVector<Block> &blocks = mLevels[level - 1].blocks;
+        const Block &b = blocks[int(i % blocks.size())];
+        min = b.min < min ? b.min : min;
+        max = b.max > max ? b.max : max;
+    }
+
+    QVector<Level> mLevels;
+};
+
+template <class Raw>
+void MinMaxPyramid::minMax(qint64 begin, qint64 end, Raw raw, double &min, double &max) const
+{
+    min = raw(begin);
+    max = min;
+    int level = 0, top = mLevels.size();
+    // consume unaligned entries at both ends, then climb a level with the
+    // remaining (fully covered) blocks
+    while (begin < end) {
+        if (level == top) {
+            for (; begin < end; begin++)
+                take(min, max, level, begin, raw);
+            break;
+        }
+        for (; begin < end && (begin & (Factor - 1)); begin++)
+            take(min, max, level, begin, raw);
+        for (; begin < end && (end & (Factor - 1)); end--)
+            take(min, max, level, end - 1, raw);
+        begin >>= Shift;
+        end >>= Shift;
+        ++level;
+    }
+}
+
+#endif // MINMAXPYRAMID_H
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+# Read a SignalPlotter capture file (see capturefile.h) without copying it:
+# every column returned is a numpy view straight onto the memory-mapped file.
+#
+#   import read_capture
+#   cap = read_capture.Capture('session.spcap')
+#   t, v = cap.signal('device.1/accel', element=0)
+#
+# or from the shell, to list what was captured:
+#
+#   python3 read_capture.py session.spcap
+
+import sys
+import numpy as np
+
+MAGIC = b'SPCAP001'
+VERSION = 2
+HEADER_BYTES = 65536
+
+header_dtype = np.dtype([('magic', 'S8'), ('version', '<u4'), ('chunk_rows', '<u4'),
+                         ('chunk_bytes', '<u8'), ('chunks', '<u8'), ('signal_bytes', '<u8'),
+                         ('reserved', 'V24')])
+chunk_dtype = np.dtype([('rows', '<u4'), ('reserved0', '<u4'), ('min_time', '<f8'),
+                        ('max_time', '<f8'), ('reserved', 'V40')])
+
+class Capture:
+    def __init__(self, path):
+        self.map = np.memmap(path, dtype=np.uint8, mode='r')
+        header = self.map[:header_dtype.itemsize].view(header_dtype)[0]
+        if header['magic'] != MAGIC or header['version'] != VERSION:
+            raise ValueError(path + ' is not a SignalPlotter capture')
+        self.chunk_rows = int(header['chunk_rows'])
+        self.chunk_bytes = int(header['chunk_bytes'])
+        # a capture that is still being written may have a chunk allocated
+        # but not yet on disk
+        self.num_chunks = min(int(header['chunks']),
+                              (len(self.map) - HEADER_BYTES) // self.chunk_bytes)
+
+        table = bytes(self.map[header_dtype.itemsize:header_dtype.itemsize + int(header['signal_bytes'])])
+        self.names = {}
+        for line in table.decode('utf-8').splitlines():
+            id, name = line.split('\t', 1)
+            self.names[int(id)] = name
+
+    def chunk(self, i):
+        """The chunk header and its columns, as views of the used rows only."""
+        start = HEADER_BYTES + i * self.chunk_bytes
+        header = self.map[start:start + chunk_dtype.itemsize].view(chunk_dtype)[0]
+        rows, r = int(header['rows']), self.chunk_rows
+        base = start + chunk_dtype.itemsize
+        def column(offset, dtype):
+            return self.map[base + offset * r:base + offset * r + rows * np.dtype(dtype).itemsize].view(dtype)
+        return header, {'time': column(0, '<f8'), 'value': column(8, '<f8'),
+                        'instance': column(16, '<u8'), 'signal': column(24, '<u4'),
+                        'element': column(28, '<u2')}
+
+    def chunks(self, start=-np.inf, end=np.inf):
+        """Columns of every chunk overlapping [start, end], judged by the chunk headers."""
+        for i in range(self.num_chunks):
+            header, columns = self.chunk(i)
+            if header['rows'] and header['max_time'] >= start and header['min_time'] <= end:
+                yield columns
+
+    def instances(self, name):
+        """The libmapper instance ids captured for a signal, in order of appearance."""
+        ids = [id for id, n in self.names.items() if n == name]
+        found = [c['instance'][np.isin(c['signal'], ids)] for c in self.chunks()]
+        if not found:
+            return []
+        found = np.concatenate(found)
+        _, first = np.unique(found, return_index=True)
+        return [int(found[i]) for i in sorted(first)]
+
+    def signal(self, name, element=0, instance=None, start=-np.inf, end=np.inf):
+        """Times and values of one element of one instance id, or of every
+        instance if none is given, sorted by time. Selecting rows copies them;
+        use chunks() to work on the views directly."""
+        ids = [id for id, n in self.names.items() if n == name]
+        times, values = [], []
+        for c in self.chunks(start, end):
+            sel = (np.isin(c['signal'], ids) & (c['element'] == element)
+                   & (c['time'] >= start) & (c['time'] <= end))
+            if instance is not None:
+                sel &= c['instance'] == instance
+            times.append(c['time'][sel])
+            values.append(c['value'][sel])
+        if not times:
+            return np.empty(0), np.empty(0)
+        t, v = np.concatenate(times), np.concatenate(values)
+        order = np.argsort(t, kind='stable')
+        return t[order], v[order]
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print('usage: read_capture.py <capture file>')
+        sys.exit(1)
+    cap = Capture(sys.argv[1])
+    rows = 0
+    span = [np.inf, -np.inf]
+    for i in range(cap.num_chunks):
+        header, _ = cap.chunk(i)
+        if header['rows']:
+            rows += int(header['rows'])
+            span = [min(span[0], header['min_time']), max(span[1], header['max_time'])]
+    print('%d rows in %d chunks' % (rows, cap.num_chunks))
+    if rows:
+        print('from %.3f to %.3f (%.1f s)' % (span[0], span[1], span[1] - span[0]))
+    for id, name in sorted(cap.names.items()):
+        print('%4d  %s' % (id, name))
@@ -0,0 +1,93 @@
+#include "ringdatacontainer.h"
+
+RingDataContainer::RingDataContainer(int capacity) :
+    mCapacity(qMax(capacity, 1)),
+    mBaseIndex(0),
+    mPyramid(mCapacity)
+{
+    // squeezing would reallocate on every expiry; compact() does the job
+    setAutoSqueeze(false);
+}
+
+void RingDataContainer::append(double key, double value)
+{
+    if (!isEmpty() && key < (constEnd() - 1)->key) {
+        // late sample: rare, so a sorted insert is acceptable; anything older
+        // than the window has already expired
+        if (key >= constBegin()->key) {
+            add(QCPGraphData(key, value));
+            if (size() > mCapacity) {
+                ++mPreallocSize;
+                ++mBaseIndex;
+            }
+            rebuildPyramid();
+        }
+        return;
+    }
+    if (size() >= mCapacity) {
+        ++mPreallocSize;
+        ++mBaseIndex;
+    }
+    // recycle the expired prefix rather than growing, once it outweighs the
+    // live samples that have to be moved
+    if (mData.size() == mData.capacity() && mPreallocSize >= size())
+        compact();
+    mPyramid.append(mBaseIndex + size(), value, mBaseIndex);
+    mData.append(QCPGraphData(key, value));
+}
+
+void RingDataContainer::expireBefore(double key)
+{
+    const QCPGraphData *data = mData.constData();
+    int end = mData.size(), start = mPreallocSize;
+    while (mPreallocSize < end && data[mPreallocSize].key < key)
+        ++mPreallocSize;
+    mBaseIndex += mPreallocSize - start;
+    if (mPreallocSize == end) {
+        // empty: rewind for free instead of compacting later
+        mData.resize(0);
+        mPreallocSize = 0;
+    }
+}
+
+void RingDataContainer::reset()
+{
+    mBaseIndex += size();
+    mData.resize(0);
+    mPreallocSize = 0;
+}
+
+void RingDataContainer::compact()
+{
+    int live = size();
+    std::copy(mData.begin() + mPreallocSize, mData.end(), mData.begin());
+    mData.resize(live);
+    mPreallocSize = 0;
+}
+
+void RingDataContainer::minMax(int begin, int end, double &min, double &max) const
+{
+    const QCPGraphData *data = mData.constData() + mPreallocSize;
+    qint64 base = mBaseIndex;
+    mPyramid.minMax(base + begin, base + end, [data, base](qint64 i) {
+        return data[i - base].value;
+    }, min, max);
+}
+
+QCPRange RingDataContainer::valueExtent(bool &foundRange) const
+{
+    QCPRange range;
+    foundRange = !isEmpty();
+    if (foundRange)
+        minMax(0, size(), range.lower, range.upper);
+    return range;
+}
+
+// sample positions shifted, so the block boundaries no longer line up
+void RingDataContainer::rebuildPyramid()
+{
+    mPyramid.reset();
+    const QCPGraphData *data = mData.constData() + mPreallocSize;
+    for (int i = 0; i < size(); i++)
+        mPyramid.append(mBaseIndex + i, data[i].value, mBaseIndex);
+}
@@ -0,0 +1,42 @@
+#ifndef RINGDATACONTAINER_H
+#define RINGDATACONTAINER_H
+
+#include <qcustomplot.h>
+
+#include "minmaxpyramid.h"
+
+// Fixed-capacity streaming store for a QCPGraph.
+// Samples stay in the single contiguous QVector of QCPDataContainer, so the
+// inherited lookups (findBegin/findEnd, keyRange, valueRange) work unchanged.
+// Expiry only advances the start offset, and the live window is copied back
+// to the front once the buffer is full and mostly expired. Append and expiry
+// are therefore amortized O(1), and storage only grows while the window does,
+// so idle or slow traces stay small.
+class RingDataContainer : public QCPGraphDataContainer
+{
+public:
+    explicit RingDataContainer(int capacity);
+
+    int capacity() const { return mCapacity; }
+
+    // once full, the oldest sample is dropped for each new one
+    void append(double key, double value);
+    void expireBefore(double key);
+    // drop everything, keeping the allocation for reuse
+    void reset();
+
+    // value extrema over container indices [begin, end), in O(log) time
+    void minMax(int begin, int end, double &min, double &max) const;
+    // extrema over every live sample, the cheap equivalent of valueRange()
+    QCPRange valueExtent(bool &foundRange) const;
+
+private:
+    void compact();
+    void rebuildPyramid();
+
+    int mCapacity;
+    qint64 mBaseIndex; // stream position of the first live sample
+    MinMaxPyramid mPyramid;
+};
+
+#endif // RINGDATACONTAINER_H
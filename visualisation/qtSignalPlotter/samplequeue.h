@@ -0,0 +1,80 @@
+#ifndef SAMPLEQUEUE_H
+#define SAMPLEQUEUE_H
+
+#include <QVector>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer queue of (time, value, trace)
+// samples, where trace tells the consumer which element/instance it belongs to.
+// The mapper thread pushes from its signal handlers and the GUI thread drains
+// once per frame. A full queue drops the new sample and counts it rather than
+// blocking the network thread.
+class SampleQueue
+{
+public:
+    explicit SampleQueue(int capacity)
+    {
+        int size = 1;
+        while (size < capacity)
+            size <<= 1;
+        mBuffer.resize(size);
+        mMask = size - 1;
+        mHead = mTail = 0;
+        mDropped = 0;
+    }
+
+    // producer side
+    bool push(double key, double value, int trace)
+    {
+        quint64 head = mHead.load(std::memory_order_relaxed);
+        if (head - mTail.load(std::memory_order_acquire) > quint64(mMask)) {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Sample &s = mBuffer[int(head & mMask)];
+        s.key = key;
+        s.value = value;
+        s.trace = trace;
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side: hand every queued sample to f(key, value, trace) in order
+    template <class F>
+    int drain(F f)
+    {
+        quint64 tail = mTail.load(std::memory_order_relaxed);
+        quint64 head = mHead.load(std::memory_order_acquire);
+        const Sample *buffer = mBuffer.constData();
+        for (quint64 i = tail; i != head; i++) {
+            const Sample &s = buffer[int(i & mMask)];
+            f(s.key, s.value, s.trace);
+        }
+        mTail.store(head, std::memory_order_release);
+        return int(head - tail);
+    }
+
+    int depth() const
+    {
+        return int(mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire));
+    }
+    quint64 dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Sample {
+        double key, value;
+        int trace;
+    };
+
+    QVector<Sample> mBuffer;
+    int mMask;
+    // keep the indices on separate cache lines so the threads don't contend
+    char mPad0[64];
+    std::atomic<quint64> mHead;
+    char mPad1[64];
+    std::atomic<quint64> mTail;
+    char mPad2[64];
+    std::atomic<quint64> mDropped;
+};
+
+#endif // SAMPLEQUEUE_H
@@ -1,20 +1,91 @@
 #include "signalplotter.h"
 #include "ui_signalplotter.h"
 #include <QDebug>
+#include <QDockWidget>
+#include <QFileDialog>
+#include <QFontDatabase>
+#include <QHash>
+#include <QScreen>
+#include <cmath>
+#include <ctime>
 
 using namespace mapper;
+
+// queue one sample per plotted element of an instance with a slot (slot >= 0),
+// gathering the value statistics on the way; every element of every instance
+// is captured, plotted or not
+template <class T>
+static void pushElements(SignalPlot *s, double time, const T *v, int len, int slot, Id inst,
+                         double &min, double &max, double &sum)
+{
+    if (slot >= 0) {
+        int n = qMin(len, s->elements), first = slot * s->elements;
+        quint32 releases = s->releases[slot].load(std::memory_order_relaxed);
+        for (int i = 0; i < n; i++) {
+            double d = v[i];
+            s->queue.push(time, d, SignalPlot::tag(first + i, releases));
+            min = d < min ? d : min;
+            max = d > max ? d : max;
+            sum += d;
+        }
+    }
+    if (s->capture) {
+        for (int i = 0; i < len; i++)
+            s->capture->append(time, s->captureId, inst, i, v[i]);
+    }
+}
+
 void signalHandler(Signal&& sig, Signal::Event evt, Id inst, int len, Type type,
                    const void* value, Time&& time)
 {
     SignalPlot* s = (SignalPlot*)(void*)sig["plot"];
+    if (!s)
+        return;
+
+    if (evt == Signal::Event::REL_UPSTRM) {
+        // samples queued from here on carry the new count, so the GUI
+        // recycles the right graphs even if this is never followed by any
+        int slot = s->releaseSlot(inst);
+        if (slot >= 0)
+            s->releases[slot].fetch_add(1, std::memory_order_release);
+        sig.instance(inst).release();
+        return;
+    }
+    if (evt == Signal::Event::INST_OFLW) {
+        s->stats.dropInstance();
+        return;
+    }
+    if (evt != Signal::Event::UPDATE || !value)
+        return;
 
-    if (s && value) {
-        double dtime = time;
-        double dval = ((float*)value)[0];
-        s->qcpGraph->addData(dtime, dval);
-        s->qcpGraph->data()->removeBefore(dtime-8);
+    // instances refused a slot are still captured
+    int slot = s->acquireSlot(inst);
+    if (slot < 0 && !s->capture)
+        return;
+    double dtime = time;
+    int n = qMin(len, s->elements);
+    double min = INFINITY, max = -INFINITY, sum = 0;
+
+    // signals keep the source type, so read each one natively
+    switch (type) {
+    case Type::FLOAT:
+        pushElements(s, dtime, (const float*)value, len, slot, inst, min, max, sum);
+        break;
+    case Type::INT32:
+        pushElements(s, dtime, (const int*)value, len, slot, inst, min, max, sum);
+        break;
+    case Type::DOUBLE:
+        pushElements(s, dtime, (const double*)value, len, slot, inst, min, max, sum);
+        break;
+    default:
+        return;
     }
-    // TODO:
+    if (slot < 0)
+        return;
+
+    Time now;
+    now.now();
+    s->stats.update(dtime, (double)now, min, max, sum, n);
 }
 
 void mapHandler(Graph&& graph, Map&& map, Graph::Event evt)
@@ -83,57 +154,45 @@ void mapHandler(Graph&& graph, Map&& map, Graph::Event evt)
 
         int length = src.property(Property::LENGTH);
         int numInst = src.property(Property::NUM_INSTANCES);
-        float minArray[length], maxArray[length], *min = 0, *max = 0;
+        Type type = (Type)src.property(Property::TYPE);
+        switch (type) {
+        case Type::FLOAT:
+        case Type::INT32:
+        case Type::DOUBLE:
+            break;
+        default:
+            qInfo("problem with connection src_type.");
+            return;
+        }
+
+        // match the source type, so no conversion happens before plotting and
+        // the source's min and max can be passed on as they are
+        void *min = 0, *max = 0;
         if (src.property(Property::MIN) && src.property(Property::MAX)) {
-            switch ((Type)src.property(Property::TYPE)) {
-            case Type::FLOAT: {
-                min = (float*)src.property(Property::MIN);
-                max = (float*)src.property(Property::MAX);
-                break;
-            }
-            case Type::INT32: {
-                int *src_mini = (int*)src.property(Property::MIN);
-                int *src_maxi = (int*)src.property(Property::MAX);
-                for (int i = 0; i < length; i++) {
-                    minArray[i] = (float)src_mini[i];
-                    maxArray[i] = (float)src_maxi[i];
-                }
-                min = minArray;
-                max = maxArray;
-                break;
-            }
-            case Type::DOUBLE: {
-                double *src_mind = (double*)src.property(Property::MIN);
-                double *src_maxd = (double*)src.property(Property::MAX);
-                for (int i = 0; i < length; i++) {
-                    minArray[i] = (float)src_mind[i];
-                    maxArray[i] = (float)src_maxd[i];
-                }
-                min = minArray;
-                max = maxArray;
-                break;
-            }
-            default:
-                qInfo("problem with connection src_type.");
-                return;
-            }
+            min = (void*)src.property(Property::MIN);
+            max = (void*)src.property(Property::MAX);
         }
 
-        sig = data->device->add_signal(Direction::INCOMING, src_full_name, length, Type::FLOAT,
+        sig = data->device->add_signal(Direction::INCOMING, src_full_name, length, type,
                                        0, min, max, &numInst);
         if (!sig)
             return;
 
-        // add a corresponding plot
-        QColor color;
-        color.setHsvF(data->plot_index*0.1, 1.0, 1.0, 1.0);
-        SignalPlot* plot = new SignalPlot;
-        plot->qcpGraph = data->ui->customPlot->addGraph();
-        plot->qcpGraph->setPen(QPen(QBrush(color), 2));
+        // add a corresponding plot; its graph is created on the GUI thread
+        SignalPlot* plot = new SignalPlot(length, numInst);
+        plot->hue = fmod(data->plot_index*0.1, 1.0);
+        plot->name = QString::fromStdString(src_full_name);
         data->plot_index += 1;
+        if (data->capture->isOpen()) {
+            plot->capture = data->capture;
+            plot->captureId = data->capture->addSignal(plot->name);
+        }
         data->plots << plot;
+        SignalPlotter *plotter = data->plotter;
+        QMetaObject::invokeMethod(plotter, [plotter, plot]() { plotter->addPlot(plot); },
+                                  Qt::QueuedConnection);
         sig.set_property("plot", (void*)plot);
-        sig.set_callback(signalHandler);
+        sig.set_callback(signalHandler, Signal::Event::ALL);
 
         // connect the new signal
         mapper::Map newmap(src, sig);
@@ -154,9 +213,11 @@ void mapHandler(Graph&& graph, Map&& map, Graph::Event evt)
         int idx = data->plots.indexOf(s);
         if (idx >= 0)
             data->plots.removeAt(idx);
-        data->ui->customPlot->removeGraph(s->qcpGraph);
-        delete s;
         data->device->remove_signal(dst);
+        // no more samples can arrive for s, so the GUI may free it
+        SignalPlotter *plotter = data->plotter;
+        QMetaObject::invokeMethod(plotter, [plotter, s]() { plotter->removePlot(s); },
+                                  Qt::QueuedConnection);
         break;
     }
     default:
@@ -165,10 +226,146 @@ void mapHandler(Graph&& graph, Map&& map, Graph::Event evt)
     }
 }
 
+SignalPlot::SignalPlot(int length, int numInst) :
+    elements(qBound(1, length, MAX_ELEMENTS)),
+    instances(qBound(1, numInst, MAX_INSTANCES)),
+    queue(QUEUE_CAPACITY),
+    releases(new std::atomic<quint32>[instances]),
+    releasesSeen(instances, 0),
+    lastStats(),
+    hue(0),
+    traces(elements * instances),
+    spectrogram(0),
+    colorMap(0),
+    spectrogramDirty(false),
+    capture(0),
+    captureId(-1),
+    slotIds(instances),
+    slotUsed(instances, false),
+    refused(false),
+    refusedId(0)
+{
+    for (int i = 0; i < instances; i++)
+        releases[i].store(0, std::memory_order_relaxed);
+}
+
+SignalPlot::~SignalPlot()
+{
+    delete spectrogram;
+}
+
+// instances beyond the first MAX_INSTANCES live at once are not plotted
+int SignalPlot::acquireSlot(mapper::Id inst)
+{
+    int free = -1;
+    for (int i = 0; i < instances; i++) {
+        if (!slotUsed[i]) {
+            if (free < 0)
+                free = i;
+        } else if (slotIds[i] == inst) {
+            return i;
+        }
+    }
+    if (free >= 0) {
+        slotIds[free] = inst;
+        slotUsed[free] = true;
+    } else if (!refused || inst != refusedId) {
+        // count each refused instance once, not every update it sends
+        refused = true;
+        refusedId = inst;
+        stats.dropInstance();
+    }
+    return free;
+}
+
+int SignalPlot::releaseSlot(mapper::Id inst)
+{
+    for (int i = 0; i < instances; i++) {
+        if (slotUsed[i] && slotIds[i] == inst) {
+            slotUsed[i] = false;
+            return i;
+        }
+    }
+    return -1;
+}
+
+MapperThread::MapperThread(SignalPlotter *plotter)
+{
+    data.plot_index = 0;
+    data.plotter = plotter;
+    data.device = 0;
+    data.capture = &capture;
+}
+
+void MapperThread::setCapture(const QString &path)
+{
+    QMutexLocker locker(&captureLock);
+    capturePath = path;
+    capturePending = 1;
+}
+
+// signals that already exist are added to the new file's signal table
+void MapperThread::openCapture()
+{
+    QString path;
+    {
+        QMutexLocker locker(&captureLock);
+        path = capturePath;
+        capturePending = 0;
+    }
+    for (auto const& plot : data.plots)
+        plot->capture = 0;
+    if (!capture.open(path)) {
+        qInfo("could not open capture file %s", qPrintable(path));
+        return;
+    }
+    for (auto const& plot : data.plots) {
+        plot->capture = &capture;
+        plot->captureId = capture.addSignal(plot->name);
+    }
+}
+
+void MapperThread::run()
+{
+    mapper::Device device("SignalPlotter");
+    data.device = &device;
+
+    mapper::Graph graph = device.graph();
+    graph.set_property("plot", (void*)&data);
+
+    // add a map handler to the device
+    graph.add_callback(mapHandler, Type::OBJECT);
+    graph.subscribe(Type::OBJECT);
+
+    // add a dummy input mapper::Signal to start
+    device.add_signal(Direction::INCOMING, "plotme", 1, Type::FLOAT);
+
+    while (!isInterruptionRequested()) {
+        if (capturePending)
+            openCapture();
+        device.poll(POLL_MS);
+    }
+
+    // the plots themselves belong to the GUI from here on
+    for (auto const& plot : data.plots)
+        plot->capture = 0;
+    data.plots.clear();
+    capture.close();
+    data.device = 0;
+}
+
 SignalPlotter::SignalPlotter(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::SignalPlotter),
-    device("SignalPlotter")
+    autoscaleHysteresis(AUTOSCALE_HYSTERESIS),
+    scrollStep(SCROLL_STEP_SEC),
+    viewDirty(true),
+    paused(false),
+    historyDirty(false),
+    statsFrames(0),
+    statsFrameMs(0),
+    statsDepth(0),
+    mapperThread(this)
 {
     ui->setupUi(this);
     setGeometry(400, 250, 542, 390);
@@ -184,41 +381,532 @@ SignalPlotter::SignalPlotter(QWidget *parent) :
     connect(ui->customPlot->yAxis, SIGNAL(rangeChanged(QCPRange)),
             ui->customPlot->yAxis2, SLOT(setRange(QCPRange)));
 
-    data.plot_index = 0;
-    data.ui = ui;
-    data.device = &device;
-    // TODO: use device graph instead
-    mapper::Graph graph = device.graph();
-    graph.set_property("plot", (void*)&data);
-
-    // add a map handler to the device
-    graph.add_callback(mapHandler, Type::OBJECT);
-    graph.subscribe(Type::OBJECT);
-
-    // add a dummy input mapper::Signal to start
-    device.add_signal(Direction::INCOMING, "plotme", 1, Type::FLOAT);
-
-    // setup a timer that repeatedly calls MainWindow::realtimeDataSlot:
+    // graphs get their own buffered layer, so frames where only the data
+    // changed repaint that layer alone over the cached axes and grid
+    QCustomPlot *customPlot = ui->customPlot;
+    customPlot->addLayer("traces", customPlot->layer("main"), QCustomPlot::limAbove);
+    tracesLayer = customPlot->layer("traces");
+    tracesLayer->setMode(QCPLayer::lmBuffered);
+    customPlot->setCurrentLayer(tracesLayer);
+
+    // likewise the scrolling time axis and its grid, so a scroll step
+    // repaints two layers instead of the whole plot
+    customPlot->addLayer("xaxis", customPlot->layer("grid"), QCustomPlot::limAbove);
+    xAxisLayer = customPlot->layer("xaxis");
+    xAxisLayer->setMode(QCPLayer::lmBuffered);
+    customPlot->xAxis->setLayer(xAxisLayer);
+    customPlot->xAxis2->setLayer(xAxisLayer);
+    customPlot->xAxis->grid()->setLayer(xAxisLayer);
+
+    // per-signal statistics, drawn on QCustomPlot's own buffered overlay layer
+    statsText = new QCPItemText(customPlot);
+    statsText->setLayer("overlay");
+    statsText->position->setType(QCPItemPosition::ptAxisRectRatio);
+    statsText->position->setCoords(0.01, 0.02);
+    statsText->setPositionAlignment(Qt::AlignTop | Qt::AlignLeft);
+    statsText->setTextAlignment(Qt::AlignLeft);
+    statsText->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    statsText->setColor(Qt::white);
+    statsText->setBrush(QBrush(QColor(0, 0, 0, 160)));
+    statsText->setPadding(QMargins(4, 4, 4, 4));
+    statsText->setVisible(false);
+
+    statsAction = ui->mainToolBar->addAction("Statistics");
+    statsAction->setCheckable(true);
+    connect(statsAction, &QAction::toggled, this, &SignalPlotter::setStatsVisible);
+    ui->mainToolBar->addAction("Export CSV...", this, &SignalPlotter::exportStats);
+
+    // frequency view of the first element of each signal, in a dock so it can
+    // be torn off or hidden; nothing is computed while it is closed
+    spectrumPlot = new QCustomPlot;
+    spectrumPlot->plotLayout()->clear();
+    spectrumPlot->setBackground(brush);
+    spectrumDock = new QDockWidget("Spectrograms", this);
+    spectrumDock->setWidget(spectrumPlot);
+    addDockWidget(Qt::BottomDockWidgetArea, spectrumDock);
+    spectrumDock->hide();
+    ui->mainToolBar->addAction(spectrumDock->toggleViewAction());
+
+    // pausing freezes the time axis for dragging and zooming, through the
+    // capture file when there is one
+    pauseAction = ui->mainToolBar->addAction("Pause");
+    pauseAction->setCheckable(true);
+    connect(pauseAction, &QAction::toggled, this, &SignalPlotter::setPaused);
+    customPlot->axisRect()->setRangeDrag(Qt::Horizontal);
+    customPlot->axisRect()->setRangeZoom(Qt::Horizontal);
+    connect(customPlot->xAxis, SIGNAL(rangeChanged(QCPRange)), this, SLOT(keyRangeChanged(QCPRange)));
+
+    statsTimer.start();
+    statsCpu = std::clock();
+
+    mapperThread.start();
+
+    // redraw once per display refresh; the mapper thread polls independently
+    QScreen *screen = QGuiApplication::primaryScreen();
+    qreal refreshRate = screen ? screen->refreshRate() : 60;
+    dataTimer.setTimerType(Qt::PreciseTimer);
     connect(&dataTimer, SIGNAL(timeout()), this, SLOT(realtimeDataSlot()));
-    dataTimer.start(0); // Interval 0 means to refresh as fast as possible
+    dataTimer.start(qMax(1, qRound(1000 / qMax(refreshRate, 1.0))));
 }
 
 SignalPlotter::~SignalPlotter()
 {
+    dataTimer.stop();
+    mapperThread.requestInterruption();
+    mapperThread.wait();
+    qDeleteAll(plots);
     delete ui;
 }
 
+void SignalPlotter::setStatsVisible(bool visible)
+{
+    statsAction->setChecked(visible);
+    statsText->setVisible(visible);
+    statsText->layer()->replot();
+}
+
+bool SignalPlotter::setStatsLog(const QString &path)
+{
+    statsLog.setFileName(path);
+    if (!statsLog.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qInfo("could not open statistics log %s", qPrintable(path));
+        return false;
+    }
+    statsLog.write(("time," + SignalStats::csvHeader() + "\n").toUtf8());
+    return true;
+}
+
+// the most recent report, one row per signal
+void SignalPlotter::exportStats()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export signal statistics", "signal_stats.csv",
+                                                "CSV files (*.csv)");
+    if (path.isEmpty())
+        return;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        ui->statusBar->showMessage("could not write " + path);
+        return;
+    }
+    file.write((SignalStats::csvHeader() + "\n").toUtf8());
+    for (auto const& plot : plots)
+        file.write((SignalStats::csvRow(plot->name, plot->lastStats) + "\n").toUtf8());
+}
+
+// instances of one signal shift the hue slightly, elements darken it
+static QColor traceColor(const SignalPlot *plot, int index)
+{
+    int instance = index / plot->elements, element = index % plot->elements;
+    QColor color;
+    color.setHsvF(fmod(plot->hue + instance * 0.03, 1.0), 1.0, 1.0 - 0.5 * element / plot->elements);
+    return color;
+}
+
+void SignalPlotter::setCapture(const QString &path)
+{
+    capturePath = path;
+    mapperThread.setCapture(path);
+}
+
+void SignalPlotter::setPaused(bool paused)
+{
+    this->paused = paused;
+    pauseAction->setChecked(paused);
+    ui->customPlot->setInteractions(paused ? QCP::iRangeDrag | QCP::iRangeZoom : QCP::Interactions());
+    if (paused) {
+        historyRange = QCPRange();
+        historyDirty = !capturePath.isEmpty();
+    } else {
+        // back to the live containers, dropping graphs that only held history
+        for (auto const& plot : plots) {
+            for (Trace &trace : plot->traces) {
+                trace.history.clear();
+                if (trace.graph && trace.data->isEmpty())
+                    releaseTrace(trace);
+                else if (trace.graph)
+                    trace.graph->setRingData(trace.data);
+            }
+        }
+        historyDirty = false;
+        autoscaleValueAxis();
+    }
+    viewDirty = true;
+}
+
+// reload the capture once a drag or zoom leaves what was loaded
+void SignalPlotter::keyRangeChanged(const QCPRange &range)
+{
+    if (!paused)
+        return;
+    viewDirty = true;
+    if (!capturePath.isEmpty() && (range.lower < historyRange.lower || range.upper > historyRange.upper))
+        historyDirty = true;
+}
+
+// page in the captured samples around the visible time range, one view width
+// either side so small drags need no reload; the reader maps the file afresh
+// so it also sees chunks written since the last load
+void SignalPlotter::loadHistory()
+{
+    historyDirty = false;
+    CaptureReader reader;
+    if (!reader.open(capturePath)) {
+        ui->statusBar->showMessage("could not read capture " + capturePath);
+        return;
+    }
+    QCPRange visible = ui->customPlot->xAxis->range();
+    historyRange = QCPRange(visible.lower - visible.size(), visible.upper + visible.size());
+
+    // captured signals are matched to plots by name, so a signal that was
+    // unmapped and mapped again shows its whole history
+    QStringList names = reader.signalNames();
+    QVector<int> plotOf(names.size(), -1);
+    for (int i = 0; i < names.size(); i++) {
+        for (int p = 0; p < plots.size(); p++) {
+            if (plots[p]->name == names[i])
+                plotOf[i] = p;
+        }
+    }
+    QVector<QVector<QVector<QCPGraphData> > > rows(plots.size());
+    for (int p = 0; p < plots.size(); p++)
+        rows[p].resize(plots[p]->traces.size());
+    // instance ids get trace slots in the order they first appear
+    QVector<QHash<quint64, int> > slotOf(plots.size());
+
+    int loaded = 0;
+    reader.scan(historyRange.lower, historyRange.upper,
+                [&](int signal, quint64 instance, int element, double time, double value) {
+        if (signal >= plotOf.size() || plotOf[signal] < 0)
+            return true;
+        int p = plotOf[signal];
+        const SignalPlot *plot = plots[p];
+        QHash<quint64, int> &ids = slotOf[p];
+        int slot = ids.value(instance, -1);
+        if (slot < 0 && ids.size() < plot->instances)
+            ids.insert(instance, slot = ids.size());
+        if (slot < 0 || element >= plot->elements)
+            return true;
+        rows[p][slot * plot->elements + element] << QCPGraphData(time, value);
+        return ++loaded < HISTORY_MAX_ROWS;
+    });
+    if (loaded >= HISTORY_MAX_ROWS)
+        ui->statusBar->showMessage("capture range too long, zoom in to see all of it");
+
+    for (int p = 0; p < plots.size(); p++) {
+        SignalPlot *plot = plots[p];
+        for (int i = 0; i < plot->traces.size(); i++) {
+            Trace &trace = plot->traces[i];
+            if (!trace.graph && rows[p][i].isEmpty())
+                continue;
+            if (!trace.graph)
+                trace = acquireTrace(traceColor(plot, i));
+            trace.history = QSharedPointer<QCPGraphDataContainer>(new QCPGraphDataContainer);
+            // rows of one trace are in arrival order, which is not
+            // necessarily time order
+            trace.history->set(rows[p][i], false);
+            trace.graph->setData(trace.history);
+        }
+    }
+    ui->customPlot->yAxis->rescale(true);
+    viewDirty = true;
+}
+
+void SignalPlotter::addPlot(SignalPlot *plot)
+{
+    plots << plot;
+    viewDirty = true;
+}
+
+void SignalPlotter::removePlot(SignalPlot *plot)
+{
+    plots.removeOne(plot);
+    removeSpectrogram(plot);
+    for (Trace &trace : plot->traces) {
+        if (trace.graph)
+            releaseTrace(trace);
+    }
+    delete plot;
+    viewDirty = true;
+}
+
+// graphs and their containers are reused across instances, since instanced
+// signals such as touches come and go many times a second
+Trace SignalPlotter::acquireTrace(const QColor &color)
+{
+    Trace trace;
+    if (!tracePool.isEmpty()) {
+        trace = tracePool.takeLast();
+    } else {
+        QCustomPlot *customPlot = ui->customPlot;
+        trace.graph = new DecimatedGraph(customPlot->xAxis, customPlot->yAxis);
+        trace.data = QSharedPointer<RingDataContainer>(new RingDataContainer(RING_CAPACITY));
+        trace.graph->setRingData(trace.data);
+    }
+    trace.graph->setPen(QPen(QBrush(color), 2));
+    trace.graph->setVisible(true);
+    return trace;
+}
+
+// an instance was released: hand the graphs of its slot back to the pool
+void SignalPlotter::recycleSlot(SignalPlot *plot, int slot, quint32 releases)
+{
+    plot->releasesSeen[slot] = releases;
+    int first = slot * plot->elements;
+    for (int i = first; i < first + plot->elements; i++) {
+        if (plot->traces[i].graph)
+            releaseTrace(plot->traces[i]);
+    }
+}
+
+void SignalPlotter::releaseTrace(Trace &trace)
+{
+    trace.graph->setVisible(false);
+    trace.graph->setRingData(trace.data);
+    trace.data->reset();
+    tracePool << trace;
+    trace = Trace();
+}
+
+void SignalPlotter::setSpectrogramsVisible(bool visible)
+{
+    spectrumDock->setVisible(visible);
+}
+
+// a panel per signal, stacked in the dock's plot
+void SignalPlotter::addSpectrogram(SignalPlot *plot)
+{
+    plot->spectrogram = new Spectrogram(SPECTROGRAM_SIZE, SPECTROGRAM_HOP, SPECTROGRAM_COLUMNS);
+    QCPAxisRect *rect = new QCPAxisRect(spectrumPlot);
+    spectrumPlot->plotLayout()->addElement(spectrumPlot->plotLayout()->rowCount(), 0, rect);
+    rect->axis(QCPAxis::atLeft)->setLabel(plot->name + " (Hz)");
+
+    plot->colorMap = new QCPColorMap(rect->axis(QCPAxis::atBottom), rect->axis(QCPAxis::atLeft));
+    plot->colorMap->data()->setSize(plot->spectrogram->columns(), plot->spectrogram->bins());
+    plot->colorMap->setGradient(QCPColorGradient::gpThermal);
+    plot->colorMap->setDataRange(QCPRange(SPECTROGRAM_FLOOR_DB, 0));
+    plot->colorMap->setInterpolate(false);
+}
+
+void SignalPlotter::removeSpectrogram(SignalPlot *plot)
+{
+    if (!plot->colorMap)
+        return;
+    QCPAxisRect *rect = plot->colorMap->keyAxis()->axisRect();
+    spectrumPlot->removePlottable(plot->colorMap);
+    spectrumPlot->plotLayout()->remove(rect);
+    spectrumPlot->plotLayout()->simplify();
+    plot->colorMap = 0;
+    delete plot->spectrogram;
+    plot->spectrogram = 0;
+    spectrumPlot->replot();
+}
+
+// copy the history of every spectrogram that gained columns into its color
+// map; QCPColorMap rebuilds its whole image on any change anyway
+void SignalPlotter::updateSpectrograms()
+{
+    if (!spectrumDock->isVisible())
+        return;
+    bool changed = false;
+    for (auto const& plot : plots) {
+        if (!plot->spectrogram) {
+            addSpectrogram(plot);
+            changed = true;
+        }
+        if (!plot->spectrogramDirty)
+            continue;
+        plot->spectrogramDirty = false;
+
+        const Spectrogram *spectrogram = plot->spectrogram;
+        QCPColorMapData *data = plot->colorMap->data();
+        for (int x = 0; x < spectrogram->columns(); x++) {
+            const float *column = spectrogram->column(x);
+            for (int y = 0; y < spectrogram->bins(); y++)
+                data->setCell(x, y, column[y]);
+        }
+        double rate = spectrogram->sampleRate();
+        if (rate > 0) {
+            double span = spectrogram->columns() * spectrogram->hop() / rate;
+            data->setRange(QCPRange(spectrogram->lastKey() - span, spectrogram->lastKey()),
+                           QCPRange(0, rate / 2));
+            plot->colorMap->rescaleAxes();
+        }
+        changed = true;
+    }
+    if (changed)
+        spectrumPlot->replot();
+}
+
+// runs once per display refresh, but only draws what changed: nothing when
+// no samples arrived and the view is still, the graph layer for new data, the
+// time axis layer for a scroll step and everything when the layout may move
 void SignalPlotter::realtimeDataSlot()
 {
-    device.poll(10);
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+
+    int depth = 0;
+    quint64 dropped = 0;
+    bool hasData = false, spectra = spectrumDock->isVisible();
     for (auto const& plot : plots) {
-        plot->qcpGraph->rescaleValueAxis();
+        depth += plot->queue.drain([this, plot, spectra](double key, double value, int tagged) {
+            int index = tagged & 0xffff, slot = index / plot->elements;
+            quint32 ahead = (quint32(tagged >> 16) - plot->releasesSeen[slot]) % RELEASE_TAG_MOD;
+            if (ahead >= RELEASE_TAG_MOD / 2)
+                return; // from an instance whose release was already applied
+            if (ahead)
+                recycleSlot(plot, slot, plot->releasesSeen[slot] + ahead);
+            Trace &trace = plot->traces[index];
+            if (!trace.graph)
+                trace = acquireTrace(traceColor(plot, index));
+            trace.data->append(key, value);
+            if (index == 0 && spectra && plot->spectrogram && plot->spectrogram->push(key, value))
+                plot->spectrogramDirty = true;
+        });
+        // releases with no sample of a newer instance behind them
+        for (int slot = 0; slot < plot->instances; slot++) {
+            quint32 releases = plot->releases[slot].load(std::memory_order_acquire);
+            if (releases != plot->releasesSeen[slot])
+                recycleSlot(plot, slot, releases);
+        }
+        dropped += plot->queue.dropped();
+        for (Trace &trace : plot->traces) {
+            RingDataContainer *data = trace.data.data();
+            if (data && !data->isEmpty()) {
+                data->expireBefore((data->constEnd() - 1)->key - TIME_WINDOW_SEC);
+                hasData = true;
+            }
+        }
     }
+    bool dataChanged = depth > 0;
+    bool rescaled = dataChanged && !paused && autoscaleValueAxis();
+    updateSpectrograms();
+    if (historyDirty)
+        loadHistory();
 
     mapper::Time time;
     time.now();
 
-    // make key axis range scroll with the data (at a constant range size of 8):
-    ui->customPlot->xAxis->setRange((double)time + 0.25, 8, Qt::AlignRight);
-    ui->customPlot->replot();
+    // make key axis range scroll with the data (at a constant range size of TIME_WINDOW_SEC),
+    // in whole steps so most frames leave the axes untouched; with nothing to
+    // show there is no point in scrolling
+    double right = (double)time + 0.25;
+    if (scrollStep > 0)
+        right = ceil((double)time / scrollStep) * scrollStep + scrollStep;
+    QCustomPlot *customPlot = ui->customPlot;
+    bool scrolled = !paused && hasData && customPlot->xAxis->range().upper != right;
+    if (scrolled)
+        customPlot->xAxis->setRange(right, TIME_WINDOW_SEC, Qt::AlignRight);
+
+    bool drawn = true;
+    if (rescaled || viewDirty) {
+        // tick labels on the value axis can change the margins
+        customPlot->replot();
+        viewDirty = false;
+    } else if (scrolled) {
+        customPlot->axisRect()->update(QCPLayoutElement::upPreparation);
+        xAxisLayer->replot();
+        tracesLayer->replot();
+    } else if (dataChanged && !paused) {
+        tracesLayer->replot();
+    } else {
+        drawn = false;
+    }
+
+    if (drawn) {
+        statsFrames += 1;
+        statsFrameMs += frameTimer.nsecsElapsed() * 1e-6;
+    }
+    statsDepth = qMax(statsDepth, depth);
+    if (statsTimer.elapsed() >= STATS_INTERVAL_MS)
+        reportStats(dropped);
+}
+
+// frame rate, mean frame time and process CPU use (both threads) since the last report
+void SignalPlotter::reportStats(quint64 dropped)
+{
+    double wall = statsTimer.restart() * 1e-3;
+    std::clock_t cpu = std::clock();
+    double load = wall > 0 ? (double)(cpu - statsCpu) / CLOCKS_PER_SEC / wall * 100 : 0;
+    statsCpu = cpu;
+
+    ui->statusBar->showMessage(QString("%1 fps, %2 ms/frame, CPU %3%, queue depth %4, dropped %5")
+                               .arg(statsFrames / wall, 0, 'f', 1)
+                               .arg(statsFrames ? statsFrameMs / statsFrames : 0, 0, 'f', 2)
+                               .arg(load, 0, 'f', 1)
+                               .arg(statsDepth)
+                               .arg(dropped));
+    statsFrames = 0;
+    statsFrameMs = 0;
+    statsDepth = 0;
+
+    mapper::Time now;
+    now.now();
+    QString overlay, timestamp = QString::number((double)now, 'f', 3);
+    for (auto const& plot : plots) {
+        const SignalStats::Snapshot &st = plot->lastStats = plot->stats.snapshot();
+        overlay += QString::asprintf("%-32s %7.1f Hz  jitter %6.2f ms  latency %6.2f ms (max %6.2f)"
+                                     "  [%g, %g] mean %g  dropped %llu\n",
+                                     qPrintable(plot->name.right(32)), st.rate, st.jitter * 1e3,
+                                     st.latency * 1e3, st.maxLatency * 1e3, st.min, st.max,
+                                     st.mean, (unsigned long long)st.droppedInstances);
+        if (statsLog.isOpen())
+            statsLog.write((timestamp + "," + SignalStats::csvRow(plot->name, st) + "\n").toUtf8());
+    }
+    if (statsLog.isOpen())
+        statsLog.flush();
+    if (statsText->visible()) {
+        statsText->setText(overlay.isEmpty() ? "no signals" : overlay.trimmed());
+        statsText->layer()->replot();
+    }
+}
+
+bool SignalPlotter::setOpenGl(bool enabled)
+{
+    ui->customPlot->setOpenGl(enabled);
+    viewDirty = true;
+    if (enabled && !ui->customPlot->openGl())
+        qInfo("OpenGL unavailable, falling back to raster rendering.");
+    return ui->customPlot->openGl();
+}
+
+// fit the value axis to every graph at once, using each container's min/max
+// pyramid instead of rescaleValueAxis(), which scans all visible samples
+bool SignalPlotter::autoscaleValueAxis()
+{
+    QCPRange extent;
+    bool found = false;
+    for (auto const& plot : plots) {
+        for (const Trace &trace : plot->traces) {
+            bool foundTrace = false;
+            QCPRange range;
+            if (trace.data)
+                range = trace.data->valueExtent(foundTrace);
+            if (!foundTrace)
+                continue;
+            if (found)
+                extent.expand(range);
+            else
+                extent = range;
+            found = true;
+        }
+    }
+    if (!found)
+        return false;
+
+    double margin = extent.size() * AUTOSCALE_MARGIN;
+    if (margin <= 0)
+        margin = qMax(qAbs(extent.center()) * AUTOSCALE_MARGIN, 1e-3);
+    QCPRange target(extent.lower - margin, extent.upper + margin);
+
+    // grow at once so nothing is clipped, but only shrink on a large change so
+    // small wobbles don't re-layout the ticks every frame
+    QCPRange current = ui->customPlot->yAxis->range();
+    bool contained = extent.lower >= current.lower && extent.upper <= current.upper;
+    if (contained && target.size() >= current.size() * (1 - autoscaleHysteresis))
+        return false;
+    if (target == current)
+        return false;
+    ui->customPlot->yAxis->setRange(target);
+    return true;
 }
@@ -2,11 +2,39 @@
 #define SIGNALPLOTTER_H
 
 #include <QMainWindow>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
 #include <qcustomplot.h>
 
 #include <mapper/mapper_cpp.h>
+#include <atomic>
+#include <ctime>
+#include <memory>
+
+#include "capturefile.h"
+#include "decimatedgraph.h"
+#include "ringdatacontainer.h"
+#include "samplequeue.h"
+#include "signalstats.h"
+#include "spectrogram.h"
 
 #define MAX_LIST 256
+#define TIME_WINDOW_SEC 8
+#define RING_CAPACITY 16384 // samples kept per graph, enough for 2 kHz over the window
+#define QUEUE_CAPACITY 8192 // samples buffered per signal between GUI frames
+#define MAX_ELEMENTS 16 // vector elements plotted per signal
+#define MAX_INSTANCES 16 // simultaneous instances plotted per signal
+#define POLL_MS 10
+#define RELEASE_TAG_MOD 0x8000    // release counts carried by queued samples wrap at this
+#define AUTOSCALE_MARGIN 0.05     // padding above and below the data, as a fraction of its span
+#define AUTOSCALE_HYSTERESIS 0.2  // default relative shrink needed before the axis follows
+#define SCROLL_STEP_SEC 0.25      // default time axis scroll increment
+#define STATS_INTERVAL_MS 1000    // how often frame statistics are shown
+#define SPECTROGRAM_SIZE 1024      // FFT length
+#define SPECTROGRAM_HOP 256        // samples between columns (75% overlap)
+#define SPECTROGRAM_COLUMNS 256
+#define HISTORY_MAX_ROWS 4000000   // capture rows loaded at most when browsing
 
 // function prototypes
 void mapHandler(mapper::Map map, mpr_graph_evt e);
@@ -18,20 +46,100 @@ namespace Ui {
 class SignalPlotter;
 }
 
+class SignalPlotter;
+
+// one plotted line: a single element of a single signal instance
+struct Trace
+{
+    Trace() : graph(0) {}
+
+    DecimatedGraph* graph;
+    QSharedPointer<RingDataContainer> data;
+    // GUI thread: captured samples shown instead of data while paused
+    QSharedPointer<QCPGraphDataContainer> history;
+};
+
 class SignalPlot
 {
 public:
-    QCPGraph* qcpGraph;
-    double average;
+    SignalPlot(int length, int numInst);
+    ~SignalPlot();
+
+    // mapper thread: the trace slot of a libmapper instance, or -1 if all
+    // slots are in use; releaseSlot() returns the slot it freed
+    int acquireSlot(mapper::Id inst);
+    int releaseSlot(mapper::Id inst);
+
+    // a trace index as queued: tagged with how many times its slot has been
+    // released, modulo RELEASE_TAG_MOD, so the GUI can tell whether a sample
+    // belongs to the instance it is drawing, a newer one or an older one
+    static int tag(int trace, quint32 releases) { return int(releases % RELEASE_TAG_MOD) << 16 | trace; }
+
+    const int elements, instances;
+    // filled by the mapper thread, drained by the GUI thread
+    SampleQueue queue;
+    // mapper thread writes, GUI thread reads: releases of each instance slot
+    // so far. Kept out of the queue so that a full queue cannot lose one.
+    std::unique_ptr<std::atomic<quint32>[]> releases;
+    // GUI thread: the release count the traces of each slot are drawn for
+    QVector<quint32> releasesSeen;
+    SignalStats stats;
+    SignalStats::Snapshot lastStats; // GUI thread, from the latest report
+    QString name;
+    double hue;
+
+    // GUI thread: elements * instances traces, with a graph only while live
+    QVector<Trace> traces;
+    // GUI thread: spectrum of trace 0, while the spectrogram dock is open
+    Spectrogram *spectrogram;
+    QCPColorMap *colorMap;
+    bool spectrogramDirty;
+
+    // mapper thread: where every received sample is recorded, if anywhere
+    CaptureWriter *capture;
+    int captureId;
+
+private:
+    QVector<mapper::Id> slotIds;
+    QVector<bool> slotUsed;
+    bool refused;
+    mapper::Id refusedId;
 };
 
+// state shared with the libmapper callbacks, which run on the mapper thread
 typedef struct _SignalPlotterData {
     QList<SignalPlot *> plots;
     mapper::Device* device;
-    Ui::SignalPlotter *ui;
+    SignalPlotter *plotter;
+    CaptureWriter *capture;
     int plot_index;
 } SignalPlotterData;
 
+// owns the mapper::Device and polls it, so network handling never waits on a
+// replot; samples reach the GUI through each plot's SampleQueue
+class MapperThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit MapperThread(SignalPlotter *plotter);
+
+    // thread safe; the file is opened by the mapper thread before its next poll
+    void setCapture(const QString &path);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    void openCapture();
+
+    SignalPlotterData data;
+    CaptureWriter capture;
+    QMutex captureLock;
+    QString capturePath; // guarded by captureLock
+    QAtomicInt capturePending;
+};
+
 class SignalPlotter : public QMainWindow
 {
     Q_OBJECT
@@ -40,16 +148,69 @@ public:
     explicit SignalPlotter(QWidget *parent = 0);
     ~SignalPlotter();
 
+    // called on the GUI thread when the mapper thread adds or removes a signal
+    void addPlot(SignalPlot *plot);
+    void removePlot(SignalPlot *plot);
+
+    // 0 rescales on every change; otherwise the value axis only shrinks once
+    // the data span falls this fraction below the current axis span
+    void setAutoscaleHysteresis(double fraction) { autoscaleHysteresis = qMax(fraction, 0.0); }
+    // 0 scrolls the time axis smoothly, which redraws the axes every frame
+    void setScrollStep(double seconds) { scrollStep = qMax(seconds, 0.0); }
+    // returns whether OpenGL is in use, which needs QCUSTOMPLOT_USE_OPENGL
+    bool setOpenGl(bool enabled);
+    // append every statistics report to a CSV file
+    bool setStatsLog(const QString &path);
+    // record every received sample to a memory-mapped file, which can then
+    // be browsed while paused
+    void setCapture(const QString &path);
+
+public Q_SLOTS:
+    void setStatsVisible(bool visible);
+    void exportStats();
+    void setSpectrogramsVisible(bool visible);
+    void setPaused(bool paused);
+
 private Q_SLOTS:
   void realtimeDataSlot();
+  void keyRangeChanged(const QCPRange &range);
 
 private:
+    bool autoscaleValueAxis();
+    void reportStats(quint64 dropped);
+    void addSpectrogram(SignalPlot *plot);
+    void removeSpectrogram(SignalPlot *plot);
+    void updateSpectrograms();
+    void loadHistory();
+    Trace acquireTrace(const QColor &color);
+    void releaseTrace(Trace &trace);
+    void recycleSlot(SignalPlot *plot, int slot, quint32 releases);
 
     Ui::SignalPlotter *ui;
     QList<SignalPlot *> plots;
-    mapper::Device device;
-    mapper::Graph graph;
-    SignalPlotterData data;
+    QList<Trace> tracePool; // hidden graphs of released instances
+    QCPLayer *tracesLayer;
+    QCPLayer *xAxisLayer;
+    double autoscaleHysteresis;
+    double scrollStep;
+    bool viewDirty; // a full replot is needed regardless of new data
+    bool paused;
+    QAction *pauseAction;
+    QString capturePath;
+    bool historyDirty;
+    QCPRange historyRange; // key range loaded from the capture
+
+    QCustomPlot *spectrumPlot;
+    QDockWidget *spectrumDock;
+    QCPItemText *statsText;
+    QAction *statsAction;
+    QFile statsLog;
+    QElapsedTimer statsTimer;
+    std::clock_t statsCpu;
+    int statsFrames;
+    double statsFrameMs;
+    int statsDepth;
+    MapperThread mapperThread;
     QTimer dataTimer;
 };
 
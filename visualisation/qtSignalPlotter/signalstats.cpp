@@ -0,0 +1,93 @@
+#include "signalstats.h"
+
+#define GAIN (1.0 / 16)
+
+SignalStats::SignalStats() :
+    mLastReceived(-1),
+    mInterval(0),
+    mNewInterval(true),
+    mReportedUpdates(0)
+{
+    mStats.rate = mStats.jitter = mStats.latency = mStats.maxLatency = 0;
+    mStats.min = mStats.max = mStats.mean = 0;
+    mStats.updates = mStats.droppedInstances = 0;
+}
+
+void SignalStats::update(double sent, double received, double min, double max, double sum,
+                         int count)
+{
+    QMutexLocker lock(&mMutex);
+
+    if (mLastReceived >= 0) {
+        double interval = received - mLastReceived;
+        if (mStats.updates == 1)
+            mInterval = interval;
+        double deviation = interval - mInterval;
+        mInterval += deviation * GAIN;
+        mStats.jitter += ((deviation < 0 ? -deviation : deviation) - mStats.jitter) * GAIN;
+        mStats.rate = mInterval > 0 ? 1 / mInterval : 0;
+    }
+    mLastReceived = received;
+
+    double latency = received - sent;
+    double mean = count > 0 ? sum / count : mStats.mean;
+    if (!mStats.updates) {
+        mStats.latency = latency;
+        mStats.mean = mean;
+    } else {
+        mStats.latency += (latency - mStats.latency) * GAIN;
+        mStats.mean += (mean - mStats.mean) * GAIN;
+    }
+
+    if (mNewInterval) {
+        mStats.maxLatency = latency;
+        mStats.min = min;
+        mStats.max = max;
+        mNewInterval = count <= 0;
+    } else {
+        mStats.maxLatency = latency > mStats.maxLatency ? latency : mStats.maxLatency;
+        if (count > 0) {
+            mStats.min = min < mStats.min ? min : mStats.min;
+            mStats.max = max > mStats.max ? max : mStats.max;
+        }
+    }
+    ++mStats.updates;
+}
+
+void SignalStats::dropInstance()
+{
+    QMutexLocker lock(&mMutex);
+    ++mStats.droppedInstances;
+}
+
+SignalStats::Snapshot SignalStats::snapshot()
+{
+    QMutexLocker lock(&mMutex);
+    Snapshot s = mStats;
+    // a signal that went quiet has no rate, whatever its last interval was
+    if (s.updates == mReportedUpdates)
+        s.rate = 0;
+    mReportedUpdates = s.updates;
+    mNewInterval = true;
+    return s;
+}
+
+QString SignalStats::csvHeader()
+{
+    return "signal,rate_hz,jitter_ms,latency_ms,max_latency_ms,min,max,mean,updates,dropped_instances";
+}
+
+QString SignalStats::csvRow(const QString &name, const Snapshot &s)
+{
+    return QString("\"%1\",%2,%3,%4,%5,%6,%7,%8,%9,%10")
+        .arg(QString(name).replace('"', "\"\""))
+        .arg(s.rate, 0, 'f', 2)
+        .arg(s.jitter * 1e3, 0, 'f', 3)
+        .arg(s.latency * 1e3, 0, 'f', 3)
+        .arg(s.maxLatency * 1e3, 0, 'f', 3)
+        .arg(s.min)
+        .arg(s.max)
+        .arg(s.mean)
+        .arg(s.updates)
+        .arg(s.droppedInstances);
+}
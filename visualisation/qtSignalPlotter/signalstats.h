@@ -0,0 +1,49 @@
+#ifndef SIGNALSTATS_H
+#define SIGNALSTATS_H
+
+#include <QMutex>
+#include <QString>
+
+// Rolling per-signal diagnostics, updated once per signal update on the
+// mapper thread with O(1) exponentially weighted estimators (gain 1/16, as
+// for RTP jitter) and read by the GUI thread once per report interval.
+// Latency compares the sender's timestamp with the local receive time, so
+// it is only meaningful between devices whose clocks libmapper has synced.
+class SignalStats
+{
+public:
+    struct Snapshot {
+        double rate;        // updates per second
+        double jitter;      // mean deviation of the inter-arrival time (s)
+        double latency;     // mean receive minus send time (s)
+        double maxLatency;  // since the previous snapshot
+        double min, max;    // element values since the previous snapshot
+        double mean;        // of all element values
+        quint64 updates;
+        quint64 droppedInstances;
+    };
+
+    SignalStats();
+
+    // mapper thread: one signal update whose elements spanned [min, max]
+    // and summed to sum over count elements
+    void update(double sent, double received, double min, double max, double sum, int count);
+    // an instance that could not be plotted or was refused by libmapper
+    void dropInstance();
+
+    // GUI thread: current estimates; interval extrema restart from here
+    Snapshot snapshot();
+
+    static QString csvHeader();
+    static QString csvRow(const QString &name, const Snapshot &s);
+
+private:
+    QMutex mMutex;
+    Snapshot mStats;
+    double mLastReceived;
+    double mInterval; // smoothed inter-arrival time
+    bool mNewInterval; // next update restarts the interval extrema
+    quint64 mReportedUpdates;
+};
+
+#endif // SIGNALSTATS_H
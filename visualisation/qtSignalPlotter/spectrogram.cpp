@@ -0,0 +1,71 @@
+#include "spectrogram.h"
+#include <cmath>
+
+Spectrogram::Spectrogram(int size, int hop, int columns) :
+    mPlan(size),
+    mHop(qBound(1, hop, mPlan.size())),
+    mColumns(qMax(columns, 1)),
+    mWrite(0),
+    mFilled(0),
+    mSinceHop(0),
+    mNewest(mColumns - 1),
+    mSampleRate(0),
+    mLastKey(0)
+{
+    int n = mPlan.size();
+    mWindow.resize(n);
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        mWindow[i] = float(0.5 - 0.5 * cos(2 * M_PI * i / n));
+        sum += mWindow[i];
+    }
+    // full scale sine reads 0 dB
+    mScale = 2 / sum;
+
+    mInput.fill(0, n);
+    mKeys.fill(0, n);
+    mFrame.resize(n);
+    mSpectrum.resize(mPlan.bins());
+    mHistory.fill(SPECTROGRAM_FLOOR_DB, mColumns * mPlan.bins());
+}
+
+bool Spectrogram::push(double key, double value)
+{
+    mInput[mWrite] = float(value);
+    mKeys[mWrite] = key;
+    mWrite = (mWrite + 1) % mInput.size();
+    mLastKey = key;
+    if (mFilled < mInput.size())
+        ++mFilled;
+    if (++mSinceHop < mHop || mFilled < mInput.size())
+        return false;
+    mSinceHop = 0;
+    computeColumn();
+    return true;
+}
+
+void Spectrogram::computeColumn()
+{
+    // unroll the circular input, oldest first, applying the window
+    int n = mInput.size();
+    for (int i = 0; i < n; i++)
+        mFrame[i] = mInput[(mWrite + i) % n] * mWindow[i];
+    mPlan.forward(mFrame.constData(), mSpectrum.data());
+
+    double span = mKeys[(mWrite + n - 1) % n] - mKeys[mWrite];
+    mSampleRate = span > 0 ? (n - 1) / span : 0;
+
+    mNewest = (mNewest + 1) % mColumns;
+    float *out = mHistory.data() + mNewest * bins();
+    for (int k = 0; k < bins(); k++) {
+        float magnitude = std::abs(mSpectrum[k]) * float(mScale);
+        out[k] = magnitude > 0 ? qMax(20 * log10f(magnitude), SPECTROGRAM_FLOOR_DB)
+                               : SPECTROGRAM_FLOOR_DB;
+    }
+}
+
+const float *Spectrogram::column(int index) const
+{
+    int c = (mNewest + 1 + index) % mColumns;
+    return mHistory.constData() + c * bins();
+}
@@ -0,0 +1,46 @@
+#ifndef SPECTROGRAM_H
+#define SPECTROGRAM_H
+
+#include "fft.h"
+
+#define SPECTROGRAM_FLOOR_DB -100.f // levels are clamped here, the bottom of the colour scale
+
+// Streaming short-time spectrum of one trace. Samples are windowed (Hann)
+// in overlapping frames of size() samples every hop() samples, and each
+// frame's magnitude spectrum in dB becomes one column of a fixed-length
+// history. All buffers are allocated up front, so push() never allocates.
+class Spectrogram
+{
+public:
+    Spectrogram(int size, int hop, int columns);
+
+    int size() const { return mPlan.size(); }
+    int hop() const { return mHop; }
+    int bins() const { return mPlan.bins(); }
+    int columns() const { return mColumns; }
+
+    // returns true when the sample completed a new column
+    bool push(double key, double value);
+
+    // column 0 is the oldest, columns() - 1 the newest; bins() values each
+    const float *column(int index) const;
+    // sample rate estimated over the latest frame, and the time it ended
+    double sampleRate() const { return mSampleRate; }
+    double lastKey() const { return mLastKey; }
+
+private:
+    void computeColumn();
+
+    FftPlan mPlan;
+    int mHop, mColumns;
+    QVector<float> mWindow;
+    QVector<float> mInput;   // circular, size() samples
+    QVector<double> mKeys;   // timestamps of mInput
+    QVector<float> mFrame;   // windowed copy handed to the FFT
+    QVector<std::complex<float> > mSpectrum;
+    QVector<float> mHistory; // circular, columns() x bins()
+    int mWrite, mFilled, mSinceHop, mNewest;
+    double mSampleRate, mLastKey, mScale;
+};
+
+#endif // SPECTROGRAM_H